@@ -740,6 +740,12 @@ extern float max_error_rate;
 extern char *filter_nbthreads;
 extern int filter_complex_nbthreads;
 extern int filter_buffered_frames;
+extern int filter_pipeline_threads;
+extern int filter_pipeline_queue;
+extern int filter_fuse_pointwise;
+extern int filter_format_cost;
+extern int filter_profile;
+extern char *filter_audio_batch;
 extern int vstats_version;
 extern int print_graphs;
 extern char *print_graphs_file;
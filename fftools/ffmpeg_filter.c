@@ -1971,6 +1971,30 @@ static int configure_filtergraph(FilterGraph *fg, FilterGraphThread *fgt)
             return ret;
     }
 
+    ret = av_opt_set_int(fgt->graph, "pipeline_threads", filter_pipeline_threads, 0);
+    if (ret < 0)
+        return ret;
+    if (filter_pipeline_queue) {
+        ret = av_opt_set_int(fgt->graph, "pipeline_queue", filter_pipeline_queue, 0);
+        if (ret < 0)
+            return ret;
+    }
+    ret = av_opt_set_int(fgt->graph, "fuse_pointwise", filter_fuse_pointwise, 0);
+    if (ret < 0)
+        return ret;
+    ret = av_opt_set_int(fgt->graph, "format_cost", filter_format_cost, 0);
+    if (ret < 0)
+        return ret;
+
+    ret = av_opt_set_int(fgt->graph, "profile", filter_profile, 0);
+    if (ret < 0)
+        return ret;
+    if (filter_audio_batch) {
+        ret = av_opt_set(fgt->graph, "audio_batch", filter_audio_batch, 0);
+        if (ret < 0)
+            return ret;
+    }
+
     hw_device = hw_device_for_filter();
 
     ret = graph_parse(fg, fgt->graph, graph_desc, &inputs, &outputs, hw_device);
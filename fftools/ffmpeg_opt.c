@@ -76,6 +76,12 @@ float max_error_rate  = 2.0/3;
 char *filter_nbthreads;
 int filter_complex_nbthreads = 0;
 int filter_buffered_frames = 0;
+int filter_pipeline_threads = 1;
+int filter_pipeline_queue = 0;
+int filter_fuse_pointwise = 1;
+int filter_format_cost = 0;
+int filter_profile = 0;
+char *filter_audio_batch;
 int vstats_version = 2;
 int print_graphs = 0;
 char *print_graphs_file = NULL;
@@ -1719,6 +1725,24 @@ const OptionDef options[] = {
     { "filter_buffered_frames", OPT_TYPE_INT, OPT_EXPERT,
         { &filter_buffered_frames },
         "maximum number of buffered frames in a filter graph" },
+    { "filter_pipeline_threads", OPT_TYPE_INT, OPT_EXPERT,
+        { &filter_pipeline_threads },
+        "maximum number of filters activated concurrently in a filter graph" },
+    { "filter_pipeline_queue",  OPT_TYPE_INT, OPT_EXPERT,
+        { &filter_pipeline_queue },
+        "maximum number of frames queued by a filter running ahead" },
+    { "filter_fuse_pointwise",  OPT_TYPE_BOOL, OPT_EXPERT,
+        { &filter_fuse_pointwise },
+        "run chains of point-wise filters as a single pass" },
+    { "filter_format_cost",     OPT_TYPE_BOOL, OPT_EXPERT,
+        { &filter_format_cost },
+        "pick the formats minimizing the cost of conversions in a filter graph" },
+    { "filter_profile",         OPT_TYPE_BOOL, OPT_EXPERT,
+        { &filter_profile },
+        "collect statistics about the filters and links of filter graphs" },
+    { "filter_audio_batch",     OPT_TYPE_STRING, OPT_EXPERT,
+        { &filter_audio_batch },
+        "minimum duration of audio passed at once to simple audio filters", "duration" },
 #if FFMPEG_OPT_FILTER_SCRIPT
     { "filter_script",          OPT_TYPE_STRING, OPT_PERSTREAM | OPT_EXPERT | OPT_OUTPUT,
         { .off = OFFSET(filter_scripts) },
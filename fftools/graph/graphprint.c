@@ -247,6 +247,7 @@ static void print_hwframescontext(const GraphPrintContext *gpc, const AVHWFrames
 static void print_link(GraphPrintContext *gpc, AVFilterLink *link)
 {
     AVTextFormatContext *tfc = gpc->tfc;
+    const AVFilterLinkStats *stats;
     AVBufferRef *hw_frames_ctx;
     char layout_string[64];
 
@@ -316,6 +317,14 @@ static void print_link(GraphPrintContext *gpc, AVFilterLink *link)
 
     print_fmt_opt("sample_rate", "%d/%d", link->time_base.num, link->time_base.den);
 
+    stats = avfilter_link_get_stats(link);
+    if (stats) {
+        print_int("frames", stats->frames);
+        print_int("bytes", stats->bytes);
+        print_int("max_queued", stats->max_queued);
+        print_int("queue_wait_us", stats->queue_wait);
+    }
+
     if (hw_frames_ctx && hw_frames_ctx->data)
         print_hwframescontext(gpc, (AVHWFramesContext *)hw_frames_ctx->data);
     av_buffer_unref(&hw_frames_ctx);
@@ -380,10 +389,11 @@ static const char *get_filterpad_name(const AVFilterPad *pad)
     return pad ? avfilter_pad_get_name(pad, 0) : "pad";
 }
 
-static void print_filter(GraphPrintContext *gpc, const AVFilterContext *filter, AVDictionary *input_map, AVDictionary *output_map)
+static void print_filter(GraphPrintContext *gpc, AVFilterContext *filter, AVDictionary *input_map, AVDictionary *output_map)
 {
     AVTextFormatContext *tfc = gpc->tfc;
     AVTextFormatSectionContext sec_ctx = { 0 };
+    const AVFilterStats *stats;
 
     print_section_header_id(gpc, SECTION_ID_FILTER, filter->name, 0);
 
@@ -403,6 +413,14 @@ static void print_filter(GraphPrintContext *gpc, const AVFilterContext *filter,
             print_int("extra_hw_frames", filter->extra_hw_frames);
     }
 
+    stats = avfilter_get_stats(filter);
+    if (stats) {
+        print_int("nb_activations", stats->nb_activations);
+        print_int("wall_time_us", stats->wall_time);
+        if (stats->cpu_time >= 0)
+            print_int("cpu_time_us", stats->cpu_time);
+    }
+
     avtext_print_section_header(tfc, NULL, SECTION_ID_FILTER_INPUTS);
 
     for (unsigned i = 0; i < filter->nb_inputs; i++) {
@@ -52,6 +52,12 @@
 #define DURATION_SHORTEST 1
 #define DURATION_FIRST    2
 
+/**
+ * Number of samples of a plane mixed at once. All the inputs are added to
+ * a block while it is in cache, and splitting the planes into blocks lets
+ * several threads work on the same plane. Must be a multiple of 16.
+ */
+#define MIX_BLOCK_SIZE 1024
 
 typedef struct FrameInfo {
     int nb_samples;
@@ -176,8 +182,21 @@ typedef struct MixContext {
     float *scale_norm;          /**< normalization factor for every input */
     int64_t next_pts;           /**< calculated pts for next output frame */
     FrameList *frame_list;      /**< list of frame info for the first input */
+
+    uint8_t *input_data;        /**< samples read from the inputs being mixed */
+    unsigned int input_data_size;
+    uint8_t **input_planes;     /**< planes of input_data, for each input */
+    int *mix_inputs;            /**< indices of the inputs being mixed */
+    int nb_threads;
 } MixContext;
 
+typedef struct ThreadData {
+    AVFrame *out;
+    int nb_mix_inputs;
+    int planes;
+    int plane_size;
+} ThreadData;
+
 #define OFFSET(x) offsetof(MixContext, x)
 #define A AV_OPT_FLAG_AUDIO_PARAM
 #define F AV_OPT_FLAG_FILTERING_PARAM
@@ -277,6 +296,12 @@ static int config_output(AVFilterLink *outlink)
     s->scale_norm  = av_calloc(s->nb_inputs, sizeof(*s->scale_norm));
     if (!s->input_scale || !s->scale_norm)
         return AVERROR(ENOMEM);
+
+    s->nb_threads   = ff_filter_get_nb_threads(ctx);
+    s->input_planes = av_calloc(s->nb_inputs * s->nb_channels, sizeof(*s->input_planes));
+    s->mix_inputs   = av_calloc(s->nb_inputs, sizeof(*s->mix_inputs));
+    if (!s->input_planes || !s->mix_inputs)
+        return AVERROR(ENOMEM);
     for (i = 0; i < s->nb_inputs; i++)
         s->scale_norm[i] = s->weight_sum / FFABS(s->weights[i]);
     calculate_scales(s, 0);
@@ -290,6 +315,41 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+static int mix_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MixContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *out = td->out;
+    const int bps = av_get_bytes_per_sample(out->format);
+    const int nb_blocks = (td->plane_size + MIX_BLOCK_SIZE - 1) / MIX_BLOCK_SIZE;
+    const int nb_units  = td->planes * nb_blocks;
+    const int start = (nb_units *  jobnr     ) / nb_jobs;
+    const int end   = (nb_units * (jobnr + 1)) / nb_jobs;
+
+    for (int u = start; u < end; u++) {
+        const int p   = u / nb_blocks;
+        const int off = (u % nb_blocks) * MIX_BLOCK_SIZE;
+        /* fdsp needs a multiple of 16, the planes are padded for it */
+        const int len = FFALIGN(FFMIN(MIX_BLOCK_SIZE, td->plane_size - off), 16);
+        uint8_t *dst  = out->extended_data[p] + off * bps;
+
+        for (int i = 0; i < td->nb_mix_inputs; i++) {
+            const int in = s->mix_inputs[i];
+            const uint8_t *src = s->input_planes[in * td->planes + p] + off * bps;
+
+            if (out->format == AV_SAMPLE_FMT_FLT ||
+                out->format == AV_SAMPLE_FMT_FLTP)
+                s->fdsp->vector_fmac_scalar((float *)dst, (const float *)src,
+                                            s->input_scale[in], len);
+            else
+                s->fdsp->vector_dmac_scalar((double *)dst, (const double *)src,
+                                            s->input_scale[in], len);
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Read samples from the input FIFOs, mix, and write to the output link.
  */
@@ -297,8 +357,9 @@ static int output_frame(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
-    AVFrame *out_buf, *in_buf;
-    int nb_samples, ns, i;
+    AVFrame *out_buf;
+    ThreadData td;
+    int nb_samples, ns, nb_units, plane_size, i, ret;
 
     if (s->input_state[0] & INPUT_ON) {
         /* first input live: use the corresponding frame size */
@@ -343,40 +404,41 @@ static int output_frame(AVFilterLink *outlink)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, nb_samples);
-    if (!in_buf) {
-        av_frame_free(&out_buf);
-        return AVERROR(ENOMEM);
-    }
+    td.out           = out_buf;
+    td.nb_mix_inputs = 0;
+    td.planes        = s->planar ? s->nb_channels : 1;
+    td.plane_size    = nb_samples * (s->planar ? 1 : s->nb_channels);
+    plane_size       = FFALIGN(td.plane_size, 16) * av_get_bytes_per_sample(outlink->format);
 
     for (i = 0; i < s->nb_inputs; i++) {
         if (s->input_state[i] & INPUT_ON) {
-            int planes, plane_size, p;
+            s->mix_inputs[td.nb_mix_inputs++] = i;
+        }
+    }
 
-            av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
-                               nb_samples);
+    av_fast_malloc(&s->input_data, &s->input_data_size,
+                   (size_t)td.nb_mix_inputs * td.planes * plane_size);
+    if (!s->input_data) {
+        av_frame_free(&out_buf);
+        return AVERROR(ENOMEM);
+    }
 
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
+    /* read all the inputs first, so that they are mixed block by block */
+    for (i = 0; i < td.nb_mix_inputs; i++) {
+        uint8_t **planes = s->input_planes + s->mix_inputs[i] * td.planes;
 
-            if (out_buf->format == AV_SAMPLE_FMT_FLT ||
-                out_buf->format == AV_SAMPLE_FMT_FLTP) {
-                for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                                (float *) in_buf->extended_data[p],
-                                                s->input_scale[i], plane_size);
-                }
-            } else {
-                for (p = 0; p < planes; p++) {
-                    s->fdsp->vector_dmac_scalar((double *)out_buf->extended_data[p],
-                                                (double *) in_buf->extended_data[p],
-                                                s->input_scale[i], plane_size);
-                }
-            }
+        for (int p = 0; p < td.planes; p++)
+            planes[p] = s->input_data + (i * td.planes + p) * plane_size;
+
+        ret = av_audio_fifo_read(s->fifos[s->mix_inputs[i]], (void **)planes, nb_samples);
+        if (ret < 0) {
+            av_frame_free(&out_buf);
+            return ret;
         }
     }
-    av_frame_free(&in_buf);
+
+    nb_units = td.planes * ((td.plane_size + MIX_BLOCK_SIZE - 1) / MIX_BLOCK_SIZE);
+    ff_filter_execute(ctx, mix_slice, &td, NULL, FFMIN(nb_units, s->nb_threads));
 
     out_buf->pts = s->next_pts;
     out_buf->duration = av_rescale_q(out_buf->nb_samples, av_make_q(1, outlink->sample_rate),
@@ -586,6 +648,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->input_state);
     av_freep(&s->input_scale);
     av_freep(&s->scale_norm);
+    av_freep(&s->input_data);
+    av_freep(&s->input_planes);
+    av_freep(&s->mix_inputs);
     av_freep(&s->weights);
     av_freep(&s->fdsp);
 }
@@ -621,7 +686,8 @@ const FFFilter ff_af_amix = {
     .p.description  = NULL_IF_CONFIG_SMALL("Audio mixing."),
     .p.priv_class   = &amix_class,
     .p.inputs       = NULL,
-    .p.flags        = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .p.flags        = AVFILTER_FLAG_DYNAMIC_INPUTS |
+                      AVFILTER_FLAG_SLICE_THREADS,
     .priv_size      = sizeof(MixContext),
     .init           = init,
     .uninit         = uninit,
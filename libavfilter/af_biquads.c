@@ -65,6 +65,7 @@
 #include "config_components.h"
 
 #include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/ffmath.h"
 #include "libavutil/mem.h"
@@ -87,8 +88,13 @@ enum FilterType {
     lowshelf,
     highshelf,
     tiltshelf,
+    multiequalizer,
 };
 
+#define BIQUAD_MAX_SECTIONS 32
+#define BIQUAD_BATCH         2
+#define BIQUAD_BATCH_SAMPLES 256
+
 enum WidthType {
     NONE,
     HERTZ,
@@ -141,6 +147,16 @@ typedef struct BiquadsContext {
     double oa[3];
     double ob[3];
 
+    char *bands_str;
+    double bands[BIQUAD_MAX_SECTIONS][3];
+    int nb_sections;
+
+    double sections_double[BIQUAD_MAX_SECTIONS][5];
+    float  sections_float[BIQUAD_MAX_SECTIONS][5];
+
+    int *batch_ch;
+    int nb_batch_ch;
+
     AVFrame *block[3];
 
     int *clip;
@@ -152,6 +168,8 @@ typedef struct BiquadsContext {
 
     void (*filter)(struct BiquadsContext *s, const void *ibuf, void *obuf, int len,
                    void *cache, int *clip, int disabled);
+    void (*filter_batch)(struct BiquadsContext *s, const AVFrame *in, AVFrame *out,
+                         const int *ch, int nb_ch, int disabled);
 } BiquadsContext;
 
 static int query_formats(const AVFilterContext *ctx,
@@ -279,6 +297,137 @@ BIQUAD_FILTER(s32, int32_t, double, INT32_MIN, INT32_MAX, 1)
 BIQUAD_FILTER(flt, float,   float,  -1.f, 1.f, 0)
 BIQUAD_FILTER(dbl, double,  double, -1.,  1.,  0)
 
+/*
+ * Filter BIQUAD_BATCH channels at once through the whole cascade of direct
+ * form I sections. The recursions of the two channels are independent and
+ * interleaved, so they run in parallel, and the sections are applied one
+ * after another to blocks of BIQUAD_BATCH_SAMPLES samples, which stay in
+ * cache. The operations are done in the same order as in biquad_*(), so a
+ * single section gives the same output.
+ */
+#define BIQUAD_BATCH_STORE_TMP(ftype, out0, out1, i)                          \
+    do {                                                                      \
+        tmp[0][i] = out0;                                                     \
+        tmp[1][i] = out1;                                                     \
+    } while (0)
+
+#define BIQUAD_BATCH_STORE_LANE(k, mixed, in)                                 \
+    do {                                                                      \
+        if (disabled) {                                                       \
+            obuf##k[i] = in;                                                  \
+        } else if (clip && mixed < omin) {                                    \
+            clippings[k]++;                                                   \
+            obuf##k[i] = omin;                                                \
+        } else if (clip && mixed > omax) {                                    \
+            clippings[k]++;                                                   \
+            obuf##k[i] = omax;                                                \
+        } else {                                                              \
+            obuf##k[i] = mixed;                                               \
+        }                                                                     \
+    } while (0)
+
+/* both inputs are read before storing, the buffers may alias */
+#define BIQUAD_BATCH_STORE_OUT(ftype, out0, out1, i)                          \
+    do {                                                                      \
+        const ftype dry0 = ibuf0[i], dry1 = ibuf1[i];                         \
+        const ftype mixed0 = out0 * wet + dry0 * dry;                         \
+        const ftype mixed1 = out1 * wet + dry1 * dry;                         \
+                                                                              \
+        BIQUAD_BATCH_STORE_LANE(0, mixed0, dry0);                             \
+        BIQUAD_BATCH_STORE_LANE(1, mixed1, dry1);                             \
+    } while (0)
+
+#define BIQUAD_BATCH_SECTION(ftype, n, x0, x1, STORE)                         \
+    do {                                                                      \
+        const ftype *c = s->sections_##ftype[n];                              \
+        const ftype b0 = c[0], b1 = c[1], b2 = c[2];                          \
+        const ftype a1 = c[3], a2 = c[4];                                     \
+        ftype *st0 = fcache[0] + 4 * (n);                                     \
+        ftype *st1 = fcache[1] + 4 * (n);                                     \
+        ftype i10 = st0[0], i20 = st0[1], o10 = st0[2], o20 = st0[3];         \
+        ftype i11 = st1[0], i21 = st1[1], o11 = st1[2], o21 = st1[3];         \
+        int i;                                                                \
+                                                                              \
+        for (i = 0; i < nb_samples - last; i++) {                             \
+            const ftype in0 = x0[i], in1 = x1[i];                             \
+            const ftype out0 = i20 * b2 + i10 * b1 + in0 * b0 + o20 * a2 + o10 * a1; \
+            const ftype out1 = i21 * b2 + i11 * b1 + in1 * b0 + o21 * a2 + o11 * a1; \
+                                                                              \
+            i20 = i10; i10 = in0; o20 = o10; o10 = out0;                      \
+            i21 = i11; i11 = in1; o21 = o11; o11 = out1;                      \
+            STORE(ftype, out0, out1, i);                                      \
+        }                                                                     \
+        if (last) {                                                           \
+            const ftype in0 = x0[i], in1 = x1[i];                             \
+            const ftype out0 = in0 * b0 + i10 * b1 + i20 * b2 + o10 * a1 + o20 * a2; \
+            const ftype out1 = in1 * b0 + i11 * b1 + i21 * b2 + o11 * a1 + o21 * a2; \
+                                                                              \
+            i20 = i10; i10 = in0; o20 = o10; o10 = out0;                      \
+            i21 = i11; i11 = in1; o21 = o11; o11 = out1;                      \
+            STORE(ftype, out0, out1, i);                                      \
+        }                                                                     \
+        st0[0] = i10; st0[1] = i20; st0[2] = o10; st0[3] = o20;               \
+        st1[0] = i11; st1[1] = i21; st1[2] = o11; st1[3] = o21;               \
+    } while (0)
+
+#define BIQUAD_BATCH_FILTER(name, type, ftype, min, max, need_clipping)       \
+static void biquad_batch_## name (BiquadsContext *s,                          \
+                                  const AVFrame *in, AVFrame *out,            \
+                                  const int *ch, int nb_ch, int disabled)     \
+{                                                                             \
+    ftype tmp[BIQUAD_BATCH][BIQUAD_BATCH_SAMPLES];                            \
+    ftype pad_cache[4 * BIQUAD_MAX_SECTIONS] = { 0 };                         \
+    type pad[BIQUAD_BATCH_SAMPLES];                                           \
+    int clippings[BIQUAD_BATCH] = { 0 };                                      \
+    const type *ibase[BIQUAD_BATCH];                                          \
+    type *obase[BIQUAD_BATCH];                                                \
+    ftype *fcache[BIQUAD_BATCH];                                              \
+    const int nb_sections = s->nb_sections;                                   \
+    const int len = in->nb_samples;                                           \
+    const int clip = need_clipping;                                           \
+    const type omin = min, omax = max;                                        \
+    ftype wet = s->mix;                                                       \
+    ftype dry = 1. - wet;                                                     \
+                                                                              \
+    /* a missing second channel is filtered from the first one and dropped */ \
+    for (int k = 0; k < BIQUAD_BATCH; k++) {                                  \
+        const int c = ch[FFMIN(k, nb_ch - 1)];                                \
+                                                                              \
+        ibase[k]  = (const type *)in->extended_data[c];                       \
+        obase[k]  = k < nb_ch ? (type *)out->extended_data[c] : NULL;         \
+        fcache[k] = k < nb_ch ? (ftype *)s->cache[0]->extended_data[c] : pad_cache; \
+    }                                                                         \
+                                                                              \
+    for (int offset = 0; offset < len; offset += BIQUAD_BATCH_SAMPLES) {      \
+        const int nb_samples = FFMIN(len - offset, BIQUAD_BATCH_SAMPLES);     \
+        /* the last sample of an odd length frame is computed differently */ \
+        const int last = offset + nb_samples == len && (len & 1);             \
+        const type *ibuf0 = ibase[0] + offset, *ibuf1 = ibase[1] + offset;    \
+        type *obuf0 = obase[0] + offset;                                      \
+        type *obuf1 = obase[1] ? obase[1] + offset : pad;                     \
+        ftype *x0 = tmp[0], *x1 = tmp[1];                                     \
+                                                                              \
+        if (nb_sections == 1) {                                               \
+            BIQUAD_BATCH_SECTION(ftype, 0, ibuf0, ibuf1, BIQUAD_BATCH_STORE_OUT); \
+            continue;                                                         \
+        }                                                                     \
+                                                                              \
+        BIQUAD_BATCH_SECTION(ftype, 0, ibuf0, ibuf1, BIQUAD_BATCH_STORE_TMP); \
+        for (int n = 1; n < nb_sections - 1; n++)                             \
+            BIQUAD_BATCH_SECTION(ftype, n, x0, x1, BIQUAD_BATCH_STORE_TMP);   \
+        BIQUAD_BATCH_SECTION(ftype, nb_sections - 1, x0, x1,                  \
+                             BIQUAD_BATCH_STORE_OUT);                         \
+    }                                                                         \
+                                                                              \
+    for (int k = 0; k < nb_ch; k++)                                           \
+        s->clip[ch[k]] += clippings[k];                                       \
+}
+
+BIQUAD_BATCH_FILTER(s16, int16_t, float,  INT16_MIN, INT16_MAX, 1)
+BIQUAD_BATCH_FILTER(s32, int32_t, double, INT32_MIN, INT32_MAX, 1)
+BIQUAD_BATCH_FILTER(flt, float,   float,  -1.f, 1.f, 0)
+BIQUAD_BATCH_FILTER(dbl, double,  double, -1.,  1.,  0)
+
 #define BIQUAD_DII_FILTER(name, type, ftype, min, max, need_clipping)         \
 static void biquad_dii_## name (BiquadsContext *s,                            \
                             const void *input, void *output, int len,         \
@@ -793,44 +942,36 @@ static void convert_dir2zdf(BiquadsContext *s, int sample_rate)
     s->b_double[2] = m[2];
 }
 
-static int config_filter(AVFilterLink *outlink, int reset)
+static void compute_coefficients(AVFilterContext *ctx, enum FilterType filter_type,
+                                 double frequency, double width, double gain,
+                                 int sample_rate)
 {
-    AVFilterContext *ctx    = outlink->src;
-    BiquadsContext *s       = ctx->priv;
-    AVFilterLink *inlink    = ctx->inputs[0];
-    double gain = s->gain * ((s->filter_type == tiltshelf) + 1.);
-    double A = ff_exp10(gain / 40);
-    double w0 = 2 * M_PI * s->frequency / inlink->sample_rate;
-    double K = tan(w0 / 2.);
-    double alpha, beta;
-
-    s->bypass = (((w0 > M_PI || w0 <= 0.) && reset) || (s->width <= 0.)) && (s->filter_type != biquad);
-    if (s->bypass) {
-        av_log(ctx, AV_LOG_WARNING, "Invalid frequency and/or width!\n");
-        return 0;
-    }
+    BiquadsContext *s = ctx->priv;
+    double A, w0, K, alpha, beta;
 
-    if ((w0 > M_PI || w0 <= 0.) && (s->filter_type != biquad))
-        return AVERROR(EINVAL);
+    gain *= (filter_type == tiltshelf) + 1.;
+    A  = ff_exp10(gain / 40);
+    w0 = 2 * M_PI * frequency / sample_rate;
+    K  = tan(w0 / 2.);
 
     switch (s->width_type) {
     case NONE:
         alpha = 0.0;
         break;
     case HERTZ:
-        alpha = sin(w0) / (2 * s->frequency / s->width);
+        alpha = sin(w0) / (2 * frequency / width);
         break;
     case KHERTZ:
-        alpha = sin(w0) / (2 * s->frequency / (s->width * 1000));
+        alpha = sin(w0) / (2 * frequency / (width * 1000));
         break;
     case OCTAVE:
-        alpha = sin(w0) * sinh(log(2.) / 2 * s->width * w0 / sin(w0));
+        alpha = sin(w0) * sinh(log(2.) / 2 * width * w0 / sin(w0));
         break;
     case QFACTOR:
-        alpha = sin(w0) / (2 * s->width);
+        alpha = sin(w0) / (2 * width);
         break;
     case SLOPE:
-        alpha = sin(w0) / 2 * sqrt((A + 1 / A) * (1 / s->width - 1) + 2);
+        alpha = sin(w0) / 2 * sqrt((A + 1 / A) * (1 / width - 1) + 2);
         break;
     default:
         av_assert0(0);
@@ -838,7 +979,7 @@ static int config_filter(AVFilterLink *outlink, int reset)
 
     beta = 2 * sqrt(A);
 
-    switch (s->filter_type) {
+    switch (filter_type) {
     case biquad:
         s->a_double[0] = s->oa[0];
         s->a_double[1] = s->oa[1];
@@ -1011,19 +1152,84 @@ static int config_filter(AVFilterLink *outlink, int reset)
         s->b_double[2] *= factor;
     }
 
-    switch (s->filter_type) {
+    switch (filter_type) {
     case tiltshelf:
         s->b_double[0] /= A;
         s->b_double[1] /= A;
         s->b_double[2] /= A;
         break;
     }
+}
+
+static void set_section(BiquadsContext *s, int n)
+{
+    s->sections_double[n][0] =  s->b_double[0];
+    s->sections_double[n][1] =  s->b_double[1];
+    s->sections_double[n][2] =  s->b_double[2];
+    s->sections_double[n][3] = -s->a_double[1];
+    s->sections_double[n][4] = -s->a_double[2];
+
+    s->sections_float[n][0] =  (float)s->b_double[0];
+    s->sections_float[n][1] =  (float)s->b_double[1];
+    s->sections_float[n][2] =  (float)s->b_double[2];
+    s->sections_float[n][3] = -(float)s->a_double[1];
+    s->sections_float[n][4] = -(float)s->a_double[2];
+}
+
+static int config_bands(AVFilterContext *ctx, int sample_rate)
+{
+    BiquadsContext *s = ctx->priv;
+
+    for (int n = 0; n < s->nb_sections; n++) {
+        const double frequency = s->bands[n][0];
+        const double width     = s->bands[n][1];
+        const double w0 = 2 * M_PI * frequency / sample_rate;
+
+        if (w0 > M_PI || w0 <= 0. || width <= 0.) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid frequency and/or width for band %d!\n", n);
+            return AVERROR(EINVAL);
+        }
+
+        compute_coefficients(ctx, equalizer, frequency, width, s->bands[n][2], sample_rate);
+        set_section(s, n);
+    }
+
+    return 0;
+}
+
+static int config_filter(AVFilterLink *outlink, int reset)
+{
+    AVFilterContext *ctx    = outlink->src;
+    BiquadsContext *s       = ctx->priv;
+    AVFilterLink *inlink    = ctx->inputs[0];
+    double w0 = 2 * M_PI * s->frequency / inlink->sample_rate;
+
+    if (s->filter_type == multiequalizer) {
+        int ret = config_bands(ctx, inlink->sample_rate);
+        if (ret < 0)
+            return ret;
+    } else {
+        s->bypass = (((w0 > M_PI || w0 <= 0.) && reset) || (s->width <= 0.)) && (s->filter_type != biquad);
+        if (s->bypass) {
+            av_log(ctx, AV_LOG_WARNING, "Invalid frequency and/or width!\n");
+            return 0;
+        }
+
+        if ((w0 > M_PI || w0 <= 0.) && (s->filter_type != biquad))
+            return AVERROR(EINVAL);
+
+        s->nb_sections = 1;
+        compute_coefficients(ctx, s->filter_type, s->frequency, s->width, s->gain,
+                             inlink->sample_rate);
+    }
 
     if (!s->cache[0])
-        s->cache[0] = ff_get_audio_buffer(outlink, 4 * sizeof(double));
+        s->cache[0] = ff_get_audio_buffer(outlink, 4 * sizeof(double) * s->nb_sections);
     if (!s->clip)
         s->clip = av_calloc(outlink->ch_layout.nb_channels, sizeof(*s->clip));
-    if (!s->cache[0] || !s->clip)
+    if (!s->batch_ch)
+        s->batch_ch = av_calloc(outlink->ch_layout.nb_channels, sizeof(*s->batch_ch));
+    if (!s->cache[0] || !s->clip || !s->batch_ch)
         return AVERROR(ENOMEM);
     if (reset) {
         av_samples_set_silence(s->cache[0]->extended_data, 0, s->cache[0]->nb_samples,
@@ -1047,20 +1253,28 @@ static int config_filter(AVFilterLink *outlink, int reset)
         }
     }
 
+    s->filter_batch = NULL;
     switch (s->transform_type) {
     case DI:
         switch (inlink->format) {
+        /* a single integer section is faster with the per channel loop */
         case AV_SAMPLE_FMT_S16P:
             s->filter = biquad_s16;
+            if (s->nb_sections > 1)
+                s->filter_batch = biquad_batch_s16;
             break;
         case AV_SAMPLE_FMT_S32P:
             s->filter = biquad_s32;
+            if (s->nb_sections > 1)
+                s->filter_batch = biquad_batch_s32;
             break;
         case AV_SAMPLE_FMT_FLTP:
             s->filter = biquad_flt;
+            s->filter_batch = biquad_batch_flt;
             break;
         case AV_SAMPLE_FMT_DBLP:
             s->filter = biquad_dbl;
+            s->filter_batch = biquad_batch_dbl;
             break;
         default: av_assert0(0);
         }
@@ -1187,6 +1401,9 @@ static int config_filter(AVFilterLink *outlink, int reset)
     s->b_float[1] = s->b_double[1];
     s->b_float[2] = s->b_double[2];
 
+    if (s->filter_type != multiequalizer)
+        set_section(s, 0);
+
     return 0;
 }
 
@@ -1292,6 +1509,24 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
     return 0;
 }
 
+static int filter_channels_batch(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    BiquadsContext *s = ctx->priv;
+    const int nb_batches = (s->nb_batch_ch + BIQUAD_BATCH - 1) / BIQUAD_BATCH;
+    const int start = (nb_batches * jobnr) / nb_jobs;
+    const int end = (nb_batches * (jobnr+1)) / nb_jobs;
+
+    for (int n = start; n < end; n++) {
+        const int nb_ch = FFMIN(s->nb_batch_ch - n * BIQUAD_BATCH, BIQUAD_BATCH);
+
+        s->filter_batch(s, td->in, td->out, s->batch_ch + n * BIQUAD_BATCH,
+                        nb_ch, ctx->is_disabled);
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *buf, int eof)
 {
     AVFilterContext  *ctx = inlink->dst;
@@ -1326,11 +1561,44 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf, int eof)
 
     if (s->block_samples > 0 && s->pts == AV_NOPTS_VALUE)
         drop = 1;
+    s->nb_batch_ch = 0;
+    if (s->filter_batch && s->block_samples == 0) {
+        for (ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
+            enum AVChannel channel = av_channel_layout_channel_from_index(&inlink->ch_layout, ch);
+
+            if (av_channel_layout_index_from_channel(&s->ch_layout, channel) >= 0)
+                s->batch_ch[s->nb_batch_ch++] = ch;
+        }
+        /* filtering a single section in a partially filled batch is slower */
+        if (s->filter_type != multiequalizer && s->nb_batch_ch < BIQUAD_BATCH)
+            s->nb_batch_ch = 0;
+    }
+
+    if (s->nb_batch_ch > 0 && buf != out_buf) {
+        int i = 0;
+
+        for (ch = 0; ch < inlink->ch_layout.nb_channels; ch++) {
+            if (i < s->nb_batch_ch && s->batch_ch[i] == ch) {
+                i++;
+                continue;
+            }
+            memcpy(out_buf->extended_data[ch], buf->extended_data[ch],
+                   buf->nb_samples * s->block_align);
+        }
+    }
+
     td.in = buf;
     td.out = out_buf;
     td.eof = eof;
-    ff_filter_execute(ctx, filter_channel, &td, NULL,
-                      FFMIN(outlink->ch_layout.nb_channels, ff_filter_get_nb_threads(ctx)));
+    if (s->nb_batch_ch > 0) {
+        const int nb_batches = (s->nb_batch_ch + BIQUAD_BATCH - 1) / BIQUAD_BATCH;
+
+        ff_filter_execute(ctx, filter_channels_batch, &td, NULL,
+                          FFMIN(nb_batches, ff_filter_get_nb_threads(ctx)));
+    } else {
+        ff_filter_execute(ctx, filter_channel, &td, NULL,
+                          FFMIN(outlink->ch_layout.nb_channels, ff_filter_get_nb_threads(ctx)));
+    }
 
     for (ch = 0; ch < outlink->ch_layout.nb_channels; ch++) {
         if (s->clip[ch] > 0)
@@ -1429,6 +1697,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&s->cache[0]);
     av_frame_free(&s->cache[1]);
     av_freep(&s->clip);
+    av_freep(&s->batch_ch);
     av_channel_layout_uninit(&s->ch_layout);
 }
 
@@ -1535,6 +1804,73 @@ static const AVOption equalizer_options[] = {
 
 DEFINE_BIQUAD_FILTER(equalizer, "Apply two-pole peaking equalization (EQ) filter.");
 #endif  /* CONFIG_EQUALIZER_FILTER */
+#if CONFIG_MULTIEQUALIZER_FILTER
+static const AVOption multiequalizer_options[] = {
+    {"bands", "set frequency, width and gain of each band", OFFSET(bands_str), AV_OPT_TYPE_STRING, {.str="1000 1 0"}, 0, 0, AF},
+    WIDTH_TYPE_OPTION(QFACTOR),
+    MIX_CHANNELS_NORMALIZE_OPTION(1, "all", 0),
+    PRECISION_OPTION(-1),
+    {NULL}
+};
+
+AVFILTER_DEFINE_CLASS(multiequalizer);
+
+static av_cold int multiequalizer_init(AVFilterContext *ctx)
+{
+    BiquadsContext *s = ctx->priv;
+    char *bands, *arg, *saveptr = NULL;
+    int ret = 0;
+
+    s->filter_type = multiequalizer;
+    s->pts = AV_NOPTS_VALUE;
+
+    bands = av_strdup(s->bands_str);
+    if (!bands)
+        return AVERROR(ENOMEM);
+
+    for (char *p = bands; (arg = av_strtok(p, "|", &saveptr)); p = NULL) {
+        double *band;
+
+        if (s->nb_sections >= BIQUAD_MAX_SECTIONS) {
+            av_log(ctx, AV_LOG_ERROR, "Too many bands, at most %d are supported.\n",
+                   BIQUAD_MAX_SECTIONS);
+            ret = AVERROR(EINVAL);
+            break;
+        }
+        band = s->bands[s->nb_sections];
+        if (av_sscanf(arg, "%lf %lf %lf", &band[0], &band[1], &band[2]) != 3) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid band '%s'.\n", arg);
+            ret = AVERROR(EINVAL);
+            break;
+        }
+        s->nb_sections++;
+    }
+    av_free(bands);
+
+    if (ret >= 0 && !s->nb_sections) {
+        av_log(ctx, AV_LOG_ERROR, "No bands set.\n");
+        ret = AVERROR(EINVAL);
+    }
+
+    return ret;
+}
+
+const FFFilter ff_af_multiequalizer = {
+    .p.name        = "multiequalizer",
+    .p.description = NULL_IF_CONFIG_SMALL("Apply a cascade of peaking equalization filters."),
+    .p.priv_class  = &multiequalizer_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS |
+                     AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .priv_size     = sizeof(BiquadsContext),
+    .init          = multiequalizer_init,
+    .activate      = activate,
+    .uninit        = uninit,
+    FILTER_INPUTS(ff_audio_default_filterpad),
+    FILTER_OUTPUTS(outputs),
+    FILTER_QUERY_FUNC2(query_formats),
+    .process_command = process_command,
+};
+#endif  /* CONFIG_MULTIEQUALIZER_FILTER */
 #if CONFIG_BASS_FILTER || CONFIG_LOWSHELF_FILTER
 static const AVOption bass_lowshelf_options[] = {
     {"frequency", "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=100}, 0, 999999, FLAGS},
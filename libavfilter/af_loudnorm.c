@@ -44,6 +44,9 @@ enum LimiterState {
     STATE_NB
 };
 
+#define TP_TAPS       12
+#define TP_MAX_FACTOR  4
+
 enum PrintFormat {
     NONE,
     JSON,
@@ -93,6 +96,36 @@ typedef struct LoudNormContext {
     int prev_nb_samples;
     int channels;
 
+    int64_t lookahead;
+
+    /* low-latency mode */
+    int lookahead_samples;
+    int delay;
+    double *delay_buf;
+    int delay_index;
+    double *tp_hist;
+    int tp_hist_index;
+    int tp_factor;
+    double tp_coeffs[TP_MAX_FACTOR - 1][TP_TAPS];
+    double tp_prev_peak;
+    double *min_val;
+    int64_t *min_pos;
+    int min_head;
+    int min_count;
+    double *attack_buf;
+    double attack_sum;
+    int attack_index;
+    double env;
+    double release_coeff;
+    double gain, gain_next, gain_delta;
+    int block_size;
+    int block_pos;
+    int64_t sample_count;
+    int64_t nb_samples_in;
+    int64_t nb_samples_out;
+    int trim;
+    int64_t next_pts;
+
     FFEBUR128State *r128_in;
     FFEBUR128State *r128_out;
 } LoudNormContext;
@@ -121,6 +154,7 @@ static const AVOption loudnorm_options[] = {
     {     "none",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  NONE},     0,         0,  FLAGS, .unit = "print_format" },
     {     "json",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  JSON},     0,         0,  FLAGS, .unit = "print_format" },
     {     "summary",      0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  SUMMARY},  0,         0,  FLAGS, .unit = "print_format" },
+    { "lookahead",        "set lookahead of the low-latency mode", OFFSET(lookahead),    AV_OPT_TYPE_DURATION, {.i64 =  0},      0,   3000000,  FLAGS },
     { NULL }
 };
 
@@ -408,6 +442,230 @@ static void true_peak_limiter(LoudNormContext *s, double *out, int nb_samples, i
     }
 }
 
+static void init_true_peak(LoudNormContext *s, int sample_rate)
+{
+    s->tp_factor = sample_rate < 96000 ? 4 : sample_rate < 192000 ? 2 : 1;
+
+    /* windowed sinc interpolating between the two middle taps, the
+     * history is stored oldest sample first */
+    for (int p = 1; p < s->tp_factor; p++) {
+        for (int j = 0; j < TP_TAPS; j++) {
+            const double x = TP_TAPS / 2 - 1 - j + (double)p / s->tp_factor;
+            const double w = 0.5 * (1.0 + cos(M_PI * x / (TP_TAPS / 2)));
+
+            s->tp_coeffs[p - 1][j] = sin(M_PI * x) / (M_PI * x) * w;
+        }
+    }
+}
+
+static void update_gain(LoudNormContext *s, int sample_rate)
+{
+    const int64_t elapsed = s->nb_samples_in * 1000 / sample_rate;
+    double loudness, global, relative_threshold, env_global, delta;
+
+    s->gain = s->gain_next;
+
+    /* wait for the first gating block */
+    if (elapsed < 400)
+        return;
+
+    ff_ebur128_loudness_window(s->r128_in, FFMIN(elapsed, 3000), &loudness);
+    ff_ebur128_loudness_global(s->r128_in, &global);
+    ff_ebur128_relative_threshold(s->r128_in, &relative_threshold);
+
+    if (loudness < relative_threshold || loudness <= -70.)
+        return;
+
+    env_global = fabs(loudness - global) < (s->target_lra / 2.) ? loudness - global : (s->target_lra / 2.) * ((loudness - global) < 0 ? -1 : 1);
+    delta = pow(10., (env_global + s->target_i - loudness) / 20.);
+
+    /* causal counterpart of the gaussian smoothing of the 3 s mode */
+    s->gain_delta += (delta - s->gain_delta) * (1. - exp(-1. / 3.5));
+    s->gain_next   = s->gain_delta;
+}
+
+/**
+ * Apply the gain and the true peak limiter of the low-latency mode.
+ *
+ * The output is delayed by s->delay samples: the lookahead of the limiter
+ * plus half the length of the true peak interpolator. If src is NULL, the
+ * input is silence, which is used to flush the delay line.
+ */
+static void process_low_latency(LoudNormContext *s, double *dst, const double *src,
+                                int nb_samples, int sample_rate)
+{
+    const int channels = s->channels;
+    const int lookahead = s->lookahead_samples;
+    const double ceiling = s->target_tp;
+    int n = 0;
+
+    while (n < nb_samples) {
+        const int chunk = FFMIN(nb_samples - n, s->block_size - s->block_pos);
+
+        if (src) {
+            ff_ebur128_add_frames_double(s->r128_in, src + n * channels, chunk);
+            s->nb_samples_in += chunk;
+        }
+
+        for (int i = n; i < n + chunk; i++) {
+            const double gain = (s->gain + (s->gain_next - s->gain) * s->block_pos++ / s->block_size) * s->offset;
+            double *delayed = s->delay_buf + s->delay_index * channels;
+            double peak = 0., inter_peak = 0., req, m, env;
+
+            for (int c = 0; c < channels; c++) {
+                const double x = src ? src[i * channels + c] : 0.;
+                const double y = x * gain;
+                double *hist = s->tp_hist + c * 2 * TP_TAPS;
+
+                dst[i * channels + c] = delayed[c];
+                delayed[c] = y;
+
+                hist[s->tp_hist_index] = hist[s->tp_hist_index + TP_TAPS] = y;
+            }
+            s->tp_hist_index = s->tp_hist_index + 1 < TP_TAPS ? s->tp_hist_index + 1 : 0;
+            s->delay_index = s->delay_index + 1 < s->delay ? s->delay_index + 1 : 0;
+
+            /* true peak of the sample in the middle of the interpolator */
+            for (int c = 0; c < channels; c++) {
+                const double *hist = s->tp_hist + c * 2 * TP_TAPS + s->tp_hist_index;
+
+                peak = FFMAX(peak, fabs(hist[TP_TAPS / 2 - 1]));
+                for (int p = 0; p < s->tp_factor - 1; p++) {
+                    double v = 0.;
+
+                    for (int j = 0; j < TP_TAPS; j++)
+                        v += hist[j] * s->tp_coeffs[p][j];
+                    inter_peak = FFMAX(inter_peak, fabs(v));
+                }
+            }
+            peak = FFMAX3(peak, inter_peak, s->tp_prev_peak);
+            s->tp_prev_peak = inter_peak;
+            req = peak > ceiling ? ceiling / peak : 1.;
+
+            /* minimum of the required gain over the lookahead; the entry
+             * leaving the window is dropped before the new one is queued,
+             * so that a rising level never fills the queue */
+            if (s->min_count > 0 && s->min_pos[s->min_head] <= s->sample_count - lookahead) {
+                s->min_head = s->min_head + 1 < lookahead ? s->min_head + 1 : 0;
+                s->min_count--;
+            }
+            while (s->min_count > 0) {
+                const int back = (s->min_head + s->min_count - 1) % lookahead;
+                if (s->min_val[back] < req)
+                    break;
+                s->min_count--;
+            }
+            s->min_val[(s->min_head + s->min_count) % lookahead] = req;
+            s->min_pos[(s->min_head + s->min_count) % lookahead] = s->sample_count;
+            s->min_count++;
+            m = s->min_val[s->min_head];
+            s->sample_count++;
+
+            /* averaging the minimum over the lookahead ramps the gain down
+             * in time for the peak */
+            s->attack_sum += m - s->attack_buf[s->attack_index];
+            s->attack_buf[s->attack_index] = m;
+            s->attack_index = s->attack_index + 1 < lookahead ? s->attack_index + 1 : 0;
+
+            env = s->env + (1. - s->env) * s->release_coeff;
+            env = s->env = FFMIN(env, s->attack_sum / lookahead);
+
+            for (int c = 0; c < channels; c++) {
+                double *out = dst + i * channels + c;
+
+                *out *= env;
+                if (fabs(*out) > ceiling)
+                    *out = ceiling * (*out < 0 ? -1 : 1);
+            }
+        }
+
+        n += chunk;
+        if (s->block_pos == s->block_size) {
+            s->block_pos = 0;
+            update_gain(s, sample_rate);
+        }
+    }
+}
+
+static int output_low_latency(AVFilterLink *outlink, AVFrame *out, int64_t max_samples)
+{
+    AVFilterContext *ctx = outlink->src;
+    LoudNormContext *s = ctx->priv;
+    double *dst = (double *)out->data[0];
+    const int trim = FFMIN(s->trim, out->nb_samples);
+
+    if (trim > 0) {
+        memmove(dst, dst + trim * s->channels,
+                (out->nb_samples - trim) * s->channels * sizeof(*dst));
+        out->nb_samples -= trim;
+        s->trim -= trim;
+    }
+    out->nb_samples = FFMIN(out->nb_samples, max_samples);
+    if (!out->nb_samples) {
+        av_frame_free(&out);
+        return 0;
+    }
+
+    ff_ebur128_add_frames_double(s->r128_out, dst, out->nb_samples);
+
+    out->pts      = s->next_pts;
+    out->duration = av_rescale_q(out->nb_samples, av_make_q(1, outlink->sample_rate),
+                                 outlink->time_base);
+    if (s->next_pts != AV_NOPTS_VALUE)
+        s->next_pts += out->duration;
+    s->nb_samples_out += out->nb_samples;
+
+    return ff_filter_frame(outlink, out);
+}
+
+static int filter_frame_low_latency(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    LoudNormContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFrame *out;
+
+    if (av_frame_is_writable(in)) {
+        out = in;
+    } else {
+        out = ff_get_audio_buffer(outlink, in->nb_samples);
+        if (!out) {
+            av_frame_free(&in);
+            return AVERROR(ENOMEM);
+        }
+        av_frame_copy_props(out, in);
+    }
+
+    if (s->next_pts == AV_NOPTS_VALUE)
+        s->next_pts = in->pts;
+
+    process_low_latency(s, (double *)out->data[0], (const double *)in->data[0],
+                        in->nb_samples, inlink->sample_rate);
+
+    if (in != out)
+        av_frame_free(&in);
+    return output_low_latency(outlink, out, INT64_MAX);
+}
+
+static int flush_low_latency(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    LoudNormContext *s = ctx->priv;
+    const int64_t pending = s->nb_samples_in - s->nb_samples_out;
+    AVFrame *out;
+
+    if (pending <= 0)
+        return 0;
+
+    out = ff_get_audio_buffer(outlink, s->delay);
+    if (!out)
+        return AVERROR(ENOMEM);
+
+    process_low_latency(s, (double *)out->data[0], NULL, s->delay, outlink->sample_rate);
+
+    return output_low_latency(outlink, out, pending);
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -686,6 +944,26 @@ static int activate(AVFilterContext *ctx)
 
     FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
 
+    if (s->lookahead && s->frame_type != LINEAR_MODE) {
+        ret = ff_inlink_consume_frame(inlink, &in);
+        if (ret < 0)
+            return ret;
+        if (ret > 0)
+            return filter_frame_low_latency(inlink, in);
+
+        if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+            ret = flush_low_latency(outlink);
+            if (ret < 0)
+                return ret;
+            ff_outlink_set_status(outlink, status, s->next_pts != AV_NOPTS_VALUE ? s->next_pts : pts);
+            return 0;
+        }
+
+        FF_FILTER_FORWARD_WANTED(outlink, inlink);
+
+        return FFERROR_NOT_READY;
+    }
+
     if (s->frame_type != LINEAR_MODE) {
         int nb_samples;
 
@@ -744,7 +1022,7 @@ static int query_formats(const AVFilterContext *ctx,
     if (ret < 0)
         return ret;
 
-    if (s->frame_type != LINEAR_MODE) {
+    if (s->frame_type != LINEAR_MODE && !s->lookahead) {
         return ff_set_common_samplerates_from_list2(ctx, cfg_in, cfg_out, input_srate);
     }
     return 0;
@@ -795,6 +1073,33 @@ static int config_input(AVFilterLink *inlink)
     s->attack_length = frame_size(inlink->sample_rate, 10);
     s->release_length = frame_size(inlink->sample_rate, 100);
 
+    if (s->lookahead) {
+        const int lookahead = FFMAX(av_rescale(s->lookahead, inlink->sample_rate, AV_TIME_BASE), 1);
+
+        s->lookahead_samples = lookahead;
+        s->delay = lookahead + TP_TAPS / 2 - 1;
+        s->delay_buf  = av_calloc(s->delay * s->channels, sizeof(*s->delay_buf));
+        s->tp_hist    = av_calloc(2 * TP_TAPS * s->channels, sizeof(*s->tp_hist));
+        s->min_val    = av_calloc(lookahead, sizeof(*s->min_val));
+        s->min_pos    = av_calloc(lookahead, sizeof(*s->min_pos));
+        s->attack_buf = av_malloc_array(lookahead, sizeof(*s->attack_buf));
+        if (!s->delay_buf || !s->tp_hist || !s->min_val || !s->min_pos || !s->attack_buf)
+            return AVERROR(ENOMEM);
+
+        for (int i = 0; i < lookahead; i++)
+            s->attack_buf[i] = 1.;
+        s->attack_sum = lookahead;
+        s->env = 1.;
+        s->release_coeff = 1. - exp(-1. / s->release_length);
+        init_true_peak(s, inlink->sample_rate);
+
+        s->block_size = frame_size(inlink->sample_rate, 100);
+        s->gain_delta = s->measured_i ? pow(10., (s->target_i - s->measured_i) / 20.) : 1.;
+        s->gain = s->gain_next = s->gain_delta;
+        s->trim = s->delay;
+        s->next_pts = AV_NOPTS_VALUE;
+    }
+
     return 0;
 }
 
@@ -803,6 +1108,11 @@ static av_cold int init(AVFilterContext *ctx)
     LoudNormContext *s = ctx->priv;
     s->frame_type = FIRST_FRAME;
 
+    if (s->lookahead && s->lookahead < 10000) {
+        av_log(ctx, AV_LOG_ERROR, "lookahead must be at least 10 ms.\n");
+        return AVERROR(EINVAL);
+    }
+
     if (s->linear) {
         double offset, offset_tp;
         offset    = s->target_i - s->measured_i;
@@ -916,6 +1226,11 @@ end:
     av_freep(&s->limiter_buf);
     av_freep(&s->prev_smp);
     av_freep(&s->buf);
+    av_freep(&s->delay_buf);
+    av_freep(&s->tp_hist);
+    av_freep(&s->min_val);
+    av_freep(&s->min_pos);
+    av_freep(&s->attack_buf);
 }
 
 static const AVFilterPad avfilter_af_loudnorm_inputs[] = {
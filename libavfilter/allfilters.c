@@ -142,6 +142,7 @@ extern const FFFilter ff_af_lowpass;
 extern const FFFilter ff_af_lowshelf;
 extern const FFFilter ff_af_lv2;
 extern const FFFilter ff_af_mcompand;
+extern const FFFilter ff_af_multiequalizer;
 extern const FFFilter ff_af_pan;
 extern const FFFilter ff_af_replaygain;
 extern const FFFilter ff_af_rubberband;
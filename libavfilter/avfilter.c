@@ -19,6 +19,10 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#include <time.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
@@ -28,12 +32,14 @@
 #include "libavutil/eval.h"
 #include "libavutil/frame.h"
 #include "libavutil/hwcontext.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #include "audio.h"
 #include "avfilter.h"
@@ -229,7 +235,11 @@ static void update_link_current_pts(FilterLinkInternal *li, int64_t pts)
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
     FFFilterContext *ctxi = fffilterctx(filter);
-    ctxi->ready = FFMAX(ctxi->ready, priority);
+    if (priority <= ctxi->ready)
+        return;
+    ctxi->ready = priority;
+    if (filter->graph)
+        ff_filter_graph_update_ready(filter->graph, filter);
 }
 
 /**
@@ -621,9 +631,18 @@ int avfilter_process_command(AVFilterContext *filter, const char *cmd, const cha
             av_log(filter, AV_LOG_INFO, "%s", res);
         return 0;
     }else if(!strcmp(cmd, "enable")) {
-        return set_enable_expr(fffilterctx(filter), arg);
+        int ret = set_enable_expr(fffilterctx(filter), arg);
+        if (ret >= 0 && fffilterctx(filter)->pointwise_host)
+            ret = ff_graph_fuse_pointwise(fffiltergraph(filter->graph));
+        return ret;
     }else if (fffilter(filter->filter)->process_command) {
-        return fffilter(filter->filter)->process_command(filter, cmd, arg, res, res_len, flags);
+        int ret = fffilter(filter->filter)->process_command(filter, cmd, arg, res, res_len, flags);
+        /* the lookup tables of a fused chain may have changed */
+        if (ret >= 0 && fffilter(filter->filter)->get_lut && filter->graph &&
+            fffiltergraph(filter->graph)->sink_links &&
+            !fffiltergraph(filter->graph)->pipeline)
+            ret = ff_graph_fuse_pointwise(fffiltergraph(filter->graph));
+        return ret;
     }
     return AVERROR(ENOSYS);
 }
@@ -712,6 +731,7 @@ AVFilterContext *ff_filter_alloc(const AVFilter *filter, const char *inst_name)
     if (!ctx)
         return NULL;
     ret = &ctx->p;
+    ctx->ready_level = -1;
 
     ret->av_class = &avfilter_class;
     ret->filter   = filter;
@@ -849,6 +869,15 @@ int ff_filter_get_nb_threads(AVFilterContext *ctx)
     return ctx->graph->nb_threads;
 }
 
+int ff_filter_get_nb_jobs(AVFilterContext *ctx, int max_jobs)
+{
+    int64_t nb_jobs = ff_filter_get_nb_threads(ctx);
+
+    if (nb_jobs > 1)
+        nb_jobs *= fffiltergraph(ctx->graph)->jobs_per_thread;
+    return FFMAX(1, FFMIN(max_jobs, nb_jobs));
+}
+
 int ff_filter_opt_parse(void *logctx, const AVClass *priv_class,
                         AVDictionary **options, const char *args)
 {
@@ -1037,13 +1066,15 @@ static int filter_frame_framed(AVFilterLink *link, AVFrame *frame)
     FilterLink *l = ff_filter_link(link);
     int (*filter_frame)(AVFilterLink *, AVFrame *);
     AVFilterContext *dstctx = link->dst;
+    FFFilterContext *dsti = fffilterctx(dstctx);
     AVFilterPad *dst = link->dstpad;
     int ret;
 
     if (!(filter_frame = dst->filter_frame))
         filter_frame = default_filter_frame;
 
-    if (dst->flags & AVFILTERPAD_FLAG_NEEDS_WRITABLE) {
+    if (dst->flags & AVFILTERPAD_FLAG_NEEDS_WRITABLE &&
+        (!dsti->pointwise_host || dsti->pointwise_host == dstctx)) {
         ret = ff_inlink_make_frame_writable(link, &frame);
         if (ret < 0)
             goto fail;
@@ -1055,6 +1086,9 @@ static int filter_frame_framed(AVFilterLink *link, AVFrame *frame)
     if (dstctx->is_disabled &&
         (dstctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC))
         filter_frame = default_filter_frame;
+    /* processed by the host of its fused point-wise chain */
+    if (dsti->pointwise_host && dsti->pointwise_host != dstctx)
+        filter_frame = default_filter_frame;
     ret = filter_frame(link, frame);
     l->frame_count_out++;
     return ret;
@@ -1064,6 +1098,38 @@ fail:
     return ret;
 }
 
+static int link_profiling(FilterLinkInternal *li)
+{
+    return li->l.graph && fffiltergraph(li->l.graph)->profile;
+}
+
+static int64_t frame_data_size(const AVFrame *frame)
+{
+    int size = 0;
+
+    if (frame->width && frame->height)
+        size = av_image_get_buffer_size(frame->format, frame->width,
+                                        frame->height, 1);
+    else if (frame->nb_samples)
+        size = av_samples_get_buffer_size(NULL, frame->ch_layout.nb_channels,
+                                          frame->nb_samples, frame->format, 1);
+    return FFMAX(size, 0);
+}
+
+/**
+ * Account for the time the currently queued frames spent on the link; must
+ * be called before any change to the queue.
+ */
+static void link_profile_queue(FilterLinkInternal *li)
+{
+    int64_t now = av_gettime_relative();
+
+    if (li->queue_last)
+        li->queue_area += (now - li->queue_last) *
+                          (int64_t)ff_framequeue_queued_frames(&li->fifo);
+    li->queue_last = now;
+}
+
 int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
 {
     FilterLinkInternal * const li = ff_link_internal(link);
@@ -1108,11 +1174,19 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
     li->l.frame_count_in++;
     li->l.sample_count_in += frame->nb_samples;
     filter_unblock(link->dst);
+    if (link_profiling(li)) {
+        li->stats.frames++;
+        li->stats.bytes += frame_data_size(frame);
+        link_profile_queue(li);
+    }
     ret = ff_framequeue_add(&li->fifo, frame);
     if (ret < 0) {
         av_frame_free(&frame);
         return ret;
     }
+    if (link_profiling(li))
+        li->stats.max_queued = FFMAX(li->stats.max_queued,
+                                     ff_framequeue_queued_frames(&li->fifo));
     ff_filter_set_ready(link->dst, 300);
     return 0;
 
@@ -1140,6 +1214,8 @@ static int take_samples(FilterLinkInternal *li, unsigned min, unsigned max,
     /* Note: this function relies on no format changes and must only be
        called with enough samples. */
     av_assert1(samples_ready(li, l->min_samples));
+    if (link_profiling(li))
+        link_profile_queue(li);
     frame0 = frame = ff_framequeue_peek(&li->fifo, 0);
     if (!li->fifo.samples_skipped && frame->nb_samples >= min && frame->nb_samples <= max) {
         *rframe = ff_framequeue_take(&li->fifo);
@@ -1197,9 +1273,14 @@ static int filter_frame_to_filter(AVFilterLink *link)
     int ret;
 
     av_assert1(ff_framequeue_queued_frames(&li->fifo));
-    ret = li->l.min_samples ?
-          ff_inlink_consume_samples(link, li->l.min_samples, li->l.max_samples, &frame) :
-          ff_inlink_consume_frame(link, &frame);
+    if (li->l.min_samples)
+        ret = ff_inlink_consume_samples(link, li->l.min_samples, li->l.max_samples, &frame);
+    else if (li->batch_samples &&
+             ff_framequeue_peek(&li->fifo, 0)->nb_samples < li->batch_samples)
+        ret = ff_inlink_consume_samples(link, li->batch_samples,
+                                        2 * li->batch_samples, &frame);
+    else
+        ret = ff_inlink_consume_frame(link, &frame);
     av_assert1(ret);
     if (ret < 0) {
         av_assert1(!frame);
@@ -1272,7 +1353,7 @@ static int filter_activate_default(AVFilterContext *filter)
 
     for (i = 0; i < filter->nb_inputs; i++) {
         FilterLinkInternal *li = ff_link_internal(filter->inputs[i]);
-        if (samples_ready(li, li->l.min_samples)) {
+        if (samples_ready(li, li->l.min_samples ? li->l.min_samples : li->batch_samples)) {
             return filter_frame_to_filter(filter->inputs[i]);
         }
     }
@@ -1445,6 +1526,20 @@ static int filter_activate_default(AVFilterContext *filter)
      input, so we need to do it for them.
  */
 
+/**
+ * @return the CPU time used by the calling thread in microseconds, or -1
+ */
+static int64_t thread_cpu_time(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    return -1;
+}
+
 int ff_filter_activate(AVFilterContext *filter)
 {
     FFFilterContext *ctxi = fffilterctx(filter);
@@ -1455,12 +1550,62 @@ int ff_filter_activate(AVFilterContext *filter)
     av_assert1(!(fi->p.flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  fi->activate));
     ctxi->ready = 0;
-    ret = fi->activate ? fi->activate(filter) : filter_activate_default(filter);
+    if (filter->graph)
+        ff_filter_graph_update_ready(filter->graph, filter);
+    if (filter->graph && fffiltergraph(filter->graph)->profile) {
+        int64_t wall = av_gettime_relative(), cpu = thread_cpu_time();
+
+        ret = fi->activate ? fi->activate(filter) : filter_activate_default(filter);
+
+        ctxi->stats.nb_activations++;
+        ctxi->stats.wall_time += av_gettime_relative() - wall;
+        if (cpu >= 0 && ctxi->stats.cpu_time >= 0)
+            ctxi->stats.cpu_time += thread_cpu_time() - cpu;
+        else
+            ctxi->stats.cpu_time = -1;
+    } else {
+        ret = fi->activate ? fi->activate(filter) : filter_activate_default(filter);
+    }
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
 }
 
+const AVFilterStats *avfilter_get_stats(AVFilterContext *filter)
+{
+    AVFilterStats *stats = &fffilterctx(filter)->stats;
+
+    if (!filter->graph || !fffiltergraph(filter->graph)->profile)
+        return NULL;
+
+    stats->frames_in  = stats->bytes_in  = 0;
+    stats->frames_out = stats->bytes_out = 0;
+    for (unsigned i = 0; i < filter->nb_inputs; i++) {
+        const FilterLinkInternal *li = ff_link_internal(filter->inputs[i]);
+        stats->frames_in += li->stats.frames;
+        stats->bytes_in  += li->stats.bytes;
+    }
+    for (unsigned i = 0; i < filter->nb_outputs; i++) {
+        const FilterLinkInternal *li = ff_link_internal(filter->outputs[i]);
+        stats->frames_out += li->stats.frames;
+        stats->bytes_out  += li->stats.bytes;
+    }
+    return stats;
+}
+
+const AVFilterLinkStats *avfilter_link_get_stats(AVFilterLink *link)
+{
+    FilterLinkInternal *li = ff_link_internal(link);
+
+    if (!link_profiling(li))
+        return NULL;
+
+    link_profile_queue(li);
+    li->stats.queued     = ff_framequeue_queued_frames(&li->fifo);
+    li->stats.queue_wait = li->stats.frames ? li->queue_area / li->stats.frames : 0;
+    return &li->stats;
+}
+
 int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
 {
     FilterLinkInternal * const li = ff_link_internal(link);
@@ -1528,6 +1673,8 @@ int ff_inlink_consume_frame(AVFilterLink *link, AVFrame **rframe)
         return ff_inlink_consume_samples(link, frame->nb_samples, frame->nb_samples, rframe);
     }
 
+    if (link_profiling(li))
+        link_profile_queue(li);
     frame = ff_framequeue_take(&li->fifo);
     consume_update(li, frame);
     *rframe = frame;
@@ -1595,6 +1742,7 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
         av_frame_free(&out);
         return ret;
     }
+    ff_filter_link(link)->frame_copies++;
 
     av_frame_free(&frame);
     *rframe = out;
@@ -1634,6 +1782,8 @@ void ff_inlink_set_status(AVFilterLink *link, int status)
     li->frame_wanted_out = 0;
     li->frame_blocked_in = 0;
     link_set_out_status(link, status, AV_NOPTS_VALUE);
+    if (link_profiling(li))
+        link_profile_queue(li);
     while (ff_framequeue_queued_frames(&li->fifo)) {
            AVFrame *frame = ff_framequeue_take(&li->fifo);
            av_frame_free(&frame);
@@ -475,6 +475,83 @@ int avfilter_link(AVFilterContext *src, unsigned srcpad,
  */
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags);
 
+/**
+ * Statistics of a filter, collected while the "profile" option of its graph
+ * is enabled.
+ */
+typedef struct AVFilterStats {
+    /**
+     * Number of times the filter was activated.
+     */
+    int64_t nb_activations;
+    /**
+     * Total duration of the activations, in microseconds.
+     */
+    int64_t wall_time;
+    /**
+     * CPU time used by the threads running the activations, in
+     * microseconds, or -1 if not available. The work done in slice threads
+     * is not included.
+     */
+    int64_t cpu_time;
+    /**
+     * Number of frames and bytes of frame data sent to the filter on its
+     * inputs.
+     */
+    int64_t frames_in, bytes_in;
+    /**
+     * Number of frames and bytes of frame data sent by the filter on its
+     * outputs.
+     */
+    int64_t frames_out, bytes_out;
+} AVFilterStats;
+
+/**
+ * Statistics of a link, collected while the "profile" option of its graph
+ * is enabled.
+ */
+typedef struct AVFilterLinkStats {
+    /**
+     * Number of frames and bytes of frame data sent on the link.
+     */
+    int64_t frames, bytes;
+    /**
+     * Number of frames currently queued on the link.
+     */
+    int64_t queued;
+    /**
+     * Maximum number of frames queued on the link at once.
+     */
+    int64_t max_queued;
+    /**
+     * Average time the frames sent on the link spent queued on it, in
+     * microseconds.
+     */
+    int64_t queue_wait;
+} AVFilterLinkStats;
+
+/**
+ * Get the statistics of a filter.
+ *
+ * Must not be called while the graph of the filter is being run from
+ * another thread.
+ *
+ * @return the statistics, valid until the filter is freed and updated on
+ *         each call, or NULL if profiling is not enabled for its graph
+ */
+const AVFilterStats *avfilter_get_stats(AVFilterContext *filter);
+
+/**
+ * Get the statistics of a link.
+ *
+ * Must not be called while the graph of the link is being run from another
+ * thread.
+ *
+ * @return the statistics, valid until the link is freed and updated on each
+ *         call, or NULL if profiling is not enabled for its graph
+ */
+const AVFilterLinkStats *avfilter_link_get_stats(AVFilterLink *link);
+
 /**
  * Iterate over all registered filters.
  *
@@ -1189,7 +1266,13 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
  * Dump a graph into a human-readable string representation.
  *
  * @param graph    the graph to dump
- * @param options  formatting options; currently ignored
+ * @param options  formatting options, as a comma-separated list of flags, or
+ *                 NULL; "stats" adds to each link whether the frames sent on
+ *                 it are modified in place downstream ("write") and how many
+ *                 of them had to be copied for it ("copies"), and, if the
+ *                 graph has the "profile" option set, the statistics
+ *                 returned by avfilter_get_stats() and
+ *                 avfilter_link_get_stats()
  * @return  a string, or NULL in case of memory allocation failure;
  *          the string must be freed using av_free
  */
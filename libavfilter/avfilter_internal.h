@@ -27,6 +27,8 @@
 
 #include <stdint.h>
 
+#include "libavutil/thread.h"
+
 #include "avfilter.h"
 #include "filters.h"
 #include "framequeue.h"
@@ -85,6 +87,23 @@ typedef struct FilterLinkInternal {
         AVLINK_STARTINIT,       ///< started, but incomplete
         AVLINK_INIT             ///< complete
     } init_state;
+
+    /**
+     * Statistics collected when profiling, see avfilter_link_get_stats().
+     * queue_area is the sum over time of the number of queued frames, in
+     * frames times microseconds, up to queue_last.
+     */
+    AVFilterLinkStats stats;
+    int64_t queue_area;
+    int64_t queue_last;
+
+    /**
+     * Minimum number of samples passed at once to the filter_frame()
+     * callback of the destination when it does not set min_samples itself,
+     * set from the audio_batch option of the graph; 0 to pass the frames
+     * as they are queued.
+     */
+    int batch_samples;
 } FilterLinkInternal;
 
 static inline FilterLinkInternal *ff_link_internal(AVFilterLink *link)
@@ -110,6 +129,31 @@ typedef struct FFFilterContext {
      */
     unsigned ready;
 
+    /**
+     * Index of the graph ready queue this filter is queued in,
+     * or -1 if it is not queued.
+     */
+    int ready_level;
+    struct FFFilterContext *ready_prev, *ready_next;
+
+    /**
+     * Index of the last pipeline batch this filter was found to be within
+     * two links of a filter of; see ff_filter_graph_run_once().
+     */
+    unsigned pipeline_mark;
+
+    /**
+     * Filter of the fused point-wise chain this filter belongs to, which
+     * applies the lookup tables of the whole chain; other members of the
+     * chain pass frames through unchanged.
+     */
+    AVFilterContext *pointwise_host;
+
+    /**
+     * Statistics collected when profiling, see avfilter_get_stats().
+     */
+    AVFilterStats stats;
+
     /// parsed expression
     struct AVExpr *enable;
     /// variable values for the enable expression
@@ -131,6 +175,19 @@ typedef struct AVFilterCommand {
     struct AVFilterCommand *next;
 } AVFilterCommand;
 
+/**
+ * Maximum number of distinct ready priorities the graph can schedule.
+ */
+#define FF_FILTER_READY_LEVELS 8
+
+/**
+ * FIFO of the filters sharing the same ready priority.
+ */
+typedef struct FFFilterReadyQueue {
+    unsigned priority;
+    FFFilterContext *head, *tail;
+} FFFilterReadyQueue;
+
 typedef struct FFFilterGraph {
     /**
      * The public AVFilterGraph. See avfilter.h for it.
@@ -145,6 +202,41 @@ typedef struct FFFilterGraph {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Filters with a non-0 ready status, bucketed by priority, so that
+     * the next filter to activate can be found without scanning the graph.
+     * Buckets are created on first use and never removed.
+     */
+    FFFilterReadyQueue ready_queues[FF_FILTER_READY_LEVELS];
+    int nb_ready_queues;
+
+    /**
+     * Pipeline threading: number of filters that may be activated
+     * concurrently, and maximum number of frames queued on the outputs of a
+     * filter for it to run ahead of the most urgent filter.
+     */
+    int pipeline_threads;
+    int pipeline_queue;
+
+    void *pipeline;
+    unsigned pipeline_batch;
+    /**
+     * Set while a batch of filters is running concurrently; the graph-wide
+     * scheduling state must then be accessed under pipeline_lock.
+     */
+    int pipeline_active;
+    AVMutex pipeline_lock;
+    /**
+     * Number of activations run concurrently with another one, for testing.
+     */
+    unsigned pipeline_overlapped;
+
+    int fuse_pointwise;
+    int format_cost;
+    int profile;
+    int64_t audio_batch;
+    int jobs_per_thread;
 } FFFilterGraph;
 
 static inline FFFilterGraph *fffiltergraph(AVFilterGraph *graph)
@@ -152,6 +244,18 @@ static inline FFFilterGraph *fffiltergraph(AVFilterGraph *graph)
     return (FFFilterGraph*)graph;
 }
 
+static inline void ff_graph_lock(FFFilterGraph *graphi)
+{
+    if (graphi->pipeline_active)
+        ff_mutex_lock(&graphi->pipeline_lock);
+}
+
+static inline void ff_graph_unlock(FFFilterGraph *graphi)
+{
+    if (graphi->pipeline_active)
+        ff_mutex_unlock(&graphi->pipeline_lock);
+}
+
 /**
  * Update the position of a link in the age heap.
  */
@@ -175,6 +279,12 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
 
 int ff_filter_activate(AVFilterContext *filter);
 
+/**
+ * Queue a filter in the ready queue of its graph matching its current
+ * ready status, or dequeue it if the status is 0.
+ */
+void ff_filter_graph_update_ready(AVFilterGraph *graph, AVFilterContext *filter);
+
 /**
  * Parse filter options into a dictionary.
  *
@@ -190,8 +300,26 @@ int ff_filter_opt_parse(void *logctx, const AVClass *priv_class,
 
 int ff_graph_thread_init(FFFilterGraph *graph);
 
+/**
+ * (Re)detect chains of consecutive point-wise filters in a configured graph
+ * and make each of them run as a single lookup table pass, then update the
+ * write intent of the links accordingly.
+ */
+int ff_graph_fuse_pointwise(FFFilterGraph *graph);
+
 void ff_graph_thread_free(FFFilterGraph *graph);
 
+int ff_graph_pipeline_init(FFFilterGraph *graph);
+
+void ff_graph_pipeline_free(FFFilterGraph *graph);
+
+/**
+ * Activate the given filters concurrently and store the return value of
+ * ff_filter_activate() for each of them in rets.
+ */
+void ff_graph_pipeline_execute(FFFilterGraph *graph, AVFilterContext **filters,
+                               int *rets, int nb_filters);
+
 /**
  * Negotiate the media format, dimensions, etc of all inputs to a filter.
  *
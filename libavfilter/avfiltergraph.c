@@ -28,6 +28,7 @@
 #include "libavutil/bprint.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/mathematics.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
@@ -42,6 +43,7 @@
 #include "video.h"
 
 #define OFFSET(x) offsetof(AVFilterGraph, x)
+#define IOFFSET(x) offsetof(FFFilterGraph, x)
 #define F AV_OPT_FLAG_FILTERING_PARAM
 #define V AV_OPT_FLAG_VIDEO_PARAM
 #define A AV_OPT_FLAG_AUDIO_PARAM
@@ -52,12 +54,27 @@ static const AVOption filtergraph_options[] = {
     { "threads",     "Maximum number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, F|V|A, .unit = "threads"},
         {"auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = F|V|A, .unit = "threads"},
+    { "jobs_per_thread", "Number of jobs per thread for filters with uneven slices", IOFFSET(jobs_per_thread), AV_OPT_TYPE_INT,
+        { .i64 = 4 }, 1, 256, F|V|A },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
     {"max_buffered_frames"  , "maximum number of buffered frames allowed", OFFSET(max_buffered_frames),
         AV_OPT_TYPE_UINT,   {.i64 = 0}, 0, UINT_MAX, F|V|A },
+    { "pipeline_threads", "Maximum number of filters activated concurrently", IOFFSET(pipeline_threads), AV_OPT_TYPE_INT,
+        { .i64 = 1 }, 0, INT_MAX, F|V|A, .unit = "pipeline_threads" },
+        { "auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, { .i64 = 0 }, .flags = F|V|A, .unit = "pipeline_threads" },
+    { "pipeline_queue", "Maximum number of frames a filter may queue ahead in pipeline mode", IOFFSET(pipeline_queue), AV_OPT_TYPE_INT,
+        { .i64 = 8 }, 1, INT_MAX, F|V|A },
+    { "fuse_pointwise", "Run chains of point-wise filters as a single pass", IOFFSET(fuse_pointwise), AV_OPT_TYPE_BOOL,
+        { .i64 = 1 }, 0, 1, F|V },
+    { "format_cost", "Pick the formats minimizing the cost of conversions over the whole graph", IOFFSET(format_cost), AV_OPT_TYPE_BOOL,
+        { .i64 = 0 }, 0, 1, F|V|A },
+    { "profile", "Collect statistics about the filters and links", IOFFSET(profile), AV_OPT_TYPE_BOOL,
+        { .i64 = 0 }, 0, 1, F|V|A },
+    { "audio_batch", "Minimum duration of audio passed at once to simple audio filters", IOFFSET(audio_batch), AV_OPT_TYPE_DURATION,
+        { .i64 = 0 }, 0, INT_MAX, F|A },
     { NULL },
 };
 
@@ -80,6 +97,22 @@ int ff_graph_thread_init(FFFilterGraph *graph)
     graph->p.nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_pipeline_init(FFFilterGraph *graph)
+{
+    graph->pipeline_threads = 1;
+    return 0;
+}
+
+void ff_graph_pipeline_free(FFFilterGraph *graph)
+{
+}
+
+void ff_graph_pipeline_execute(FFFilterGraph *graph, AVFilterContext **filters,
+                               int *rets, int nb_filters)
+{
+    av_assert0(0);
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -103,6 +136,8 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
     int i, j;
     for (i = 0; i < graph->nb_filters; i++) {
         if (graph->filters[i] == filter) {
+            fffilterctx(filter)->ready = 0;
+            ff_filter_graph_update_ready(graph, filter);
             FFSWAP(AVFilterContext*, graph->filters[i],
                    graph->filters[graph->nb_filters - 1]);
             graph->nb_filters--;
@@ -128,6 +163,7 @@ void avfilter_graph_free(AVFilterGraph **graphp)
         avfilter_free(graph->filters[0]);
 
     ff_graph_thread_free(graphi);
+    ff_graph_pipeline_free(graphi);
 
     av_freep(&graphi->sink_links);
 
@@ -499,6 +535,19 @@ static void print_filter_formats(void *log_ctx, int level, const AVFilterContext
     }
 }
 
+static const char *merger_property(const AVFilterFormatsMerger *m)
+{
+    switch (m->offset) {
+    case offsetof(AVFilterFormatsConfig, formats):         return "format";
+    case offsetof(AVFilterFormatsConfig, samplerates):     return "sample rate";
+    case offsetof(AVFilterFormatsConfig, channel_layouts): return "channel layout";
+    case offsetof(AVFilterFormatsConfig, color_spaces):    return "color space";
+    case offsetof(AVFilterFormatsConfig, color_ranges):    return "color range";
+    case offsetof(AVFilterFormatsConfig, alpha_modes):     return "alpha mode";
+    }
+    return "property";
+}
+
 /**
  * Perform one round of query_formats() and merging formats lists on the
  * filter graph.
@@ -541,7 +590,7 @@ retry:
             AVFilterLink *link = filter->inputs[j];
             const AVFilterNegotiation *neg;
             AVFilterContext *conv[4];
-            const char *conv_filters[4], *conv_opts[4] = {0};
+            const char *conv_filters[4], *conv_opts[4] = {0}, *conv_reasons[4];
             unsigned neg_step, num_conv = 0;
 
             if (!link)
@@ -561,6 +610,7 @@ retry:
                     if (k == num_conv) {
                         av_assert1(num_conv < FF_ARRAY_ELEMS(conv_filters));
                         conv_filters[num_conv] = m->conversion_filter;
+                        conv_reasons[num_conv] = merger_property(m);
                         if (m->conversion_opts_offset)
                             conv_opts[num_conv] = FF_FIELD_AT(char *, m->conversion_opts_offset, *graph);
                         num_conv++;
@@ -582,6 +632,7 @@ retry:
                         return ret;
                     if (!ret) {
                         conv_filters[num_conv] = m->conversion_filter;
+                        conv_reasons[num_conv] = merger_property(m);
                         if (m->conversion_opts_offset)
                             conv_opts[num_conv] = FF_FIELD_AT(char *, m->conversion_opts_offset, *graph);
                         num_conv++;
@@ -616,6 +667,10 @@ retry:
                 }
                 snprintf(inst_name, sizeof(inst_name), "auto_%s_%d",
                          conv_filters[k], converter_count++);
+                av_log(log_ctx, AV_LOG_VERBOSE, "No common %s between the "
+                       "filters '%s' and '%s'\n", conv_reasons[k],
+                       link->src->name, link->dst->name);
+                print_link_formats(log_ctx, AV_LOG_VERBOSE, link);
                 ret = avfilter_graph_create_filter(&conv[k], filter, inst_name,
                                                    conv_opts[k], NULL, graph);
                 if (ret < 0)
@@ -1288,6 +1343,238 @@ static void swap_sample_fmts(AVFilterGraph *graph)
 
 }
 
+/**
+ * Estimate the cost of converting from one format to another, accounting
+ * for the conversion itself, the data it touches and the information lost.
+ */
+static int conversion_cost(enum AVMediaType type, int src, int dst)
+{
+    if (src == dst)
+        return 0;
+
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        const AVPixFmtDescriptor *sd = av_pix_fmt_desc_get(src);
+        const AVPixFmtDescriptor *dd = av_pix_fmt_desc_get(dst);
+        int loss, cost = 64;
+
+        if ((sd->flags | dd->flags) & AV_PIX_FMT_FLAG_HWACCEL)
+            return INT_MAX / 4;
+
+        loss = av_get_pix_fmt_loss(dst, src, !!(sd->flags & AV_PIX_FMT_FLAG_ALPHA));
+        cost += (av_get_padded_bits_per_pixel(sd) +
+                 av_get_padded_bits_per_pixel(dd)) / 4;
+        if (loss & FF_LOSS_RESOLUTION)        cost +=  256;
+        if (loss & FF_LOSS_DEPTH)             cost +=  512;
+        if (loss & FF_LOSS_COLORSPACE)        cost +=   64;
+        if (loss & FF_LOSS_ALPHA)             cost +=  512;
+        if (loss & FF_LOSS_COLORQUANT)        cost += 1024;
+        if (loss & FF_LOSS_CHROMA)            cost += 1024;
+        if (loss & FF_LOSS_EXCESS_RESOLUTION) cost +=   16;
+        if (loss & FF_LOSS_EXCESS_DEPTH)      cost +=   16;
+        return cost;
+    }
+
+    return 64 + 8 * (av_get_bytes_per_sample(src) + av_get_bytes_per_sample(dst)) +
+           get_fmt_score(dst, src);
+}
+
+/**
+ * Check whether a filter is one of the filters inserted to convert formats,
+ * so that its input and output formats may differ at a cost.
+ */
+static int is_format_converter(AVFilterLink *inlink)
+{
+    const AVFilterNegotiation *neg = ff_filter_get_negotiation(inlink);
+    AVFilterContext *f = inlink->dst;
+
+    if (f->nb_inputs != 1 || f->nb_outputs != 1 ||
+        f->outputs[0]->type != inlink->type)
+        return 0;
+    for (unsigned i = 0; i < neg->nb_mergers; i++)
+        if (neg->mergers[i].offset == offsetof(AVFilterFormatsConfig, formats) &&
+            !strcmp(neg->mergers[i].conversion_filter, f->filter->name))
+            return 1;
+    return 0;
+}
+
+typedef struct FormatNode {
+    AVFilterFormats *formats;   ///< list shared by all the links of the node
+    AVFilterLink *link;         ///< one of the links of the node
+    int format;                 ///< picked format, or -1
+} FormatNode;
+
+typedef struct FormatEdge {
+    unsigned src, dst;          ///< nodes on both sides of a converter
+} FormatEdge;
+
+static int format_node_index(FormatNode **nodes, unsigned *nb_nodes,
+                             AVFilterLink *link)
+{
+    FormatNode *node;
+
+    for (unsigned i = 0; i < *nb_nodes; i++)
+        if ((*nodes)[i].formats == link->incfg.formats)
+            return i;
+
+    node = av_dynarray2_add((void **)nodes, nb_nodes, sizeof(**nodes), NULL);
+    if (!node)
+        return AVERROR(ENOMEM);
+    node->formats = link->incfg.formats;
+    node->link    = link;
+    node->format  = link->incfg.formats->nb_formats == 1 ?
+                    link->incfg.formats->formats[0] : -1;
+    return node - *nodes;
+}
+
+/**
+ * Pick the formats of the links sharing a list of candidates, so that the
+ * total cost of the conversions done by converter filters is minimal.
+ *
+ * The links sharing a formats list form the nodes of a graph whose edges
+ * are the converter filters. Starting from the nodes with a single format,
+ * the format of every other node is chosen by cost against its neighbours,
+ * repeatedly until no choice changes. Nodes without any neighbour with a
+ * known format are left to pick_formats().
+ */
+static int pick_formats_by_cost(AVFilterGraph *graph, void *log_ctx)
+{
+    FormatNode *nodes = NULL;
+    FormatEdge *edges = NULL;
+    unsigned nb_nodes = 0, nb_edges = 0;
+    int ret = 0, changed;
+
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        AVFilterLink *inlink = f->nb_inputs ? f->inputs[0] : NULL;
+        FormatEdge *edge;
+        int src, dst;
+
+        if (!inlink || !inlink->incfg.formats ||
+            (inlink->type != AVMEDIA_TYPE_VIDEO &&
+             inlink->type != AVMEDIA_TYPE_AUDIO) ||
+            !is_format_converter(inlink) || !f->outputs[0]->incfg.formats)
+            continue;
+        if ((src = format_node_index(&nodes, &nb_nodes, inlink)) < 0 ||
+            (dst = format_node_index(&nodes, &nb_nodes, f->outputs[0])) < 0) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if (src == dst)
+            continue;
+        edge = av_dynarray2_add((void **)&edges, &nb_edges, sizeof(*edges), NULL);
+        if (!edge) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        edge->src = src;
+        edge->dst = dst;
+    }
+
+    /* each round can only lower the total cost, but bound it anyway */
+    for (unsigned round = 0; round < 2 * nb_nodes; round++) {
+        changed = 0;
+        for (unsigned n = 0; n < nb_nodes; n++) {
+            FormatNode *node = &nodes[n];
+            int best = -1, best_cost = INT_MAX, cur_cost = INT_MAX;
+
+            if (node->formats->nb_formats == 1)
+                continue;
+            for (unsigned i = 0; i < node->formats->nb_formats; i++) {
+                int fmt = node->formats->formats[i], cost = 0, known = 0;
+
+                for (unsigned e = 0; e < nb_edges; e++) {
+                    const FormatEdge *edge = &edges[e];
+                    if (edge->src == n && nodes[edge->dst].format >= 0) {
+                        cost += conversion_cost(node->link->type, fmt, nodes[edge->dst].format);
+                        known = 1;
+                    } else if (edge->dst == n && nodes[edge->src].format >= 0) {
+                        cost += conversion_cost(node->link->type, nodes[edge->src].format, fmt);
+                        known = 1;
+                    }
+                }
+                if (!known)
+                    break;
+                if (cost < best_cost) {
+                    best      = fmt;
+                    best_cost = cost;
+                }
+                if (fmt == node->format)
+                    cur_cost = cost;
+            }
+            /* only switch for a strictly lower cost, so that this ends */
+            if (best >= 0 && best != node->format && best_cost < cur_cost) {
+                node->format = best;
+                changed      = 1;
+            }
+        }
+        if (!changed)
+            break;
+    }
+
+    for (unsigned n = 0; n < nb_nodes; n++) {
+        FormatNode *node = &nodes[n];
+        AVFilterLink *l = node->link;
+
+        if (node->format < 0 || node->formats->nb_formats == 1)
+            continue;
+        av_log(log_ctx, AV_LOG_DEBUG, "Picking %s out of %d by conversion "
+               "cost for the link between '%s' and '%s'\n",
+               l->type == AVMEDIA_TYPE_VIDEO ? av_get_pix_fmt_name(node->format) :
+                                               av_get_sample_fmt_name(node->format),
+               node->formats->nb_formats, l->src->name, l->dst->name);
+        node->formats->formats[0]  = node->format;
+        node->formats->nb_formats  = 1;
+    }
+
+end:
+    av_freep(&nodes);
+    av_freep(&edges);
+    return ret;
+}
+
+/**
+ * Log the conversions done by the filters inserted during negotiation.
+ */
+static void print_conversions(AVFilterGraph *graph, void *log_ctx)
+{
+    if (av_log_get_level() < AV_LOG_VERBOSE)
+        return;
+
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        AVFilterLink *in, *out;
+
+        if (strncmp(f->name, "auto_", 5) || f->nb_inputs != 1 || f->nb_outputs != 1)
+            continue;
+        in  = f->inputs[0];
+        out = f->outputs[0];
+        if (in->type == AVMEDIA_TYPE_VIDEO) {
+            av_log(log_ctx, AV_LOG_VERBOSE, "'%s' converts %s to %s",
+                   f->name, av_get_pix_fmt_name(in->format),
+                   av_get_pix_fmt_name(out->format));
+            if (in->colorspace != out->colorspace)
+                av_log(log_ctx, AV_LOG_VERBOSE, ", color space %s to %s",
+                       av_color_space_name(in->colorspace),
+                       av_color_space_name(out->colorspace));
+            if (in->color_range != out->color_range)
+                av_log(log_ctx, AV_LOG_VERBOSE, ", color range %s to %s",
+                       av_color_range_name(in->color_range),
+                       av_color_range_name(out->color_range));
+            av_log(log_ctx, AV_LOG_VERBOSE, " between '%s' and '%s'\n",
+                   in->src->name, out->dst->name);
+        } else if (in->type == AVMEDIA_TYPE_AUDIO) {
+            char in_layout[64], out_layout[64];
+            av_channel_layout_describe(&in->ch_layout,  in_layout,  sizeof(in_layout));
+            av_channel_layout_describe(&out->ch_layout, out_layout, sizeof(out_layout));
+            av_log(log_ctx, AV_LOG_VERBOSE, "'%s' converts %s %dHz %s to %s %dHz %s "
+                   "between '%s' and '%s'\n", f->name,
+                   av_get_sample_fmt_name(in->format), in->sample_rate, in_layout,
+                   av_get_sample_fmt_name(out->format), out->sample_rate, out_layout,
+                   in->src->name, out->dst->name);
+        }
+    }
+}
+
 static int pick_formats(AVFilterGraph *graph)
 {
     int i, j, ret;
@@ -1365,12 +1652,182 @@ static int graph_config_formats(AVFilterGraph *graph, void *log_ctx)
     swap_samplerates(graph);
     swap_channel_layouts(graph);
 
+    if (fffiltergraph(graph)->format_cost &&
+        (ret = pick_formats_by_cost(graph, log_ctx)) < 0)
+        return ret;
+
     if ((ret = pick_formats(graph)) < 0)
         return ret;
 
+    print_conversions(graph, log_ctx);
+
     return 0;
 }
 
+/**
+ * Check whether a filter may be part of a fused point-wise chain, and get
+ * its lookup tables if so.
+ */
+static int pointwise_get_lut(AVFilterContext *f, uint16_t *const luts[4])
+{
+    const FFFilter *fi = fffilter(f->filter);
+    AVFilterLink *inlink, *outlink;
+
+    if (!fi->get_lut || fi->activate || f->nb_inputs != 1 ||
+        f->nb_outputs != 1 || f->enable_str)
+        return 0;
+    inlink  = f->inputs[0];
+    outlink = f->outputs[0];
+    if (!inlink || !outlink || inlink->type != AVMEDIA_TYPE_VIDEO ||
+        inlink->format != outlink->format ||
+        inlink->w != outlink->w || inlink->h != outlink->h)
+        return 0;
+    return fi->get_lut(f, luts);
+}
+
+static int pointwise_fuse_chain(FFFilterGraph *graphi, AVFilterContext *first,
+                                uint16_t *const luts[4], uint16_t *const tmp[4])
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(first->inputs[0]->format);
+    AVFilterContext *host = NULL, *last = NULL, *f;
+    int nb_filters = 0, ret;
+
+    for (int c = 0; c < 4; c++)
+        for (int v = 0; v < FF_FILTER_LUT_SIZE; v++)
+            luts[c][v] = v;
+
+    for (f = first; f; f = f->outputs[0]->dst) {
+        ret = pointwise_get_lut(f, tmp);
+        if (ret <= 0) {
+            if (ret < 0)
+                return ret;
+            break;
+        }
+        for (int c = 0; c < desc->nb_components; c++) {
+            const int size = 1 << desc->comp[c].depth;
+            for (int v = 0; v < size; v++)
+                luts[c][v] = tmp[c][FFMIN(luts[c][v], size - 1)];
+        }
+        if (!host && fffilter(f->filter)->set_lut)
+            host = f;
+        last = f;
+        nb_filters++;
+    }
+    if (nb_filters < 2 || !host)
+        return 0;
+
+    for (f = first; ; f = f->outputs[0]->dst) {
+        fffilterctx(f)->pointwise_host = host;
+        if (f == last)
+            break;
+    }
+
+    av_log(&graphi->p, AV_LOG_VERBOSE,
+           "Running %d point-wise filters from '%s' to '%s' as a single pass in '%s'\n",
+           nb_filters, first->name, last->name, host->name);
+    return fffilter(host->filter)->set_lut(host, luts);
+}
+
+static int pointwise_fuse_chains(FFFilterGraph *graphi)
+{
+    AVFilterGraph *graph = &graphi->p;
+    uint16_t *buf, *luts[4], *tmp[4];
+    int ret = 0;
+
+    buf = av_malloc_array(8 * FF_FILTER_LUT_SIZE, sizeof(*buf));
+    if (!buf)
+        return AVERROR(ENOMEM);
+    for (int c = 0; c < 4; c++) {
+        luts[c] = buf + c * FF_FILTER_LUT_SIZE;
+        tmp[c]  = buf + (4 + c) * FF_FILTER_LUT_SIZE;
+    }
+
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i], *prev;
+
+        if (!fffilter(f->filter)->get_lut)
+            continue;
+        /* only start from the first filter of a chain */
+        prev = f->nb_inputs == 1 && f->inputs[0] ? f->inputs[0]->src : NULL;
+        if (prev && (ret = pointwise_get_lut(prev, tmp)) != 0) {
+            if (ret < 0)
+                break;
+            continue;
+        }
+        ret = pointwise_fuse_chain(graphi, f, luts, tmp);
+        if (ret < 0)
+            break;
+    }
+
+    av_free(buf);
+    return FFMIN(ret, 0);
+}
+
+/**
+ * Check whether frames sent on a link will be modified in place, by its
+ * destination or by a filter reached through filters forwarding the frames
+ * unchanged.
+ */
+static int link_write_intent(AVFilterGraph *graph, AVFilterLink *link)
+{
+    /* bounded in case of a loop of forwarding filters */
+    for (unsigned n = 0; n < graph->nb_filters; n++) {
+        AVFilterContext *dst = link->dst;
+        AVFilterContext *host = fffilterctx(dst)->pointwise_host;
+        int forwards;
+
+        if (link->dstpad->flags & AVFILTERPAD_FLAG_NEEDS_WRITABLE &&
+            (!host || host == dst))
+            return 1;
+
+        forwards = (host && host != dst) ||
+                   (!fffilter(dst->filter)->activate && !link->dstpad->filter_frame);
+        if (!forwards || !dst->nb_outputs || !dst->outputs[0])
+            return 0;
+        link = dst->outputs[0];
+    }
+    return 0;
+}
+
+static void graph_negotiate_write_intent(AVFilterGraph *graph)
+{
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+
+        for (unsigned j = 0; j < f->nb_outputs; j++)
+            if (f->outputs[j])
+                ff_filter_link(f->outputs[j])->write_intent =
+                    link_write_intent(graph, f->outputs[j]);
+    }
+}
+
+int ff_graph_fuse_pointwise(FFFilterGraph *graphi)
+{
+    AVFilterGraph *graph = &graphi->p;
+    int ret = 0;
+
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        FFFilterContext *fi = fffilterctx(f);
+
+        if (fi->pointwise_host == f) {
+            ret = fffilter(f->filter)->set_lut(f, NULL);
+            if (ret < 0)
+                return ret;
+        }
+        fi->pointwise_host = NULL;
+    }
+
+    /* members of a fused chain would be accessed by the pipeline threads
+     * running the host */
+    if (graphi->fuse_pointwise && !graphi->pipeline)
+        ret = pointwise_fuse_chains(graphi);
+
+    /* the members of the chains no longer write to the frames */
+    graph_negotiate_write_intent(graph);
+    return ret;
+}
+
 static int graph_config_pointers(AVFilterGraph *graph, void *log_ctx)
 {
     unsigned i, j;
@@ -1411,8 +1868,63 @@ static int graph_config_pointers(AVFilterGraph *graph, void *log_ctx)
     return 0;
 }
 
+static int audio_batch_input(AVFilterLink *link)
+{
+    const AVFilterContext *f = link->dst;
+
+    return link->type == AVMEDIA_TYPE_AUDIO && !fffilter(f->filter)->activate &&
+           f->nb_inputs == 1 && !ff_filter_link(link)->min_samples;
+}
+
+/**
+ * Make the audio inputs of the filters using the filter_frame() callback
+ * receive at least the duration set by the audio_batch option at once, so
+ * that chains of such filters run once per batch instead of once per
+ * incoming frame. Only the first such input of a chain merges frames: the
+ * inputs further down are not batched, even after a filter outputting fewer
+ * samples than it received, which would otherwise merge frames again and
+ * add to the delay.
+ *
+ * Filters with several inputs or setting min_samples themselves are left
+ * alone, as are filters with an activate() callback, which consume their
+ * inputs on their own terms.
+ */
+static void graph_config_audio_batch(FFFilterGraph *graphi)
+{
+    AVFilterGraph *graph = &graphi->p;
+
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+
+        for (unsigned j = 0; j < f->nb_inputs; j++) {
+            AVFilterLink *link = f->inputs[j];
+            FilterLinkInternal *li = ff_link_internal(link);
+            AVFilterContext *src = link->src;
+            int upstream = 0;
+
+            li->batch_samples = 0;
+            if (!graphi->audio_batch || !audio_batch_input(link))
+                continue;
+            /* bounded in case of a loop */
+            for (unsigned n = 0; n < graph->nb_filters && !upstream &&
+                 src->nb_inputs == 1 && src->inputs[0]; n++) {
+                upstream = audio_batch_input(src->inputs[0]);
+                src = src->inputs[0]->src;
+            }
+            if (upstream)
+                continue;
+            li->batch_samples = FFMIN(av_rescale(graphi->audio_batch, link->sample_rate,
+                                                 AV_TIME_BASE), INT_MAX / 2);
+            if (li->batch_samples)
+                av_log(f, AV_LOG_DEBUG, "Batching %d samples on input '%s'\n",
+                       li->batch_samples, link->dstpad->name);
+        }
+    }
+}
+
 int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
 {
+    FFFilterGraph *graphi = fffiltergraph(graphctx);
     int ret;
 
     if (graphctx->max_buffered_frames)
@@ -1428,6 +1940,19 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
 
+    if (graphi->pipeline_threads != 1 && !graphi->pipeline) {
+        if (graphctx->execute) {
+            av_log(log_ctx, AV_LOG_WARNING, "Pipeline threading is not "
+                   "supported with a custom execute callback, disabling.\n");
+            graphi->pipeline_threads = 1;
+        } else if ((ret = ff_graph_pipeline_init(graphi)) < 0) {
+            return ret;
+        }
+    }
+    if ((ret = ff_graph_fuse_pointwise(graphi)) < 0)
+        return ret;
+    graph_config_audio_batch(graphi);
+
     return 0;
 }
 
@@ -1540,8 +2065,12 @@ void ff_avfilter_graph_update_heap(AVFilterGraph *graph, FilterLinkInternal *li)
 {
     FFFilterGraph  *graphi = fffiltergraph(graph);
 
-    heap_bubble_up  (graphi, li, li->age_index);
-    heap_bubble_down(graphi, li, li->age_index);
+    ff_graph_lock(graphi);
+    if (li->age_index >= 0) {
+        heap_bubble_up  (graphi, li, li->age_index);
+        heap_bubble_down(graphi, li, li->age_index);
+    }
+    ff_graph_unlock(graphi);
 }
 
 int avfilter_graph_request_oldest(AVFilterGraph *graph)
@@ -1593,21 +2122,170 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
-int ff_filter_graph_run_once(AVFilterGraph *graph)
+static void ready_queue_remove(FFFilterGraph *graph, FFFilterContext *ctxi)
+{
+    FFFilterReadyQueue *q = &graph->ready_queues[ctxi->ready_level];
+
+    if (ctxi->ready_prev)
+        ctxi->ready_prev->ready_next = ctxi->ready_next;
+    else
+        q->head = ctxi->ready_next;
+    if (ctxi->ready_next)
+        ctxi->ready_next->ready_prev = ctxi->ready_prev;
+    else
+        q->tail = ctxi->ready_prev;
+    ctxi->ready_prev  = ctxi->ready_next = NULL;
+    ctxi->ready_level = -1;
+}
+
+static void ready_queue_update(FFFilterGraph *graphi, FFFilterContext *ctxi)
+{
+    FFFilterReadyQueue *q;
+    int level;
+
+    if (ctxi->ready_level >= 0) {
+        if (graphi->ready_queues[ctxi->ready_level].priority == ctxi->ready)
+            return;
+        ready_queue_remove(graphi, ctxi);
+    }
+    if (!ctxi->ready)
+        return;
+
+    for (level = 0; level < graphi->nb_ready_queues; level++)
+        if (graphi->ready_queues[level].priority == ctxi->ready)
+            break;
+    if (level == graphi->nb_ready_queues) {
+        av_assert0(level < FF_FILTER_READY_LEVELS);
+        graphi->ready_queues[level].priority = ctxi->ready;
+        graphi->nb_ready_queues++;
+    }
+
+    q = &graphi->ready_queues[level];
+    ctxi->ready_prev  = q->tail;
+    ctxi->ready_next  = NULL;
+    ctxi->ready_level = level;
+    if (q->tail)
+        q->tail->ready_next = ctxi;
+    else
+        q->head = ctxi;
+    q->tail = ctxi;
+}
+
+void ff_filter_graph_update_ready(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    FFFilterGraph *graphi = fffiltergraph(graph);
+
+    ff_graph_lock(graphi);
+    ready_queue_update(graphi, fffilterctx(filter));
+    ff_graph_unlock(graphi);
+}
+
+static void pipeline_mark_neighbours(AVFilterContext *filter, unsigned batch,
+                                     int depth)
+{
+    unsigned i;
+
+    fffilterctx(filter)->pipeline_mark = batch;
+    if (!depth--)
+        return;
+    for (i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i])
+            pipeline_mark_neighbours(filter->inputs[i]->src, batch, depth);
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i])
+            pipeline_mark_neighbours(filter->outputs[i]->dst, batch, depth);
+}
+
+static int pipeline_can_run_ahead(FFFilterGraph *graphi, AVFilterContext *filter)
 {
-    FFFilterContext *ctxi;
     unsigned i;
 
+    if (fffilterctx(filter)->pipeline_mark == graphi->pipeline_batch ||
+        fffilter(filter->filter)->flags_internal & FF_FILTER_FLAG_GRAPH_WIDE)
+        return 0;
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i] &&
+            ff_inlink_queued_frames(filter->outputs[i]) >= graphi->pipeline_queue)
+            return 0;
+    return 1;
+}
+
+/**
+ * Activate the most urgent filter together with as many other ready filters
+ * as allowed, on the pipeline threads.
+ *
+ * An activation only touches the links of the filter and the outputs of its
+ * neighbours, so filters more than two links apart can run concurrently
+ * without further synchronization; the graph-wide scheduling state is
+ * protected by pipeline_lock meanwhile.
+ */
+static int pipeline_run_once(FFFilterGraph *graphi, FFFilterContext *first)
+{
+    AVFilterContext *batch[64];
+    int rets[64], max_batch, max_scan, nb_batch = 0, ret = 0, i;
+
+    if (fffilter(first->p.filter)->flags_internal & FF_FILTER_FLAG_GRAPH_WIDE)
+        return ff_filter_activate(&first->p);
+
+    max_batch = FFMIN(graphi->pipeline_threads, FF_ARRAY_ELEMS(batch));
+    if (max_batch <= 0)
+        max_batch = FF_ARRAY_ELEMS(batch);
+    /* bound the search so that a long ready list does not cost O(n) */
+    max_scan = 4 * max_batch;
+
+    if (!++graphi->pipeline_batch)
+        ++graphi->pipeline_batch;
+
+    batch[nb_batch++] = &first->p;
+    pipeline_mark_neighbours(&first->p, graphi->pipeline_batch, 2);
+
+    for (i = 0; i < graphi->nb_ready_queues && nb_batch < max_batch; i++) {
+        FFFilterContext *ctxi = graphi->ready_queues[i].head;
+        for (; ctxi && nb_batch < max_batch && max_scan > 0;
+             ctxi = ctxi->ready_next, max_scan--) {
+            if (ctxi == first || !pipeline_can_run_ahead(graphi, &ctxi->p))
+                continue;
+            batch[nb_batch++] = &ctxi->p;
+            pipeline_mark_neighbours(&ctxi->p, graphi->pipeline_batch, 2);
+        }
+    }
+
+    if (nb_batch == 1)
+        return ff_filter_activate(&first->p);
+
+    graphi->pipeline_overlapped += nb_batch;
+    graphi->pipeline_active = 1;
+    ff_graph_pipeline_execute(graphi, batch, rets, nb_batch);
+    graphi->pipeline_active = 0;
+
+    for (i = 0; i < nb_batch; i++) {
+        if (rets[i] == FFERROR_BUFFERSRC_EMPTY) {
+            if (!ret)
+                ret = rets[i];
+        } else if (rets[i] < 0) {
+            return rets[i];
+        }
+    }
+    return ret;
+}
+
+int ff_filter_graph_run_once(AVFilterGraph *graph)
+{
+    FFFilterGraph *graphi = fffiltergraph(graph);
+    FFFilterReadyQueue *best = NULL;
+    int i;
+
     av_assert0(graph->nb_filters);
-    ctxi = fffilterctx(graph->filters[0]);
-    for (i = 1; i < graph->nb_filters; i++) {
-        FFFilterContext *ctxi_other = fffilterctx(graph->filters[i]);
+    for (i = 0; i < graphi->nb_ready_queues; i++) {
+        FFFilterReadyQueue *q = &graphi->ready_queues[i];
 
-        if (ctxi_other->ready > ctxi->ready)
-            ctxi = ctxi_other;
+        if (q->head && (!best || q->priority > best->priority))
+            best = q;
     }
 
-    if (!ctxi->ready)
+    if (!best)
         return AVERROR(EAGAIN);
-    return ff_filter_activate(&ctxi->p);
+    if (graphi->pipeline)
+        return pipeline_run_once(graphi, best->head);
+    return ff_filter_activate(&best->head->p);
 }
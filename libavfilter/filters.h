@@ -193,6 +193,23 @@ typedef struct FilterLink {
      * May be set by the link source filter in its config_props().
      */
     AVBufferRef *hw_frames_ctx;
+
+    /**
+     * Nonzero if frames sent on this link are modified in place by the
+     * destination filter, or by a filter further down that the frames reach
+     * unchanged. Any other reference to such a frame makes it non-writable
+     * and forces a copy, so the source filter should avoid keeping one when
+     * it can.
+     *
+     * Set by the graph when it is configured.
+     */
+    int write_intent;
+
+    /**
+     * Number of frames that had to be copied on this link to be made
+     * writable for the destination filter.
+     */
+    int64_t frame_copies;
 } FilterLink;
 
 static inline FilterLink* ff_filter_link(AVFilterLink *link)
@@ -206,6 +223,12 @@ static inline FilterLink* ff_filter_link(AVFilterLink *link)
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter accesses other filters of the graph than its direct
+ * neighbours, and must never be activated concurrently with another filter.
+ */
+#define FF_FILTER_FLAG_GRAPH_WIDE    (1 << 1)
+
 /**
  * Find the index of a link.
  *
@@ -458,8 +481,30 @@ typedef struct FFFilter {
      * activation.
      */
     int (*activate)(AVFilterContext *ctx);
+
+    /**
+     * Point-wise video filters: describe the processing of the configured
+     * filter as one lookup table per component.
+     *
+     * @param luts for each component of the input format, in pixel format
+     *             descriptor order, a table of FF_FILTER_LUT_SIZE entries to
+     *             fill with the output value of every input value
+     * @return 1 if the tables were filled, 0 if the current settings are not
+     *         point-wise (e.g. they depend on the frame or the coordinates)
+     */
+    int (*get_lut)(AVFilterContext *ctx, uint16_t *const luts[4]);
+
+    /**
+     * Make the filter apply the given tables, in the same layout as for
+     * get_lut(), instead of its own processing, or return to its own
+     * processing if luts is NULL. Used by the graph to run a chain of
+     * point-wise filters as a single pass.
+     */
+    int (*set_lut)(AVFilterContext *ctx, uint16_t *const luts[4]);
 } FFFilter;
 
+#define FF_FILTER_LUT_SIZE (1 << 16)
+
 static inline const FFFilter *fffilter(const AVFilter *f)
 {
     return (const FFFilter*)f;
@@ -749,6 +794,17 @@ int ff_filter_process_command(AVFilterContext *ctx, const char *cmd,
  */
 int ff_filter_get_nb_threads(AVFilterContext *ctx) av_pure;
 
+/**
+ * Get the number of jobs to split the work of a filter instance into, for
+ * filters whose jobs are independent and may take uneven time. This is more
+ * than the number of threads, as set by the jobs_per_thread graph option,
+ * so that the threads finishing their jobs early pick up the remaining ones.
+ *
+ * @param max_jobs maximum useful number of jobs, e.g. the number of rows
+ * @return the number of jobs, between 1 and max_jobs
+ */
+int ff_filter_get_nb_jobs(AVFilterContext *ctx, int max_jobs) av_pure;
+
 /**
  * Send a frame of data to the next filter.
  *
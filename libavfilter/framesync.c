@@ -178,6 +178,8 @@ int ff_framesync_configure(FFFrameSync *fs)
 
     for (i = 0; i < fs->nb_in; i++)
         fs->in[i].pts = fs->in[i].pts_next = AV_NOPTS_VALUE;
+    fs->in_consume   = 0;
+    fs->in_requested = 0;
     fs->sync_level = UINT_MAX;
     framesync_sync_level_update(fs, AV_NOPTS_VALUE);
 
@@ -310,43 +312,79 @@ void ff_framesync_uninit(FFFrameSync *fs)
     av_freep(&fs->in);
 }
 
-static int consume_from_fifos(FFFrameSync *fs)
+static int consume_from_input(FFFrameSync *fs, unsigned in)
 {
-    AVFilterContext *ctx = fs->parent;
+    AVFilterLink *inlink = fs->parent->inputs[in];
     AVFrame *frame = NULL;
     int64_t pts;
-    unsigned i, nb_active, nb_miss;
     int ret, status;
 
-    nb_active = nb_miss = 0;
-    for (i = 0; i < fs->nb_in; i++) {
+    ret = ff_inlink_consume_frame(inlink, &frame);
+    if (ret < 0)
+        return ret;
+    if (ret) {
+        av_assert0(frame);
+        framesync_inject_frame(fs, in, frame);
+        return 1;
+    }
+    ret = ff_inlink_acknowledge_status(inlink, &status, &pts);
+    if (ret > 0)
+        framesync_inject_status(fs, in, status, pts);
+    return ret > 0;
+}
+
+static int consume_from_fifos(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    unsigned i, j, nb_consumed = 0;
+    int ret;
+
+    /* Stop at the first input lacking its next frame and resume from it at
+       the next call: with many inputs whose frames arrive one at a time,
+       each activation then only looks at the inputs that changed instead
+       of all of them. Nothing can happen before all inputs have their next
+       frame anyway. */
+    for (i = fs->in_consume; i < fs->nb_in; i++) {
         if (fs->in[i].have_next || fs->in[i].state == STATE_EOF)
             continue;
-        nb_active++;
-        ret = ff_inlink_consume_frame(ctx->inputs[i], &frame);
+        ret = consume_from_input(fs, i);
         if (ret < 0)
             return ret;
-        if (ret) {
-            av_assert0(frame);
-            framesync_inject_frame(fs, i, frame);
-        } else {
-            ret = ff_inlink_acknowledge_status(ctx->inputs[i], &status, &pts);
-            if (ret > 0) {
-                framesync_inject_status(fs, i, status, pts);
-            } else if (!ret) {
-                nb_miss++;
-            }
-        }
+        if (!ret)
+            break;
+        nb_consumed++;
+    }
+    fs->in_consume = i;
+    if (i == fs->nb_in) {
+        fs->in_consume   = 0;
+        fs->in_requested = 0;
+        return 1;
     }
-    if (nb_miss) {
-        if (nb_miss == nb_active && !ff_outlink_frame_wanted(ctx->outputs[0]))
+    if (!fs->in_requested) {
+        /* First missing frame since the last event: take what is available
+           on the other inputs and request frames on the missing ones. */
+        for (j = i + 1; j < fs->nb_in; j++) {
+            if (fs->in[j].have_next || fs->in[j].state == STATE_EOF)
+                continue;
+            ret = consume_from_input(fs, j);
+            if (ret < 0)
+                return ret;
+            nb_consumed += ret;
+        }
+        if (!nb_consumed && !ff_outlink_frame_wanted(ctx->outputs[0]))
             return FFERROR_NOT_READY;
-        for (i = 0; i < fs->nb_in; i++)
-            if (!fs->in[i].have_next && fs->in[i].state != STATE_EOF)
-                ff_inlink_request_frame(ctx->inputs[i]);
+        for (j = i; j < fs->nb_in; j++)
+            if (!fs->in[j].have_next && fs->in[j].state != STATE_EOF)
+                ff_inlink_request_frame(ctx->inputs[j]);
+        fs->in_requested = 1;
         return 0;
     }
-    return 1;
+    if (!nb_consumed && !ff_outlink_frame_wanted(ctx->outputs[0]))
+        return FFERROR_NOT_READY;
+    /* Renew the request on the input holding the others back, so that the
+       source feeding it learns it is still needed. */
+    ff_inlink_request_frame(ctx->inputs[i]);
+    return 0;
 }
 
 int ff_framesync_activate(FFFrameSync *fs)
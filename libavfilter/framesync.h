@@ -203,6 +203,18 @@ typedef struct FFFrameSync {
      */
     unsigned in_request;
 
+    /**
+     * Index of the first input that may lack its next frame; the inputs
+     * before it have their next frame or status.
+     */
+    unsigned in_consume;
+
+    /**
+     * Flag indicating that frames were requested on the inputs lacking
+     * their next frame.
+     */
+    uint8_t in_requested;
+
     /**
      * Synchronization level: only inputs with the same sync level are sync
      * sources.
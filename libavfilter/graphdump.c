@@ -21,15 +21,18 @@
 
 #include <string.h>
 
+#include "libavutil/avstring.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/bprint.h"
 #include "libavutil/mem.h"
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
+#include "avfilter_internal.h"
 #include "filters.h"
 
-static int print_link_prop(AVBPrint *buf, AVFilterLink *link)
+static int print_link_prop(AVBPrint *buf, AVFilterLink *link, int stats)
 {
+    FilterLink *l = ff_filter_link(link);
     const char *format;
     AVBPrint dummy_buffer;
 
@@ -58,15 +61,29 @@ static int print_link_prop(AVBPrint *buf, AVFilterLink *link)
             av_bprintf(buf, "?");
             break;
     }
+    if (stats) {
+        /* updated once per dump, see avfilter_graph_dump() */
+        const AVFilterLinkStats *ls = fffiltergraph(link->src->graph)->profile ?
+                                      &ff_link_internal(link)->stats : NULL;
+
+        av_bprintf(buf, "{%scopies:%"PRId64"}",
+                   l->write_intent ? "write " : "", l->frame_copies);
+        if (ls)
+            av_bprintf(buf, "{frames:%"PRId64" queue:%"PRId64"/%"PRId64
+                       " wait:%"PRId64"us}", ls->frames, ls->queued,
+                       ls->max_queued, ls->queue_wait);
+    }
     return buf->len;
 }
 
-static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
+static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph,
+                                       int stats)
 {
     unsigned i, j, x, e;
 
     for (i = 0; i < graph->nb_filters; i++) {
         AVFilterContext *filter = graph->filters[i];
+        const AVFilterStats *fs;
         unsigned max_src_name = 0, max_dst_name = 0;
         unsigned max_in_name  = 0, max_out_name = 0;
         unsigned max_in_fmt   = 0, max_out_fmt  = 0;
@@ -79,14 +96,14 @@ static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
             unsigned ln = strlen(l->src->name) + 1 + strlen(l->srcpad->name);
             max_src_name = FFMAX(max_src_name, ln);
             max_in_name = FFMAX(max_in_name, strlen(l->dstpad->name));
-            max_in_fmt = FFMAX(max_in_fmt, print_link_prop(NULL, l));
+            max_in_fmt = FFMAX(max_in_fmt, print_link_prop(NULL, l, stats));
         }
         for (j = 0; j < filter->nb_outputs; j++) {
             AVFilterLink *l = filter->outputs[j];
             unsigned ln = strlen(l->dst->name) + 1 + strlen(l->dstpad->name);
             max_dst_name = FFMAX(max_dst_name, ln);
             max_out_name = FFMAX(max_out_name, strlen(l->srcpad->name));
-            max_out_fmt = FFMAX(max_out_fmt, print_link_prop(NULL, l));
+            max_out_fmt = FFMAX(max_out_fmt, print_link_prop(NULL, l, stats));
         }
         in_indent = max_src_name + max_in_name + max_in_fmt;
         in_indent += in_indent ? 4 : 0;
@@ -108,7 +125,7 @@ static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
                 av_bprint_chars(buf, '-', e - buf->len);
                 e = buf->len + max_in_fmt + 2 +
                     max_in_name - strlen(l->dstpad->name);
-                print_link_prop(buf, l);
+                print_link_prop(buf, l, stats);
                 av_bprint_chars(buf, '-', e - buf->len);
                 av_bprintf(buf, "%s", l->dstpad->name);
             } else {
@@ -139,7 +156,7 @@ static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
                 av_bprint_chars(buf, '-', e - buf->len);
                 e = buf->len + max_out_fmt + 2 +
                     max_dst_name - ln;
-                print_link_prop(buf, l);
+                print_link_prop(buf, l, stats);
                 av_bprint_chars(buf, '-', e - buf->len);
                 av_bprintf(buf, "%s:%s", l->dst->name, l->dstpad->name);
             }
@@ -149,6 +166,15 @@ static void avfilter_graph_dump_to_buf(AVBPrint *buf, AVFilterGraph *graph)
         av_bprintf(buf, "+");
         av_bprint_chars(buf, '-', width);
         av_bprintf(buf, "+\n");
+        if (stats && (fs = avfilter_get_stats(filter))) {
+            av_bprint_chars(buf, ' ', in_indent);
+            av_bprintf(buf, " activations:%"PRId64" wall:%"PRId64"us",
+                       fs->nb_activations, fs->wall_time);
+            if (fs->cpu_time >= 0)
+                av_bprintf(buf, " cpu:%"PRId64"us", fs->cpu_time);
+            av_bprintf(buf, " in:%"PRId64"/%"PRId64"B out:%"PRId64"/%"PRId64"B\n",
+                       fs->frames_in, fs->bytes_in, fs->frames_out, fs->bytes_out);
+        }
         av_bprintf(buf, "\n");
     }
 }
@@ -157,13 +183,21 @@ char *avfilter_graph_dump(AVFilterGraph *graph, const char *options)
 {
     AVBPrint buf;
     char *dump = NULL;
+    int stats = options && av_match_name("stats", options);
+
+    /* The statistics depend on the time they are taken at: take them once,
+     * so that the measuring and the printing passes agree. */
+    if (stats)
+        for (unsigned i = 0; i < graph->nb_filters; i++)
+            for (unsigned j = 0; j < graph->filters[i]->nb_outputs; j++)
+                avfilter_link_get_stats(graph->filters[i]->outputs[j]);
 
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_COUNT_ONLY);
-    avfilter_graph_dump_to_buf(&buf, graph);
+    avfilter_graph_dump_to_buf(&buf, graph, stats);
     dump = av_malloc(buf.len + 1);
     if (!dump)
         return NULL;
     av_bprint_init_for_buffer(&buf, dump, buf.len + 1);
-    avfilter_graph_dump_to_buf(&buf, graph);
+    avfilter_graph_dump_to_buf(&buf, graph, stats);
     return dump;
 }
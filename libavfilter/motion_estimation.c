@@ -51,6 +51,9 @@ void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_para
     me_ctx->mb_size = mb_size;
     me_ctx->search_param = search_param;
     me_ctx->get_cost = &ff_me_cmp_sad;
+    me_ctx->sad = NULL;
+    if (!(mb_size & (mb_size - 1)))
+        me_ctx->sad = av_pixelutils_get_sad_fn(av_log2(mb_size), av_log2(mb_size), 0, NULL);
     me_ctx->x_min = x_min;
     me_ctx->x_max = x_max;
     me_ctx->y_min = y_min;
@@ -68,6 +71,9 @@ uint64_t ff_me_cmp_sad(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int x_mv,
     data_ref += y_mv * linesize;
     data_cur += y_mb * linesize;
 
+    if (me_ctx->sad)
+        return me_ctx->sad(data_ref + x_mv, linesize, data_cur + x_mb, linesize);
+
     for (j = 0; j < me_ctx->mb_size; j++)
         for (i = 0; i < me_ctx->mb_size; i++)
             sad += FFABS(data_ref[x_mv + i + j * linesize] - data_cur[x_mb + i + j * linesize]);
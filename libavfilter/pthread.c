@@ -27,6 +27,7 @@
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
 #include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
 
 #include "avfilter.h"
 #include "avfilter_internal.h"
@@ -35,6 +36,8 @@ typedef struct ThreadContext {
     AVFilterGraph *graph;
     AVSliceThread *thread;
     avfilter_action_func *func;
+    /* filters activated concurrently in pipeline mode share the pool */
+    AVMutex lock;
 
     /* per-execute parameters */
     AVFilterContext *ctx;
@@ -53,6 +56,7 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
+    ff_mutex_destroy(&c->lock);
 }
 
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -62,21 +66,32 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+    ff_mutex_lock(&c->lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    ff_mutex_unlock(&c->lock);
     return 0;
 }
 
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
+    int ret;
+
     nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
-    if (nb_threads <= 1)
+    if (nb_threads <= 1) {
         avpriv_slicethread_free(&c->thread);
-    return FFMAX(nb_threads, 1);
+        return FFMAX(nb_threads, 1);
+    }
+    ret = ff_mutex_init(&c->lock, NULL);
+    if (ret) {
+        avpriv_slicethread_free(&c->thread);
+        return AVERROR(ret);
+    }
+    return nb_threads;
 }
 
 int ff_graph_thread_init(FFFilterGraph *graphi)
@@ -113,3 +128,68 @@ void ff_graph_thread_free(FFFilterGraph *graph)
         slice_thread_uninit(graph->thread);
     av_freep(&graph->thread);
 }
+
+typedef struct PipelineContext {
+    AVSliceThread *thread;
+
+    /* per-execute parameters */
+    AVFilterContext **filters;
+    int              *rets;
+} PipelineContext;
+
+static void pipeline_worker_func(void *priv, int jobnr, int threadnr,
+                                 int nb_jobs, int nb_threads)
+{
+    PipelineContext *c = priv;
+    c->rets[jobnr] = ff_filter_activate(c->filters[jobnr]);
+}
+
+void ff_graph_pipeline_execute(FFFilterGraph *graph, AVFilterContext **filters,
+                               int *rets, int nb_filters)
+{
+    PipelineContext *c = graph->pipeline;
+
+    c->filters = filters;
+    c->rets    = rets;
+    avpriv_slicethread_execute(c->thread, nb_filters, 0);
+}
+
+int ff_graph_pipeline_init(FFFilterGraph *graph)
+{
+    PipelineContext *c;
+    int ret;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    ret = avpriv_slicethread_create(&c->thread, c, pipeline_worker_func,
+                                    NULL, graph->pipeline_threads);
+    if (ret <= 1) {
+        avpriv_slicethread_free(&c->thread);
+        av_free(c);
+        graph->pipeline_threads = 1;
+        return FFMIN(ret, 0);
+    }
+
+    ret = ff_mutex_init(&graph->pipeline_lock, NULL);
+    if (ret) {
+        avpriv_slicethread_free(&c->thread);
+        av_free(c);
+        return AVERROR(ret);
+    }
+
+    graph->pipeline = c;
+    return 0;
+}
+
+void ff_graph_pipeline_free(FFFilterGraph *graph)
+{
+    PipelineContext *c = graph->pipeline;
+
+    if (!c)
+        return;
+    avpriv_slicethread_free(&c->thread);
+    ff_mutex_destroy(&graph->pipeline_lock);
+    av_freep(&graph->pipeline);
+}
@@ -0,0 +1,168 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define WIDTH  160
+#define HEIGHT 120
+
+/* Consecutive texts keep, change, add and remove lines. */
+static const char *const texts[] = {
+    "Title\nFrame 0\nFooter",
+    "Title\nFrame 1\nFooter",
+    "Title\nFrame 1\nFooter",
+    "Title\nFrame 22\nFooter\nExtra line",
+    "Title\nFrame 22\nFooter",
+    "Other\nFrame 22",
+    "Title again\nFrame 6\nFooter",
+    "",
+    "Title\nFrame 8\nFooter",
+    "Frame 9",
+};
+
+/* The position moves by fractions of a pixel, so that the subpixel phase of
+ * the lines changes too. */
+static const char *const filter_args =
+    "text=%{metadata\\:text}:x=4+n/3:y=3+n*0.4:fontsize=20:line_spacing=-2:"
+    "borderw=2:shadowx=2:shadowy=1:box=1:boxcolor=red@0.5:text_align=C";
+
+static int create_graph(AVFilterGraph **graph, AVFilterContext **src,
+                        AVFilterContext **sink, int start_number, const char *font,
+                        int nb_threads)
+{
+    AVFilterContext *drawtext;
+    char args[512];
+    int ret;
+
+    *graph = avfilter_graph_alloc();
+    if (!*graph)
+        return AVERROR(ENOMEM);
+    (*graph)->nb_threads = nb_threads;
+
+    ret = avfilter_graph_create_filter(src, avfilter_get_by_name("buffer"), "in",
+                                       "video_size=160x120:pix_fmt=yuv420p:time_base=1/25",
+                                       NULL, *graph);
+    if (ret < 0)
+        return ret;
+    snprintf(args, sizeof(args), "%s:start_number=%d%s%s",
+             filter_args, start_number, font ? ":" : "", font ? font : "");
+    ret = avfilter_graph_create_filter(&drawtext, avfilter_get_by_name("drawtext"),
+                                       "drawtext", args, NULL, *graph);
+    if (ret < 0)
+        return ret;
+    ret = avfilter_graph_create_filter(sink, avfilter_get_by_name("buffersink"), "out",
+                                       NULL, NULL, *graph);
+    if (ret < 0)
+        return ret;
+
+    if ((ret = avfilter_link(*src, 0, drawtext, 0)) < 0 ||
+        (ret = avfilter_link(drawtext, 0, *sink, 0)) < 0)
+        return ret;
+    return avfilter_graph_config(*graph, NULL);
+}
+
+static int filter(AVFilterContext *src, AVFilterContext *sink, AVFrame *in, AVFrame *out)
+{
+    int ret = av_buffersrc_add_frame_flags(src, in, AV_BUFFERSRC_FLAG_KEEP_REF);
+    if (ret < 0)
+        return ret;
+    return av_buffersink_get_frame(sink, out);
+}
+
+static int same_frames(const AVFrame *a, const AVFrame *b)
+{
+    for (int p = 0; p < 3; p++) {
+        const int w = p ? WIDTH  / 2 : WIDTH;
+        const int h = p ? HEIGHT / 2 : HEIGHT;
+        for (int y = 0; y < h; y++)
+            if (memcmp(a->data[p] + y * a->linesize[p],
+                       b->data[p] + y * b->linesize[p], w))
+                return 0;
+    }
+    return 1;
+}
+
+/* The output of one filter instance drawing a different text on each frame
+ * is compared to the one of a new instance for each frame, which blends the
+ * glyphs in a single slice instead of several. An optional
+ * argument gives the font, e.g. fontfile=file.ttf, instead of the default
+ * font found by fontconfig. */
+int main(int argc, char **argv)
+{
+    const char *font = argc > 1 ? argv[1] : NULL;
+    AVFilterGraph *graph = NULL, *ref_graph = NULL;
+    AVFilterContext *src, *sink, *ref_src, *ref_sink;
+    AVFrame *in  = av_frame_alloc();
+    AVFrame *out = av_frame_alloc();
+    AVFrame *ref = av_frame_alloc();
+    int ret;
+
+    if (!in || !out || !ref) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = create_graph(&graph, &src, &sink, 0, font, 3)) < 0)
+        goto end;
+
+    in->format = AV_PIX_FMT_YUV420P;
+    in->width  = WIDTH;
+    in->height = HEIGHT;
+    if ((ret = av_frame_get_buffer(in, 0)) < 0)
+        goto end;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(texts); i++) {
+        for (int p = 0; p < 3; p++) {
+            const int w = p ? WIDTH  / 2 : WIDTH;
+            const int h = p ? HEIGHT / 2 : HEIGHT;
+            for (int y = 0; y < h; y++)
+                for (int x = 0; x < w; x++)
+                    in->data[p][y * in->linesize[p] + x] = p ? 128 : x + y + i * 8;
+        }
+        in->pts = i;
+        if ((ret = av_dict_set(&in->metadata, "text", texts[i], 0)) < 0)
+            goto end;
+
+        if ((ret = create_graph(&ref_graph, &ref_src, &ref_sink, i, font, 1)) < 0 ||
+            (ret = filter(src, sink, in, out)) < 0 ||
+            (ret = filter(ref_src, ref_sink, in, ref)) < 0)
+            goto end;
+
+        printf("%d: %s\n", i, same_frames(out, ref) ? "ok" : "differs");
+        av_frame_unref(out);
+        av_frame_unref(ref);
+        avfilter_graph_free(&ref_graph);
+    }
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Failed to filter: %s\n", av_err2str(ret));
+    av_frame_free(&in);
+    av_frame_free(&out);
+    av_frame_free(&ref);
+    avfilter_graph_free(&graph);
+    avfilter_graph_free(&ref_graph);
+    return ret < 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define NB_FRAMES 10
+
+static const char *graph_desc = "split[a][b];[a]negate[a1];[b]hflip[b1];[a1][b1]hstack";
+
+/* Print the dump with the timings replaced by X. The layout depends on the
+ * width of the timings, so runs of padding are printed as a single one. The
+ * CPU time is not available on every platform and is left out. */
+static void print_dump(const char *dump)
+{
+    static const char *const timings[] = { "wall:", "wait:" };
+
+    while (*dump) {
+        int masked = 0;
+
+        if (!strncmp(dump, " cpu:", 5)) {
+            for (dump += 5; *dump >= '0' && *dump <= '9'; dump++)
+                ;
+            dump += 2;
+            continue;
+        }
+        for (int i = 0; i < FF_ARRAY_ELEMS(timings); i++) {
+            const size_t len = strlen(timings[i]);
+            if (!strncmp(dump, timings[i], len)) {
+                printf("%sX", timings[i]);
+                for (dump += len; *dump >= '0' && *dump <= '9'; dump++)
+                    ;
+                masked = 1;
+                break;
+            }
+        }
+        if (masked)
+            continue;
+        if ((*dump == ' ' || *dump == '-') && dump[1] == *dump) {
+            dump++;
+            continue;
+        }
+        putchar(*dump++);
+    }
+}
+
+static int run_graph(int profile)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterInOut *inputs = NULL, *outputs = NULL;
+    AVFilterContext *src, *sink;
+    AVFrame *frame = av_frame_alloc();
+    char *dump;
+    int ret;
+
+    if (!graph || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = av_opt_set_int(graph, "profile", profile, 0)) < 0 ||
+        (ret = av_opt_set_int(graph, "threads", 1, 0)) < 0)
+        goto end;
+
+    ret = avfilter_graph_create_filter(&src, avfilter_get_by_name("buffer"), "in",
+                                       "video_size=32x16:pix_fmt=gray:time_base=1/25",
+                                       NULL, graph);
+    if (ret < 0)
+        goto end;
+    ret = avfilter_graph_create_filter(&sink, avfilter_get_by_name("buffersink"), "out",
+                                       NULL, NULL, graph);
+    if (ret < 0)
+        goto end;
+
+    outputs = avfilter_inout_alloc();
+    inputs  = avfilter_inout_alloc();
+    if (!outputs || !inputs) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    outputs->name       = av_strdup("in");
+    outputs->filter_ctx = src;
+    inputs->name        = av_strdup("out");
+    inputs->filter_ctx  = sink;
+    if ((ret = avfilter_graph_parse_ptr(graph, graph_desc, &inputs, &outputs, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    for (int i = 0; i < NB_FRAMES; i++) {
+        frame->format = AV_PIX_FMT_GRAY8;
+        frame->width  = 32;
+        frame->height = 16;
+        frame->pts    = i;
+        if ((ret = av_frame_get_buffer(frame, 0)) < 0)
+            goto end;
+        memset(frame->data[0], i * 16, frame->linesize[0] * frame->height);
+        if ((ret = av_buffersrc_add_frame_flags(src, frame, 0)) < 0)
+            goto end;
+    }
+    if ((ret = av_buffersrc_close(src, NB_FRAMES, 0)) < 0)
+        goto end;
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0)
+        av_frame_unref(frame);
+    if (ret != AVERROR_EOF)
+        goto end;
+
+    dump = avfilter_graph_dump(graph, "stats");
+    if (!dump) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    printf("profile=%d\n", profile);
+    print_dump(dump);
+    av_free(dump);
+    ret = 0;
+
+end:
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    av_frame_free(&frame);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(void)
+{
+    for (int profile = 0; profile <= 1; profile++) {
+        int ret = run_graph(profile);
+        if (ret < 0) {
+            fprintf(stderr, "Failed to run the graph: %s\n", av_err2str(ret));
+            return 1;
+        }
+    }
+    return 0;
+}
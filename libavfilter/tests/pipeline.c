@@ -0,0 +1,183 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/avfilter_internal.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define NB_FRAMES 16
+#define WIDTH     64
+#define HEIGHT    48
+
+static const char *graph_desc =
+    "split[a][b];"
+    "[a]negate,hflip,lutyuv=y=val/2[a1];"
+    "[b]vflip,boxblur=2[b1];"
+    "[a1][b1]blend=all_mode=average,transpose";
+
+typedef struct Output {
+    int64_t pts;
+    uint32_t crc;
+} Output;
+
+static void fill_frame(AVFrame *frame, int n)
+{
+    for (int p = 0; p < 3; p++) {
+        const int w = p ? WIDTH  / 2 : WIDTH;
+        const int h = p ? HEIGHT / 2 : HEIGHT;
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                frame->data[p][y * frame->linesize[p] + x] = x * 3 + y * 5 + n * 7 + p * 64;
+    }
+}
+
+static uint32_t frame_crc(const AVFrame *frame)
+{
+    uint32_t crc = 1;
+
+    for (int p = 0; p < 3; p++) {
+        const int w = p ? frame->width  / 2 : frame->width;
+        const int h = p ? frame->height / 2 : frame->height;
+        for (int y = 0; y < h; y++)
+            crc = av_adler32_update(crc, frame->data[p] + y * frame->linesize[p], w);
+    }
+    return crc;
+}
+
+/* Queue all the input frames before requesting the output, so that several
+ * filters of the graph are ready at the same time. */
+static int run_graph(int pipeline_threads, Output *out, int *nb_out,
+                     unsigned *overlapped)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterInOut *inputs = NULL, *outputs = NULL;
+    AVFilterContext *src, *sink;
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    *nb_out = 0;
+    if (!graph || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = av_opt_set_int(graph, "pipeline_threads", pipeline_threads, 0)) < 0)
+        goto end;
+
+    ret = avfilter_graph_create_filter(&src, avfilter_get_by_name("buffer"), "in",
+                                       "video_size=64x48:pix_fmt=yuv420p:time_base=1/25",
+                                       NULL, graph);
+    if (ret < 0)
+        goto end;
+    ret = avfilter_graph_create_filter(&sink, avfilter_get_by_name("buffersink"), "out",
+                                       NULL, NULL, graph);
+    if (ret < 0)
+        goto end;
+
+    outputs = avfilter_inout_alloc();
+    inputs  = avfilter_inout_alloc();
+    if (!outputs || !inputs) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    outputs->name       = av_strdup("in");
+    outputs->filter_ctx = src;
+    inputs->name        = av_strdup("out");
+    inputs->filter_ctx  = sink;
+    if ((ret = avfilter_graph_parse_ptr(graph, graph_desc, &inputs, &outputs, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    for (int i = 0; i < NB_FRAMES; i++) {
+        frame->format = AV_PIX_FMT_YUV420P;
+        frame->width  = WIDTH;
+        frame->height = HEIGHT;
+        frame->pts    = i;
+        if ((ret = av_frame_get_buffer(frame, 0)) < 0)
+            goto end;
+        fill_frame(frame, i);
+        if ((ret = av_buffersrc_add_frame_flags(src, frame, 0)) < 0)
+            goto end;
+    }
+    if ((ret = av_buffersrc_close(src, NB_FRAMES, 0)) < 0)
+        goto end;
+
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+        if (*nb_out < NB_FRAMES) {
+            out[*nb_out].pts = frame->pts;
+            out[*nb_out].crc = frame_crc(frame);
+        }
+        (*nb_out)++;
+        av_frame_unref(frame);
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+    *overlapped = fffiltergraph(graph)->pipeline_overlapped;
+
+end:
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    av_frame_free(&frame);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(void)
+{
+    Output ref[NB_FRAMES], out[NB_FRAMES];
+    unsigned overlapped;
+    int nb_ref, nb_out, ret;
+
+    if ((ret = run_graph(1, ref, &nb_ref, &overlapped)) < 0) {
+        fprintf(stderr, "Failed to run the graph: %s\n", av_err2str(ret));
+        return 1;
+    }
+    for (int threads = 2; threads <= 4; threads++) {
+        if ((ret = run_graph(threads, out, &nb_out, &overlapped)) < 0) {
+            fprintf(stderr, "Failed to run the graph with %d pipeline threads: %s\n",
+                    threads, av_err2str(ret));
+            return 1;
+        }
+        if (nb_out != nb_ref) {
+            printf("pipeline_threads=%d: %d frames instead of %d\n", threads, nb_out, nb_ref);
+            return 1;
+        }
+        /* the output would also match if every filter ran alone */
+        if (!overlapped) {
+            printf("pipeline_threads=%d: no activations overlapped\n", threads);
+            return 1;
+        }
+        for (int i = 0; i < nb_out; i++) {
+            if (out[i].pts != ref[i].pts || out[i].crc != ref[i].crc) {
+                printf("pipeline_threads=%d: frame %d differs\n", threads, i);
+                return 1;
+            }
+        }
+    }
+
+    for (int i = 0; i < nb_ref; i++)
+        printf("%2d pts %2"PRId64" adler32 0x%08"PRIx32"\n", i, ref[i].pts, ref[i].crc);
+    return 0;
+}
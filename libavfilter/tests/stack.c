@@ -0,0 +1,132 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+
+static const struct {
+    const char *name;
+    const char *graph;
+} tests[] = {
+    /* the inputs fill the output frames in place */
+    { "direct",
+      "testsrc2=s=320x240:r=25:d=1,vflip[a];"
+      "testsrc2=s=320x240:r=25:d=1,hflip[b];"
+      "[a][b]vstack" },
+    /* fewer tiles are written in place when an input repeats frames */
+    { "different rates",
+      "testsrc2=s=320x240:r=25:d=1,vflip[a];"
+      "testsrc2=s=320x240:r=10:d=1,hflip[b];"
+      "[a][b]vstack" },
+    /* split keeps the frames, the tiles are copied */
+    { "copied",
+      "testsrc2=s=320x240:r=25:d=1,vflip,split=1[a];"
+      "testsrc2=s=320x240:r=10:d=1,hflip,split=1[b];"
+      "[a][b]vstack" },
+    { "overlapping",
+      "testsrc2=s=320x240:d=0.2,vflip[a];"
+      "testsrc2=s=320x240:d=0.2,hflip[b];"
+      "[a][b]xstack=layout=0_0|16_16" },
+    { "misaligned",
+      "testsrc2=s=320x240:d=0.2,vflip[a];"
+      "testsrc2=s=320x240:d=0.2,hflip[b];"
+      "[a][b]xstack=layout=0_0|w0+2_0:fill=black" },
+};
+
+/* Print the messages of the stack filters about the direct path. */
+static void log_callback(void *ptr, int level, const char *fmt, va_list vl)
+{
+    const AVClass *avc = ptr ? *(AVClass **)ptr : NULL;
+    const AVFilterContext *ctx = ptr;
+    char line[1024];
+
+    if (level > AV_LOG_VERBOSE || !avc || strcmp(avc->class_name, "AVFilter") ||
+        !strstr(ctx->filter->name, "stack"))
+        return;
+    vsnprintf(line, sizeof(line), fmt, vl);
+    if (strstr(line, "directly"))
+        printf("%s: %s", ctx->filter->name, line);
+}
+
+static int run_graph(const char *graph_desc)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterInOut *inputs = NULL;
+    AVFilterContext *sink;
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!graph || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = av_opt_set_int(graph, "threads", 1, 0)) < 0)
+        goto end;
+    ret = avfilter_graph_create_filter(&sink, avfilter_get_by_name("buffersink"), "out",
+                                       NULL, NULL, graph);
+    if (ret < 0)
+        goto end;
+
+    inputs = avfilter_inout_alloc();
+    if (!inputs) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    inputs->name       = av_strdup("out");
+    inputs->filter_ctx = sink;
+    if ((ret = avfilter_graph_parse_ptr(graph, graph_desc, &inputs, NULL, NULL)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0)
+        av_frame_unref(frame);
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+end:
+    avfilter_inout_free(&inputs);
+    av_frame_free(&frame);
+    /* the number of tiles written directly is logged here */
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(void)
+{
+    av_log_set_level(AV_LOG_VERBOSE);
+    av_log_set_callback(log_callback);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        int ret;
+
+        printf("%s\n", tests[i].name);
+        if ((ret = run_graph(tests[i].graph)) < 0) {
+            fprintf(stderr, "Failed to run the graph: %s\n", av_err2str(ret));
+            return 1;
+        }
+    }
+    return 0;
+}
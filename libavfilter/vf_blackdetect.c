@@ -48,6 +48,7 @@ typedef struct BlackDetectContext {
     double       pixel_black_th;
     unsigned int pixel_black_th_i;
     int          alpha;
+    int          line_step;
 
     unsigned int nb_black_pixels;   ///< number of black pixels counted so far
     AVRational   time_base;
@@ -69,6 +70,7 @@ static const AVOption blackdetect_options[] = {
     { "pixel_black_th", "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
     { "pix_th",         "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
     { "alpha",          "check alpha instead of luma", OFFSET(alpha), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
+    { "line_step",      "analyze only one line out of every line_step", OFFSET(line_step), AV_OPT_TYPE_INT, {.i64=1}, 1, 1024, FLAGS },
     { NULL }
 };
 
@@ -141,9 +143,9 @@ static int config_input(AVFilterLink *inlink)
         return AVERROR(ENOMEM);
 
     av_log(ctx, AV_LOG_VERBOSE,
-           "black_min_duration:%s pixel_black_th:%f picture_black_ratio_th:%f alpha:%d\n",
+           "black_min_duration:%s pixel_black_th:%f picture_black_ratio_th:%f alpha:%d line_step:%d\n",
            av_ts2timestr(s->black_min_duration, &s->time_base),
-           s->pixel_black_th, s->picture_black_ratio_th, s->alpha);
+           s->pixel_black_th, s->picture_black_ratio_th, s->alpha, s->line_step);
     return 0;
 }
 
@@ -166,13 +168,14 @@ static int black_counter(AVFilterContext *ctx, void *arg,
     BlackDetectContext *s = ctx->priv;
     const AVFrame *in = arg;
     const int plane = s->alpha ? 3 : 0;
+    const int step = s->line_step;
     const int linesize = in->linesize[plane];
-    const int h = in->height;
+    const int h = (in->height + step - 1) / step;
     const int start = (h * jobnr) / nb_jobs;
     const int end = (h * (jobnr+1)) / nb_jobs;
 
-    s->counter[jobnr] = s->func(in->data[plane] + start * linesize,
-                                linesize, in->width, end - start,
+    s->counter[jobnr] = s->func(in->data[plane] + start * step * linesize,
+                                linesize * step, in->width, end - start,
                                 s->pixel_black_th_i);
 
     return 0;
@@ -189,18 +192,19 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     const int full = picref->color_range == AVCOL_RANGE_JPEG ||
                      ff_fmt_is_in(picref->format, yuvj_formats) ||
                      s->alpha;
+    const int nb_lines = (inlink->h + s->line_step - 1) / s->line_step;
+    const int nb_jobs = FFMIN(nb_lines, s->nb_threads);
 
     s->pixel_black_th_i = full ? s->pixel_black_th * max :
         // luminance_minimum_value + pixel_black_th * luminance_range_size
         16 * factor + s->pixel_black_th * (235 - 16) * factor;
 
-    ff_filter_execute(ctx, black_counter, picref, NULL,
-                      FFMIN(inlink->h, s->nb_threads));
+    ff_filter_execute(ctx, black_counter, picref, NULL, nb_jobs);
 
-    for (int i = 0; i < s->nb_threads; i++)
+    for (int i = 0; i < nb_jobs; i++)
         s->nb_black_pixels += s->counter[i];
 
-    picture_black_ratio = (double)s->nb_black_pixels / (inlink->w * inlink->h);
+    picture_black_ratio = (double)s->nb_black_pixels / (inlink->w * nb_lines);
 
     av_log(ctx, AV_LOG_DEBUG,
            "frame:%"PRId64" picture_black_ratio:%f pts:%s t:%s type:%c\n",
@@ -548,6 +548,40 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     return ff_filter_frame(outlink, out);
 }
 
+static int get_lut(AVFilterContext *ctx, uint16_t *const luts[4])
+{
+    ColorLevelsContext *s = ctx->priv;
+    const int scale = s->bpp == 1 ? UINT8_MAX : UINT16_MAX;
+
+    if (s->preserve_color || s->depth == 32)
+        return 0;
+
+    for (int i = 0; i < s->nb_comp; i++) {
+        const Range *r = &s->range[i];
+        int imin = lrint(r->in_min  * scale);
+        int imax = lrint(r->in_max  * scale);
+        int omin = lrint(r->out_min * scale);
+        int omax = lrint(r->out_max * scale);
+        float coeff;
+
+        /* black and white points detected from each frame */
+        if (imin < 0 || imax < 0)
+            return 0;
+
+        coeff = (omax - omin) / (double)(imax - imin);
+        for (int v = 0; v <= s->max; v++) {
+            if (s->bpp == 1)
+                luts[i][v] = av_clip_uint8((v - imin) * coeff + omin);
+            else if (s->depth == 16 || !s->planar)
+                luts[i][v] = av_clip_uint16((v - imin) * coeff + omin);
+            else
+                luts[i][v] = av_clip_uintp2((v - imin) * coeff + omin, s->depth);
+        }
+    }
+
+    return 1;
+}
+
 static const AVFilterPad colorlevels_inputs[] = {
     {
         .name         = "default",
@@ -580,4 +614,5 @@ const FFFilter ff_vf_colorlevels = {
                    AV_PIX_FMT_GBRP16, AV_PIX_FMT_GBRAP16,
                    AV_PIX_FMT_GBRPF32, AV_PIX_FMT_GBRAPF32),
     .process_command = ff_filter_process_command,
+    .get_lut         = get_lut,
 };
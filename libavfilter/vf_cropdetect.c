@@ -50,6 +50,9 @@ typedef struct CropDetectContext {
     int window_size;
     int mv_threshold;
     int bitdepth;
+    int line_step;
+    int frame_step;
+    int64_t nb_frames;
     float   low, high;
     uint8_t low_u8, high_u8;
     uint8_t  *filterbuf;
@@ -57,8 +60,16 @@ typedef struct CropDetectContext {
     uint16_t *gradients;
     char     *directions;
     int      *bboxes[4];
+    int      *column_sums;      ///< per-job sums of the scanned columns
+    int       nb_threads;
 } CropDetectContext;
 
+typedef struct ThreadData {
+    const AVFrame *frame;
+    int x_left;                 ///< columns [0, x_left) are scanned
+    int x_right;                ///< columns [x_right, width) are scanned
+} ThreadData;
+
 static const enum AVPixelFormat pix_fmts[] = {
     AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUVJ420P,
     AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUVJ422P,
@@ -142,6 +153,92 @@ static int checkline(void *ctx, const unsigned char *src, int stride, int len, i
     return total;
 }
 
+static int checkcolumn(void *ctx, int total, int div)
+{
+    total /= div;
+
+    av_log(ctx, AV_LOG_DEBUG, "total:%d\n", total);
+    return total;
+}
+
+static void sum_columns(int *sums, const uint8_t *src, int x0, int x1, int bpp)
+{
+    const uint16_t *src16 = (const uint16_t *)src;
+    int x;
+
+    switch (bpp) {
+    case 1:
+        for (x = x0; x < x1; x++)
+            sums[x] += src[x];
+        break;
+    case 2:
+        for (x = x0; x < x1; x++)
+            sums[x] += src16[x];
+        break;
+    case 3:
+    case 4:
+        for (x = x0; x < x1; x++)
+            sums[x] += src[x * bpp] + src[x * bpp + 1] + src[x * bpp + 2];
+        break;
+    }
+}
+
+/**
+ * Sum the columns of the borders, line by line rather than column by
+ * column, which is friendlier to the caches and to the compiler.
+ */
+static int column_sums_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    CropDetectContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *frame = td->frame;
+    const int bpp = s->max_pixsteps[0];
+    const int step = s->line_step;
+    const int lines = (frame->height + step - 1) / step;
+    const int start = (lines *  jobnr     ) / nb_jobs;
+    const int end   = (lines * (jobnr + 1)) / nb_jobs;
+    int *sums = s->column_sums + jobnr * frame->width;
+
+    memset(sums, 0, td->x_left * sizeof(*sums));
+    memset(sums + td->x_right, 0, (frame->width - td->x_right) * sizeof(*sums));
+
+    for (int y = start; y < end; y++) {
+        const uint8_t *src = frame->data[0] + y * step * frame->linesize[0];
+
+        sum_columns(sums, src, 0, td->x_left, bpp);
+        sum_columns(sums, src, td->x_right, frame->width, bpp);
+    }
+    return 0;
+}
+
+static void compute_column_sums(AVFilterContext *ctx, const AVFrame *frame)
+{
+    CropDetectContext *s = ctx->priv;
+    const int lines = (frame->height + s->line_step - 1) / s->line_step;
+    const int nb_jobs = FFMIN(lines, s->nb_threads);
+    ThreadData td = { .frame = frame };
+    int *sums = s->column_sums;
+
+    if (s->x1 < s->x2) {
+        td.x_left  = s->x1;
+        td.x_right = s->x2 + 1;
+    } else {
+        td.x_left  = frame->width;
+        td.x_right = frame->width;
+    }
+
+    ff_filter_execute(ctx, column_sums_slice, &td, NULL, nb_jobs);
+
+    for (int j = 1; j < nb_jobs; j++) {
+        const int *job_sums = s->column_sums + j * frame->width;
+
+        for (int x = 0; x < td.x_left; x++)
+            sums[x] += job_sums[x];
+        for (int x = td.x_right; x < frame->width; x++)
+            sums[x] += job_sums[x];
+    }
+}
+
 static int checkline_edge(void *ctx, const unsigned char *src, int stride, int len, int bpp)
 {
     const uint16_t *src16 = (const uint16_t *)src;
@@ -198,6 +295,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->bboxes[1]);
     av_freep(&s->bboxes[2]);
     av_freep(&s->bboxes[3]);
+    av_freep(&s->column_sums);
 }
 
 static int config_input(AVFilterLink *inlink)
@@ -230,9 +328,12 @@ static int config_input(AVFilterLink *inlink)
     s->bboxes[1]   = av_malloc(s->window_size * sizeof(*s->bboxes[1]));
     s->bboxes[2]   = av_malloc(s->window_size * sizeof(*s->bboxes[2]));
     s->bboxes[3]   = av_malloc(s->window_size * sizeof(*s->bboxes[3]));
+    s->nb_threads  = ff_filter_get_nb_threads(ctx);
+    s->column_sums = av_malloc_array(s->nb_threads * inlink->w, sizeof(*s->column_sums));
 
     if (!s->tmpbuf    || !s->filterbuf || !s->gradients || !s->directions ||
-        !s->bboxes[0] || !s->bboxes[1] || !s->bboxes[2] || !s->bboxes[3])
+        !s->bboxes[0] || !s->bboxes[1] || !s->bboxes[2] || !s->bboxes[3] ||
+        !s->column_sums)
         return AVERROR(ENOMEM);
 
     return 0;
@@ -269,6 +370,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
                           const uint8_t *src, int src_linesize, int src_stride) = (bpp == 2) ? &ff_gaussian_blur_16 : &ff_gaussian_blur_8;
 
 
+    // only analyze one frame out of every s->frame_step
+    if (s->frame_step > 1 && s->nb_frames++ % s->frame_step)
+        return ff_filter_frame(inlink->dst->outputs[0], frame);
+
     // ignore first s->skip frames
     if (++s->frame_nb > 0) {
         metadata = &frame->metadata;
@@ -282,10 +387,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
             s->frame_nb = 1;
         }
 
-#define FIND(DST, FROM, NOEND, INC, STEP0, STEP1, LEN) \
+#define FIND(DST, FROM, NOEND, INC, CHECK) \
         outliers = 0;\
         for (last_y = y = FROM; NOEND; y = y INC) {\
-            if (checkline(ctx, frame->data[0] + STEP0 * y, STEP1, LEN, bpp) > limit_upscaled) {\
+            if (CHECK > limit_upscaled) {\
                 if (++outliers > s->max_outliers) { \
                     DST = last_y;\
                     break;\
@@ -295,10 +400,16 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
         }
 
         if (s->mode == MODE_BLACK) {
-            FIND(s->y1,                 0,               y < s->y1, +1, frame->linesize[0], bpp, frame->width);
-            FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, frame->linesize[0], bpp, frame->width);
-            FIND(s->x1,                 0,               y < s->x1, +1, bpp, frame->linesize[0], frame->height);
-            FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, bpp, frame->linesize[0], frame->height);
+            const int step = s->line_step;
+            const int row_len = (frame->width  + step - 1) / step;
+            const int col_div = (frame->height + step - 1) / step * (bpp >= 3 ? 3 : 1);
+#define CHECK_ROW(y)    checkline(ctx, frame->data[0] + frame->linesize[0] * (y), bpp * step, row_len, bpp)
+#define CHECK_COLUMN(x) checkcolumn(ctx, s->column_sums[x], col_div)
+            FIND(s->y1,                 0,               y < s->y1, +1, CHECK_ROW(y));
+            FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, CHECK_ROW(y));
+            compute_column_sums(ctx, frame);
+            FIND(s->x1,                 0,               y < s->x1, +1, CHECK_COLUMN(y));
+            FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, CHECK_COLUMN(y));
         } else { // MODE_MV_EDGES
             sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
             s->x1 = 0;
@@ -481,6 +592,8 @@ static const AVOption cropdetect_options[] = {
     { "high", "Set high threshold for edge detection",                OFFSET(high),        AV_OPT_TYPE_FLOAT, {.dbl=25/255.}, 0, 1, FLAGS },
     { "low", "Set low threshold for edge detection",                  OFFSET(low),         AV_OPT_TYPE_FLOAT, {.dbl=15/255.}, 0, 1, FLAGS },
     { "mv_threshold", "motion vector threshold when estimating video window size", OFFSET(mv_threshold), AV_OPT_TYPE_INT, {.i64=8}, 0, 100, FLAGS},
+    { "line_step",  "Only use one pixel out of every line_step when averaging a line or column", OFFSET(line_step), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, 1024, FLAGS },
+    { "frame_step", "Only analyze one frame out of every frame_step",   OFFSET(frame_step),  AV_OPT_TYPE_INT, { .i64 = 1 },  1, INT_MAX, FLAGS },
     { NULL }
 };
 
@@ -499,7 +612,8 @@ const FFFilter ff_vf_cropdetect = {
     .p.name        = "cropdetect",
     .p.description = NULL_IF_CONFIG_SMALL("Auto-detect crop size."),
     .p.priv_class  = &cropdetect_class,
-    .p.flags       = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_METADATA_ONLY,
+    .p.flags       = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_METADATA_ONLY |
+                     AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(CropDetectContext),
     .init          = init,
     .uninit        = uninit,
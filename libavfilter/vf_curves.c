@@ -1003,6 +1003,22 @@ static av_cold void curves_uninit(AVFilterContext *ctx)
         av_freep(&curves->graph[i]);
 }
 
+static int get_lut(AVFilterContext *ctx, uint16_t *const luts[4])
+{
+    CurvesContext *curves = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(ctx->inputs[0]->format);
+
+    for (int c = 0; c < desc->nb_components; c++) {
+        if (c < NB_COMP)
+            memcpy(luts[c], curves->graph[c], curves->lut_size * sizeof(*luts[c]));
+        else
+            for (int v = 0; v < curves->lut_size; v++)
+                luts[c][v] = v;
+    }
+
+    return 1;
+}
+
 static const AVFilterPad curves_inputs[] = {
     {
         .name         = "default",
@@ -1036,4 +1052,5 @@ const FFFilter ff_vf_curves = {
                    AV_PIX_FMT_GBRP14,
                    AV_PIX_FMT_GBRP16, AV_PIX_FMT_GBRAP16),
     .process_command = process_command,
+    .get_lut         = get_lut,
 };
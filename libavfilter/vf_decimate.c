@@ -84,17 +84,26 @@ static const AVOption decimate_options[] = {
 
 AVFILTER_DEFINE_CLASS(decimate);
 
-static void calc_diffs(const DecimateContext *dm, struct qitem *q,
-                       const AVFrame *f1, const AVFrame *f2)
+typedef struct ThreadData {
+    const AVFrame *f1, *f2;
+} ThreadData;
+
+static int calc_diffs_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int64_t maxdiff = -1;
+    const DecimateContext *dm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *f1 = td->f1, *f2 = td->f2;
+    /* each job owns a range of block rows */
+    const int start = (dm->nyblocks *  jobnr     ) / nb_jobs;
+    const int end   = (dm->nyblocks * (jobnr + 1)) / nb_jobs;
     int64_t *bdiffs = dm->bdiffs;
-    int plane, i, j;
+    int plane;
 
-    memset(bdiffs, 0, dm->bdiffsize * sizeof(*bdiffs));
+    memset(bdiffs + start * dm->nxblocks, 0,
+           (end - start) * dm->nxblocks * sizeof(*bdiffs));
 
     for (plane = 0; plane < (dm->chroma && f1->data[2] ? 3 : 1); plane++) {
-        int x, y, xl;
+        int x, y, xl, y_start, y_end;
         const int linesize1 = f1->linesize[plane];
         const int linesize2 = f2->linesize[plane];
         const uint8_t *f1p = f1->data[plane];
@@ -109,7 +118,12 @@ static void calc_diffs(const DecimateContext *dm, struct qitem *q,
             hblocky >>= dm->vsub;
         }
 
-        for (y = 0; y < height; y++) {
+        y_start = FFMIN(start * hblocky, height);
+        y_end   = jobnr == nb_jobs - 1 ? height : FFMIN(end * hblocky, height);
+        f1p += y_start * linesize1;
+        f2p += y_start * linesize2;
+
+        for (y = y_start; y < y_end; y++) {
             int ydest = y / hblocky;
             int xdest = 0;
 
@@ -131,6 +145,20 @@ static void calc_diffs(const DecimateContext *dm, struct qitem *q,
             f2p += linesize2;
         }
     }
+    return 0;
+}
+
+static void calc_diffs(AVFilterContext *ctx, struct qitem *q,
+                       const AVFrame *f1, const AVFrame *f2)
+{
+    const DecimateContext *dm = ctx->priv;
+    ThreadData td = { .f1 = f1, .f2 = f2 };
+    int64_t maxdiff = -1;
+    int64_t *bdiffs = dm->bdiffs;
+    int i, j;
+
+    ff_filter_execute(ctx, calc_diffs_slice, &td, NULL,
+                      ff_filter_get_nb_jobs(ctx, dm->nyblocks));
 
     for (i = 0; i < dm->nyblocks - 1; i++) {
         for (j = 0; j < dm->nxblocks - 1; j++) {
@@ -180,7 +208,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             dm->queue[dm->fid].maxbdiff = INT64_MAX;
             dm->queue[dm->fid].totdiff  = INT64_MAX;
         } else {
-            calc_diffs(dm, &dm->queue[dm->fid], prv, in);
+            calc_diffs(ctx, &dm->queue[dm->fid], prv, in);
         }
         if (++dm->fid != dm->cycle)
             return 0;
@@ -454,7 +482,7 @@ const FFFilter ff_vf_decimate = {
     .p.name        = "decimate",
     .p.description = NULL_IF_CONFIG_SMALL("Decimate frames (post field matching filter)."),
     .p.priv_class  = &decimate_class,
-    .p.flags       = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .p.flags       = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
     .init          = decimate_init,
     .activate      = activate,
     .uninit        = decimate_uninit,
@@ -192,8 +192,14 @@ typedef struct TextLine {
                                     ///  the rightmost pixel of the last glyph
     int width64;                    ///< width of the line
     HarfbuzzData hb_data;           ///< libharfbuzz data of this text line
-    GlyphInfo* glyphs;              ///< array of glyphs in this text line
+    GlyphInfo* glyphs;              ///< array of glyphs in this text line,
+                                    ///  positioned relative to the line origin
+    int glyphs_valid;               ///< the glyph positions are up to date
+    int glyphs_x64, glyphs_y64;     ///< subpixel phase of the glyph positions
+    int y;                          ///< line origin relative to the text origin
     int cluster_offset;             ///< the offset at which this line begins
+    char *text;                     ///< source text of the line, to reuse its shaping
+    int text_len;                   ///< length of text in bytes
 } TextLine;
 
 /** A glyph as loaded and rendered using libfreetype */
@@ -315,8 +321,22 @@ typedef struct DrawTextContext {
     int tab_count;                  ///< the number of tab characters
     int blank_advance64;            ///< the size of the space character
     int tab_warning_printed;        ///< ensure the tab warning to be printed only once
+
+    char *cache_text;               ///< expanded text the lines were measured for
+    unsigned int cache_fontsize;    ///< font size the lines were shaped with
+    TextMetrics cache_metrics;      ///< metrics of cache_text
 } DrawTextContext;
 
+typedef struct BlendThreadData {
+    AVFrame *frame;
+    FFDrawColor *color;
+    const TextMetrics *metrics;
+    int x, y;
+    int offset_y;
+    int borderw;
+    int y0, y1;                     ///< rows blended into
+} BlendThreadData;
+
 #define OFFSET(x) offsetof(DrawTextContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 #define TFLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_RUNTIME_PARAM
@@ -444,7 +464,8 @@ static av_cold int set_fontsize(AVFilterContext *ctx, unsigned int fontsize)
     // Whenever the underlying FT_Face changes, harfbuzz has to be notified of the change.
     for (int line = 0; line < s->line_count; line++) {
         TextLine *cur_line = &s->lines[line];
-        hb_ft_font_changed(cur_line->hb_data.font);
+        if (cur_line->hb_data.font)
+            hb_ft_font_changed(cur_line->hb_data.font);
     }
 
     s->fontsize = fontsize;
@@ -1114,6 +1135,27 @@ static int glyph_enu_free(void *opaque, void *elem)
     return 0;
 }
 
+static void hb_destroy(HarfbuzzData *hb);
+
+static void free_lines(TextLine *lines, int line_count)
+{
+    for (int l = 0; l < line_count; l++) {
+        av_freep(&lines[l].glyphs);
+        av_freep(&lines[l].text);
+        hb_destroy(&lines[l].hb_data);
+    }
+    av_free(lines);
+}
+
+/* Drop everything cached about the previously drawn text. */
+static void reset_text_cache(DrawTextContext *s)
+{
+    av_freep(&s->cache_text);
+    s->cache_fontsize = 0;
+    for (int l = 0; l < s->line_count; l++)
+        s->lines[l].glyphs_valid = 0;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     DrawTextContext *s = ctx->priv;
@@ -1129,6 +1171,12 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_tree_destroy(s->glyphs);
     s->glyphs = NULL;
 
+    free_lines(s->lines, s->line_count);
+    s->lines = NULL;
+    s->line_count = 0;
+    av_freep(&s->tab_clusters);
+    av_freep(&s->cache_text);
+
     FT_Done_Face(s->face);
     FT_Stroker_Done(s->stroker);
     FT_Done_FreeType(s->library);
@@ -1154,6 +1202,9 @@ static int config_input(AVFilterLink *inlink)
     ff_draw_color(&s->dc, &s->bordercolor, s->bordercolor.rgba);
     ff_draw_color(&s->dc, &s->boxcolor,    s->boxcolor.rgba);
 
+    /* options affecting the layout may have changed through a command */
+    reset_text_cache(s);
+
     s->var_values[VAR_w]    = s->var_values[VAR_W] = s->var_values[VAR_MAIN_W] = inlink->w;
     s->var_values[VAR_h]    = s->var_values[VAR_H] = s->var_values[VAR_MAIN_H] = inlink->h;
     s->var_values[VAR_SAR]  = inlink->sample_aspect_ratio.num ? av_q2d(inlink->sample_aspect_ratio) : 1;
@@ -1269,46 +1320,41 @@ static void update_alpha(DrawTextContext *s)
         s->alpha = 256 * alpha;
 }
 
-static int draw_glyphs(AVFilterContext *ctx, AVFrame *frame,
-                       FFDrawColor *color,
-                       TextMetrics *metrics,
-                       int x, int y, int borderw)
+/**
+ * Blend the glyphs into a band of rows of the frame, one after the other.
+ * The bands are cut on chroma rows, so that no two jobs blend into the same
+ * row and the result does not depend on the number of jobs.
+ */
+static int blend_glyphs_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     DrawTextContext *s = ctx->priv;
-    int g, l, x1, y1, w1, h1, idx;
-    int dx = 0, dy = 0, pdx = 0;
-    GlyphInfo *info;
-    Glyph dummy = { 0 }, *glyph;
-    FT_Bitmap bitmap;
-    FT_BitmapGlyph b_glyph;
-    uint8_t j_left = 0, j_right = 0, j_top = 0, j_bottom = 0;
-    int line_w, offset_y = 0;
-    int clip_x = 0, clip_y = 0;
-
-    j_left = !!(s->text_align & TA_LEFT);
-    j_right = !!(s->text_align & TA_RIGHT);
-    j_top = !!(s->text_align & TA_TOP);
-    j_bottom = !!(s->text_align & TA_BOTTOM);
-
-    if (j_top && j_bottom) {
-        offset_y = (s->box_height - metrics->height) / 2;
-    } else if (j_bottom) {
-        offset_y = s->box_height - metrics->height;
-    }
+    const BlendThreadData *td = arg;
+    const TextMetrics *metrics = td->metrics;
+    const int align = 1 << s->dc.vsub_max;
+    const uint8_t j_left  = !!(s->text_align & TA_LEFT);
+    const uint8_t j_right = !!(s->text_align & TA_RIGHT);
+    const int clip_x = FFMIN(metrics->rect_x + s->box_width + s->bb_right, td->frame->width);
+    int start = td->y0 + ((td->y1 - td->y0) *  jobnr     ) / nb_jobs;
+    int end   = td->y0 + ((td->y1 - td->y0) * (jobnr + 1)) / nb_jobs;
+
+    if (jobnr)
+        start = FFMIN(FFALIGN(start, align), td->y1);
+    if (jobnr < nb_jobs - 1)
+        end   = FFMIN(FFALIGN(end,   align), td->y1);
+    if (end <= start)
+        return 0;
 
-    if ((!j_left || j_right) && !s->tab_warning_printed && s->tab_count > 0) {
-        s->tab_warning_printed = 1;
-        av_log(ctx, AV_LOG_WARNING, "Tab characters are only supported with left horizontal alignment\n");
-    }
+    for (int l = 0; l < s->line_count; ++l) {
+        const TextLine *line = &s->lines[l];
+        const int line_w = POS_CEIL(line->width64, 64);
 
-    clip_x = FFMIN(metrics->rect_x + s->box_width + s->bb_right, frame->width);
-    clip_y = FFMIN(metrics->rect_y + s->box_height + s->bb_bottom, frame->height);
+        for (int g = 0; g < line->hb_data.glyph_count; ++g) {
+            const GlyphInfo *info = &line->glyphs[g];
+            Glyph dummy = { 0 }, *glyph;
+            FT_BitmapGlyph b_glyph;
+            FT_Bitmap bitmap;
+            int x1, y1, w1, h1, dx = 0, dy = 0, idx;
 
-    for (l = 0; l < s->line_count; ++l) {
-        TextLine *line = &s->lines[l];
-        line_w = POS_CEIL(line->width64, 64);
-        for (g = 0; g < line->hb_data.glyph_count; ++g) {
-            info = &line->glyphs[g];
             dummy.fontsize = s->fontsize;
             dummy.code = info->code;
             glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
@@ -1317,10 +1363,10 @@ static int draw_glyphs(AVFilterContext *ctx, AVFrame *frame,
             }
 
             idx = get_subpixel_idx(info->shift_x64, info->shift_y64);
-            b_glyph = borderw ? glyph->border_bglyph[idx] : glyph->bglyph[idx];
+            b_glyph = td->borderw ? glyph->border_bglyph[idx] : glyph->bglyph[idx];
             bitmap = b_glyph->bitmap;
-            x1 = x + info->x + b_glyph->left;
-            y1 = y + info->y - b_glyph->top + offset_y;
+            x1 = td->x + info->x + b_glyph->left;
+            y1 = td->y + line->y + info->y - b_glyph->top + td->offset_y;
             w1 = bitmap.width;
             h1 = bitmap.rows;
 
@@ -1331,33 +1377,70 @@ static int draw_glyphs(AVFilterContext *ctx, AVFrame *frame,
             }
 
             // Offset of the glyph's bitmap in the visible region
-            dx = dy = 0;
             if (x1 < metrics->rect_x - s->bb_left) {
                 dx = metrics->rect_x - s->bb_left - x1;
                 x1 = metrics->rect_x - s->bb_left;
             }
-            if (y1 < metrics->rect_y - s->bb_top) {
-                dy = metrics->rect_y - s->bb_top - y1;
-                y1 = metrics->rect_y - s->bb_top;
+            if (y1 < start) {
+                dy = start - y1;
+                y1 = start;
             }
 
             // check if the glyph is empty or out of the clipping region
-            if (dx >= w1 || dy >= h1 || x1 >= clip_x || y1 >= clip_y) {
+            if (dx >= w1 || dy >= h1 || x1 >= clip_x || y1 >= end) {
                 continue;
             }
 
-            pdx = dx + dy * bitmap.pitch;
             w1 = FFMIN(clip_x - x1, w1 - dx);
-            h1 = FFMIN(clip_y - y1, h1 - dy);
+            h1 = FFMIN(end - y1, h1 - dy);
 
-            ff_blend_mask(&s->dc, color, frame->data, frame->linesize, clip_x, clip_y,
-                bitmap.buffer + pdx, bitmap.pitch, w1, h1, 3, 0, x1, y1);
+            ff_blend_mask(&s->dc, td->color, td->frame->data, td->frame->linesize, clip_x, end,
+                bitmap.buffer + dx + dy * bitmap.pitch, bitmap.pitch, w1, h1, 3, 0, x1, y1);
         }
     }
 
     return 0;
 }
 
+static int draw_glyphs(AVFilterContext *ctx, AVFrame *frame,
+                       FFDrawColor *color,
+                       TextMetrics *metrics,
+                       int x, int y, int borderw)
+{
+    DrawTextContext *s = ctx->priv;
+    const uint8_t j_left   = !!(s->text_align & TA_LEFT);
+    const uint8_t j_right  = !!(s->text_align & TA_RIGHT);
+    const uint8_t j_top    = !!(s->text_align & TA_TOP);
+    const uint8_t j_bottom = !!(s->text_align & TA_BOTTOM);
+    BlendThreadData td = { 0 };
+
+    if (j_top && j_bottom) {
+        td.offset_y = (s->box_height - metrics->height) / 2;
+    } else if (j_bottom) {
+        td.offset_y = s->box_height - metrics->height;
+    }
+
+    if ((!j_left || j_right) && !s->tab_warning_printed && s->tab_count > 0) {
+        s->tab_warning_printed = 1;
+        av_log(ctx, AV_LOG_WARNING, "Tab characters are only supported with left horizontal alignment\n");
+    }
+
+    td.frame   = frame;
+    td.color   = color;
+    td.metrics = metrics;
+    td.x       = x;
+    td.y       = y;
+    td.borderw = borderw;
+    td.y0      = FFMAX(metrics->rect_y - s->bb_top, 0);
+    td.y1      = FFMIN(metrics->rect_y + s->box_height + s->bb_bottom, frame->height);
+    if (td.y1 <= td.y0)
+        return 0;
+
+    return ff_filter_execute(ctx, blend_glyphs_slice, &td, NULL,
+                             av_clip((td.y1 - td.y0) >> s->dc.vsub_max, 1,
+                                     ff_filter_get_nb_threads(ctx)));
+}
+
 // Shapes a line of text using libharfbuzz
 static int shape_text_hb(DrawTextContext *s, HarfbuzzData* hb, const char* text, int textLen)
 {
@@ -1404,11 +1487,16 @@ static int measure_text(AVFilterContext *ctx, TextMetrics *metrics)
     int line_count = 0;
     uint32_t code = 0;
     Glyph *glyph = NULL;
+    TextLine *old_lines = s->lines;
+    int old_line_count = s->line_count;
 
     int i, tab_idx = 0, last_tab_idx = 0, line_offset = 0;
     char* p;
     int ret = 0;
 
+    s->lines = NULL;
+    s->line_count = 0;
+
     // Count the lines and the tab characters
     s->tab_count = 0;
     for (i = 0, p = text; 1; i++) {
@@ -1435,9 +1523,20 @@ continue_on_failed:
         hb_destroy(&hb_data);
     }
 
+    // The lines of the previous text are kept until the new ones are shaped,
+    // so that the lines which did not change reuse their shaping
+    s->lines = av_calloc(line_count, sizeof(*s->lines));
+    if (!s->lines) {
+        ret = AVERROR(ENOMEM);
+        goto done;
+    }
     s->line_count = line_count;
-    s->lines = av_mallocz(line_count * sizeof(TextLine));
-    s->tab_clusters = av_mallocz(s->tab_count * sizeof(uint32_t));
+    av_freep(&s->tab_clusters);
+    s->tab_clusters = av_calloc(s->tab_count, sizeof(*s->tab_clusters));
+    if (s->tab_count && !s->tab_clusters) {
+        ret = AVERROR(ENOMEM);
+        goto done;
+    }
     for (i = 0; i < s->tab_count; ++i) {
         s->tab_clusters[i] = -1;
     }
@@ -1457,12 +1556,28 @@ continue_on_failed:
 continue_on_failed2:
         if (ff_is_newline(code) || code == 0) {
             TextLine *cur_line = &s->lines[line_count];
+            TextLine *old_line = line_count < old_line_count ? &old_lines[line_count] : NULL;
             HarfbuzzData *hb = &cur_line->hb_data;
-            cur_line->cluster_offset = line_offset;
-            ret = shape_text_hb(s, hb, start, num_chars);
-            if (ret != 0) {
-                goto done;
+            const char *line_text = text + (start - textdup);
+            int line_len = p - start;
+            if (old_line && old_line->text && s->cache_fontsize == s->fontsize &&
+                old_line->text_len == line_len &&
+                !memcmp(old_line->text, line_text, line_len)) {
+                // Take the shaping and glyph positions of the old line
+                FFSWAP(TextLine, *cur_line, *old_line);
+            } else {
+                ret = shape_text_hb(s, hb, start, num_chars);
+                if (ret != 0) {
+                    goto done;
+                }
+                cur_line->text = av_memdup(line_text, line_len);
+                if (!cur_line->text) {
+                    ret = AVERROR(ENOMEM);
+                    goto done;
+                }
+                cur_line->text_len = line_len;
             }
+            cur_line->cluster_offset = line_offset;
             w64 = 0;
             cur_min_y64 = 32000;
             for (int t = 0; t < hb->glyph_count; ++t) {
@@ -1547,6 +1662,7 @@ continue_on_failed2:
     metrics->max_y64 = max_y64;
 
 done:
+    free_lines(old_lines, old_line_count);
     av_free(textdup);
     return ret;
 }
@@ -1558,7 +1674,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
     FilterLink *inl = ff_filter_link(inlink);
     int x = 0, y = 0, ret;
     int shift_x64, shift_y64;
-    int x64, y64;
+    int x64, y64, px64, py64, ox, oy;
     Glyph *glyph = NULL;
 
     time_t now = time(0);
@@ -1625,8 +1741,21 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
         return ret;
     }
 
-    if ((ret = measure_text(ctx, &metrics)) < 0) {
-        return ret;
+    if (s->cache_text && s->cache_fontsize == s->fontsize &&
+        !strcmp(s->cache_text, bp->str)) {
+        metrics = s->cache_metrics;
+    } else {
+        // cache_fontsize is kept, measure_text() uses it to reuse the lines
+        // which did not change
+        av_freep(&s->cache_text);
+        if ((ret = measure_text(ctx, &metrics)) < 0) {
+            return ret;
+        }
+        s->cache_text = av_strdup(bp->str);
+        if (!s->cache_text)
+            return AVERROR(ENOMEM);
+        s->cache_fontsize = s->fontsize;
+        s->cache_metrics = metrics;
     }
 
     s->max_glyph_h = POS_CEIL(metrics.max_y64 - metrics.min_y64, 64);
@@ -1718,11 +1847,37 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
         y64 = (int)(s->y * 64. + metrics.offset_top64);
     }
 
+    // The glyph positions of a line only depend on the subpixel phase of its
+    // origin, they are computed relative to the integer part of the origin
+    px64 = x64 & 63;
+    py64 = y64 & 63;
+    ox = x64 >> 6;
+    oy = y64 >> 6;
     for (int l = 0; l < s->line_count; ++l) {
         TextLine *line = &s->lines[l];
         HarfbuzzData *hb = &line->hb_data;
-        line->glyphs = av_mallocz(hb->glyph_count * sizeof(GlyphInfo));
+        const int line_y64 = py64 + y;
+        const int lpy64 = line_y64 & 63;
+        int ly = 0;
+
+        line->y = line_y64 >> 6;
+        while (last_tab_idx < s->tab_count &&
+               s->tab_clusters[last_tab_idx] < line->cluster_offset)
+            ++last_tab_idx;
+
+        if (line->glyphs_valid && px64 == line->glyphs_x64 && lpy64 == line->glyphs_y64) {
+            for (int t = 0; t < hb->glyph_count; ++t)
+                ly += hb->glyph_pos[t].y_advance;
+            y += ly + metrics.line_height64 + s->line_spacing * 64;
+            continue;
+        }
 
+        av_freep(&line->glyphs);
+        line->glyphs = av_calloc(hb->glyph_count, sizeof(*line->glyphs));
+        if (!line->glyphs)
+            return AVERROR(ENOMEM);
+
+        x = 0;
         for (int t = 0; t < hb->glyph_count; ++t) {
             GlyphInfo *g_info = &line->glyphs[t];
             uint8_t is_tab = last_tab_idx < s->tab_count &&
@@ -1732,17 +1887,17 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
                 ++last_tab_idx;
             }
             true_x = x + hb->glyph_pos[t].x_offset;
-            true_y = y + hb->glyph_pos[t].y_offset;
-            shift_x64 = (((x64 + true_x) >> 4) & 0b0011) << 4;
-            shift_y64 = ((4 - (((y64 + true_y) >> 4) & 0b0011)) & 0b0011) << 4;
+            true_y = ly + hb->glyph_pos[t].y_offset;
+            shift_x64 = (((px64 + true_x) >> 4) & 0b0011) << 4;
+            shift_y64 = ((4 - (((lpy64 + true_y) >> 4) & 0b0011)) & 0b0011) << 4;
 
             ret = load_glyph(ctx, &glyph, hb->glyph_info[t].codepoint, shift_x64, shift_y64);
             if (ret != 0) {
                 return ret;
             }
             g_info->code = hb->glyph_info[t].codepoint;
-            g_info->x = (x64 + true_x) >> 6;
-            g_info->y = ((y64 + true_y) >> 6) + (shift_y64 > 0 ? 1 : 0);
+            g_info->x = (px64 + true_x) >> 6;
+            g_info->y = ((lpy64 + true_y) >> 6) + (shift_y64 > 0 ? 1 : 0);
             g_info->shift_x64 = shift_x64;
             g_info->shift_y64 = shift_y64;
 
@@ -1752,11 +1907,13 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
                 int size = s->blank_advance64 * s->tabsize;
                 x = (x / size + 1) * size;
             }
-            y += hb->glyph_pos[t].y_advance;
+            ly += hb->glyph_pos[t].y_advance;
         }
 
-        y += metrics.line_height64 + s->line_spacing * 64;
-        x = 0;
+        line->glyphs_valid = 1;
+        line->glyphs_x64 = px64;
+        line->glyphs_y64 = lpy64;
+        y += ly + metrics.line_height64 + s->line_spacing * 64;
     }
 
     metrics.rect_x = s->x;
@@ -1799,33 +1956,24 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame)
 
         if (s->shadowx || s->shadowy) {
             if ((ret = draw_glyphs(ctx, frame, &shadowcolor, &metrics,
-                    s->shadowx, s->shadowy, s->borderw)) < 0) {
+                    ox + s->shadowx, oy + s->shadowy, s->borderw)) < 0) {
                 return ret;
             }
         }
 
         if (s->borderw) {
             if ((ret = draw_glyphs(ctx, frame, &bordercolor, &metrics,
-                    0, 0, s->borderw)) < 0) {
+                    ox, oy, s->borderw)) < 0) {
                 return ret;
             }
         }
 
-        if ((ret = draw_glyphs(ctx, frame, &fontcolor, &metrics, 0,
-                0, 0)) < 0) {
+        if ((ret = draw_glyphs(ctx, frame, &fontcolor, &metrics, ox,
+                oy, 0)) < 0) {
             return ret;
         }
     }
 
-    // FREE data structures
-    for (int l = 0; l < s->line_count; ++l) {
-        TextLine *line = &s->lines[l];
-        av_freep(&line->glyphs);
-        hb_destroy(&line->hb_data);
-    }
-    av_freep(&s->lines);
-    av_freep(&s->tab_clusters);
-
     return 0;
 }
 
@@ -1906,7 +2054,7 @@ const FFFilter ff_vf_drawtext = {
     .p.name        = "drawtext",
     .p.description = NULL_IF_CONFIG_SMALL("Draw text on top of video frames using libfreetype library."),
     .p.priv_class  = &drawtext_class,
-    .p.flags       = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .p.flags       = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(DrawTextContext),
     .init          = init,
     .uninit        = uninit,
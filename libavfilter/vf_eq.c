@@ -29,6 +29,7 @@
 
 #include "libavutil/common.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/mem_internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 
@@ -300,6 +301,35 @@ static int process_command(AVFilterContext *ctx, const char *cmd, const char *ar
     else return AVERROR(ENOSYS);
 }
 
+static int get_lut(AVFilterContext *ctx, uint16_t *const luts[4])
+{
+    EQContext *eq = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(ctx->inputs[0]->format);
+    DECLARE_ALIGNED(32, uint8_t, ramp)[256];
+    DECLARE_ALIGNED(32, uint8_t, dst)[256];
+
+    if (eq->eval_mode == EVAL_MODE_FRAME)
+        return 0;
+
+    for (int v = 0; v < 256; v++)
+        ramp[v] = v;
+
+    for (int i = 0; i < desc->nb_components; i++) {
+        if (i == 3 || !eq->param[i].adjust) {
+            for (int v = 0; v < 256; v++)
+                luts[i][v] = v;
+            continue;
+        }
+
+        eq->param[i].adjust(&eq->param[i], dst, sizeof(dst), ramp, sizeof(ramp),
+                            sizeof(ramp), 1);
+        for (int v = 0; v < 256; v++)
+            luts[i][v] = dst[v];
+    }
+
+    return 1;
+}
+
 static const AVFilterPad eq_inputs[] = {
     {
         .name = "default",
@@ -347,6 +377,7 @@ const FFFilter ff_vf_eq = {
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_PIXFMTS_ARRAY(pixel_fmts_eq),
     .process_command = process_command,
+    .get_lut         = get_lut,
     .init            = initialize,
     .uninit          = uninit,
 };
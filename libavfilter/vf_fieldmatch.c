@@ -108,11 +108,30 @@ typedef struct FieldMatchContext {
     int map_linesize[4];
     uint8_t *cmask_data[4];
     int cmask_linesize[4];
-    int *c_array;
+    int *c_array;                   ///< combed block counts, one array per job
+    int c_array_size;
+    int64_t *sums;                  ///< per-job partial sums of the metrics
+    int nb_threads;
     int tpitchy, tpitchuv;
     uint8_t *tbuffer;
 } FieldMatchContext;
 
+typedef struct ThreadData {
+    const AVFrame *f1, *f2;
+
+    /* compare_fields() */
+    int plane, width, height;
+    int y0a, y1a, startx, stopx;
+    const uint8_t *prvp, *nxtp;     ///< fields the diff map is built from
+    int prvd_linesize, nxtd_linesize;
+    uint8_t *dstp;                  ///< diff map destination
+    const uint8_t *srcpf, *srcf, *srcnf;
+    const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
+    int srcf_linesize, prvf_linesize, nxtf_linesize;
+    const uint8_t *mapp;
+    int map_linesize;
+} ThreadData;
+
 #define OFFSET(x) offsetof(FieldMatchContext, x)
 #define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
 
@@ -165,23 +184,40 @@ static int get_height(const FieldMatchContext *fm, const AVFrame *f, int plane,
     return plane ? AV_CEIL_RSHIFT(f->height, fm->vsub[input]) : f->height;
 }
 
-static int64_t luma_abs_diff(const AVFrame *f1, const AVFrame *f2)
+static int luma_abs_diff_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y;
-    const uint8_t *srcp1 = f1->data[0];
-    const uint8_t *srcp2 = f2->data[0];
+    FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *f1 = td->f1, *f2 = td->f2;
     const int src1_linesize = f1->linesize[0];
     const int src2_linesize = f2->linesize[0];
     const int width  = f1->width;
-    const int height = f1->height;
+    const int start = (f1->height *  jobnr     ) / nb_jobs;
+    const int end   = (f1->height * (jobnr + 1)) / nb_jobs;
+    const uint8_t *srcp1 = f1->data[0] + start * src1_linesize;
+    const uint8_t *srcp2 = f2->data[0] + start * src2_linesize;
     int64_t acc = 0;
 
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++)
+    for (int y = start; y < end; y++) {
+        for (int x = 0; x < width; x++)
             acc += abs(srcp1[x] - srcp2[x]);
         srcp1 += src1_linesize;
         srcp2 += src2_linesize;
     }
+    fm->sums[jobnr] = acc;
+    return 0;
+}
+
+static int64_t luma_abs_diff(AVFilterContext *ctx, const AVFrame *f1, const AVFrame *f2)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const int nb_jobs = FFMIN(f1->height, fm->nb_threads);
+    ThreadData td = { .f1 = f1, .f2 = f2 };
+    int64_t acc = 0;
+
+    ff_filter_execute(ctx, luma_abs_diff_slice, &td, NULL, nb_jobs);
+    for (int i = 0; i < nb_jobs; i++)
+        acc += fm->sums[i];
     return acc;
 }
 
@@ -195,25 +231,30 @@ static void fill_buf(uint8_t *data, int w, int h, int linesize, uint8_t v)
     }
 }
 
-static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
+static int combed_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y, plane, max_v = 0;
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *src = td->f1;
+    int x, y, plane;
     const int cthresh = fm->cthresh;
     const int cthresh6 = cthresh * 6;
 
     for (plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
-        const uint8_t *srcp = src->data[plane];
         const int src_linesize = src->linesize[plane];
         const int width  = get_width (fm, src, plane, INPUT_MAIN);
         const int height = get_height(fm, src, plane, INPUT_MAIN);
-        uint8_t *cmkp = fm->cmask_data[plane];
+        const int start = (height *  jobnr     ) / nb_jobs;
+        const int end   = (height * (jobnr + 1)) / nb_jobs;
+        const uint8_t *srcp = src->data[plane] + start * src_linesize;
         const int cmk_linesize = fm->cmask_linesize[plane];
+        uint8_t *cmkp = fm->cmask_data[plane] + start * cmk_linesize;
 
         if (cthresh < 0) {
-            fill_buf(cmkp, width, height, cmk_linesize, 0xff);
+            fill_buf(cmkp, width, end - start, cmk_linesize, 0xff);
             continue;
         }
-        fill_buf(cmkp, width, height, cmk_linesize, 0);
+        fill_buf(cmkp, width, end - start, cmk_linesize, 0);
 
         /* [1 -3 4 -3 1] vertical filter */
 #define FILTER(xm2, xm1, xp1, xp2) \
@@ -221,107 +262,125 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
              -3 * (srcp[x + (xm1)*src_linesize] + srcp[x + (xp1)*src_linesize]) \
              +    (srcp[x + (xm2)*src_linesize] + srcp[x + (xp2)*src_linesize])) > cthresh6
 
-        /* first line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && FILTER(2, 1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* second line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* all lines minus first two and last two */
-        for (y = 2; y < height-2; y++) {
-            for (x = 0; x < width; x++) {
-                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-                const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-                if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
-                    cmkp[x] = 0xff;
+        for (y = start; y < end; y++) {
+            if (y == 0) {
+                /* first line */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && FILTER(2, 1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y == 1) {
+                /* second line */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y < height - 2) {
+                /* all lines minus first two and last two */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y == height - 2) {
+                /* before-last line */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
+                        cmkp[x] = 0xff;
+                }
+            } else {
+                /* last line */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    if (s1 > cthresh && FILTER(-2, -1, -1, -2))
+                        cmkp[x] = 0xff;
+                }
             }
             srcp += src_linesize;
             cmkp += cmk_linesize;
         }
-
-        /* before-last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            if (s1 > cthresh && FILTER(-2, -1, -1, -2))
-                cmkp[x] = 0xff;
-        }
     }
+    return 0;
+}
 
-    if (fm->chroma) {
-        uint8_t *cmkp  = fm->cmask_data[0];
-        uint8_t *cmkpU = fm->cmask_data[1];
-        uint8_t *cmkpV = fm->cmask_data[2];
-        const int width  = AV_CEIL_RSHIFT(src->width,  fm->hsub[INPUT_MAIN]);
-        const int height = AV_CEIL_RSHIFT(src->height, fm->vsub[INPUT_MAIN]);
-        const int cmk_linesize   = fm->cmask_linesize[0] << 1;
-        const int cmk_linesizeUV = fm->cmask_linesize[2];
-        uint8_t *cmkpp  = cmkp - (cmk_linesize>>1);
-        uint8_t *cmkpn  = cmkp + (cmk_linesize>>1);
-        uint8_t *cmkpnn = cmkp +  cmk_linesize;
-        for (y = 1; y < height - 1; y++) {
-            cmkpp  += cmk_linesize;
-            cmkp   += cmk_linesize;
-            cmkpn  += cmk_linesize;
-            cmkpnn += cmk_linesize;
-            cmkpV  += cmk_linesizeUV;
-            cmkpU  += cmk_linesizeUV;
-            for (x = 1; x < width - 1; x++) {
+static int combed_chroma_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *src = td->f1;
+    int x, y;
+    const int width  = AV_CEIL_RSHIFT(src->width,  fm->hsub[INPUT_MAIN]);
+    const int height = AV_CEIL_RSHIFT(src->height, fm->vsub[INPUT_MAIN]);
+    /* a chroma line y spreads over the luma lines 2y-1 to 2y+1 when odd and
+     * 2y to 2y+2 when even, so the jobs start on even lines to never write
+     * to the same luma lines */
+    const int start = jobnr ? av_clip((height *  jobnr     / nb_jobs) & ~1, 1, height - 1) : 1;
+    const int end   = jobnr < nb_jobs - 1 ?
+                      av_clip((height * (jobnr + 1) / nb_jobs) & ~1, 1, height - 1) : height - 1;
+    const int cmk_linesize   = fm->cmask_linesize[0] << 1;
+    const int cmk_linesizeUV = fm->cmask_linesize[2];
+    uint8_t *cmkp  = fm->cmask_data[0] + (start - 1) * cmk_linesize;
+    uint8_t *cmkpU = fm->cmask_data[1] + (start - 1) * cmk_linesizeUV;
+    uint8_t *cmkpV = fm->cmask_data[2] + (start - 1) * cmk_linesizeUV;
+    uint8_t *cmkpp  = cmkp - (cmk_linesize>>1);
+    uint8_t *cmkpn  = cmkp + (cmk_linesize>>1);
+    uint8_t *cmkpnn = cmkp +  cmk_linesize;
+
+    for (y = start; y < end; y++) {
+        cmkpp  += cmk_linesize;
+        cmkp   += cmk_linesize;
+        cmkpn  += cmk_linesize;
+        cmkpnn += cmk_linesize;
+        cmkpV  += cmk_linesizeUV;
+        cmkpU  += cmk_linesizeUV;
+        for (x = 1; x < width - 1; x++) {
 #define HAS_FF_AROUND(p, lz) (p[(x)-1 - (lz)] == 0xff || p[(x) - (lz)] == 0xff || p[(x)+1 - (lz)] == 0xff || \
                               p[(x)-1       ] == 0xff ||                          p[(x)+1       ] == 0xff || \
                               p[(x)-1 + (lz)] == 0xff || p[(x) + (lz)] == 0xff || p[(x)+1 + (lz)] == 0xff)
-                if ((cmkpV[x] == 0xff && HAS_FF_AROUND(cmkpV, cmk_linesizeUV)) ||
-                    (cmkpU[x] == 0xff && HAS_FF_AROUND(cmkpU, cmk_linesizeUV))) {
-                    ((uint16_t*)cmkp)[x]  = 0xffff;
-                    ((uint16_t*)cmkpn)[x] = 0xffff;
-                    if (y&1) ((uint16_t*)cmkpp)[x]  = 0xffff;
-                    else     ((uint16_t*)cmkpnn)[x] = 0xffff;
-                }
+            if ((cmkpV[x] == 0xff && HAS_FF_AROUND(cmkpV, cmk_linesizeUV)) ||
+                (cmkpU[x] == 0xff && HAS_FF_AROUND(cmkpU, cmk_linesizeUV))) {
+                ((uint16_t*)cmkp)[x]  = 0xffff;
+                ((uint16_t*)cmkpn)[x] = 0xffff;
+                if (y&1) ((uint16_t*)cmkpp)[x]  = 0xffff;
+                else     ((uint16_t*)cmkpnn)[x] = 0xffff;
             }
         }
     }
+    return 0;
+}
 
-    {
-        const int blockx = fm->blockx;
-        const int blocky = fm->blocky;
-        const int xhalf = blockx/2;
-        const int yhalf = blocky/2;
-        const int cmk_linesize = fm->cmask_linesize[0];
-        const uint8_t *cmkp    = fm->cmask_data[0] + cmk_linesize;
-        const int width  = src->width;
-        const int height = src->height;
-        const int xblocks = ((width+xhalf)/blockx) + 1;
-        const int xblocks4 = xblocks<<2;
-        const int yblocks = ((height+yhalf)/blocky) + 1;
-        int *c_array = fm->c_array;
-        const int arraysize = (xblocks*yblocks)<<2;
-        int      heighta = (height/(blocky/2))*(blocky/2);
-        const int widtha = (width /(blockx/2))*(blockx/2);
-        if (heighta == height)
-            heighta = height - yhalf;
-        memset(c_array, 0, arraysize * sizeof(*c_array));
+static int combed_blocks_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *src = td->f1;
+    int x, y;
+    const int blockx = fm->blockx;
+    const int blocky = fm->blocky;
+    const int xhalf = blockx/2;
+    const int yhalf = blocky/2;
+    const int cmk_linesize = fm->cmask_linesize[0];
+    const uint8_t *cmkp;
+    const int width  = src->width;
+    const int height = src->height;
+    const int xblocks = ((width+xhalf)/blockx) + 1;
+    const int xblocks4 = xblocks<<2;
+    int *c_array = fm->c_array + jobnr * fm->c_array_size;
+    int      heighta = (height/(blocky/2))*(blocky/2);
+    const int widtha = (width /(blockx/2))*(blockx/2);
+    int nb_bands, band_start, band_end;
+    if (heighta == height)
+        heighta = height - yhalf;
+    nb_bands   = FFMAX(0, (heighta - 1) / yhalf);
+    band_start = (nb_bands *  jobnr     ) / nb_jobs;
+    band_end   = (nb_bands * (jobnr + 1)) / nb_jobs;
+    memset(c_array, 0, fm->c_array_size * sizeof(*c_array));
 
 #define C_ARRAY_ADD(v) do {                         \
     const int box1 = (x / blockx) * 4;              \
@@ -345,50 +404,77 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
     }                                                                       \
 } while (0)
 
+    if (jobnr == 0) {
+        cmkp = fm->cmask_data[0] + cmk_linesize;
         VERTICAL_HALF(1, yhalf);
+    }
 
-        for (y = yhalf; y < heighta; y += yhalf) {
-            const int temp1 = (y / blocky) * xblocks4;
-            const int temp2 = ((y + yhalf) / blocky) * xblocks4;
-
-            for (x = 0; x < widtha; x += xhalf) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, v, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    for (v = 0; v < xhalf; v++)
-                        if (cmkp_tmp[v - cmk_linesize] == 0xff &&
-                            cmkp_tmp[v               ] == 0xff &&
-                            cmkp_tmp[v + cmk_linesize] == 0xff)
-                            sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            for (x = widtha; x < width; x++) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    if (cmkp_tmp[-cmk_linesize] == 0xff &&
-                        cmkp_tmp[            0] == 0xff &&
-                        cmkp_tmp[ cmk_linesize] == 0xff)
+    cmkp = fm->cmask_data[0] + (band_start + 1) * yhalf * cmk_linesize;
+    for (y = (band_start + 1) * yhalf; y < (band_end + 1) * yhalf; y += yhalf) {
+        const int temp1 = (y / blocky) * xblocks4;
+        const int temp2 = ((y + yhalf) / blocky) * xblocks4;
+
+        for (x = 0; x < widtha; x += xhalf) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, v, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                for (v = 0; v < xhalf; v++)
+                    if (cmkp_tmp[v - cmk_linesize] == 0xff &&
+                        cmkp_tmp[v               ] == 0xff &&
+                        cmkp_tmp[v + cmk_linesize] == 0xff)
                         sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
+                cmkp_tmp += cmk_linesize;
             }
+            if (sum)
+                C_ARRAY_ADD(sum);
+        }
 
-            cmkp += cmk_linesize * yhalf;
+        for (x = widtha; x < width; x++) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                if (cmkp_tmp[-cmk_linesize] == 0xff &&
+                    cmkp_tmp[            0] == 0xff &&
+                    cmkp_tmp[ cmk_linesize] == 0xff)
+                    sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
 
+        cmkp += cmk_linesize * yhalf;
+    }
+
+    if (jobnr == nb_jobs - 1) {
+        /* the mask pointer is where the last band left it */
+        cmkp = fm->cmask_data[0] + (nb_bands + 1) * yhalf * cmk_linesize;
         VERTICAL_HALF(heighta, height - 1);
+    }
+    return 0;
+}
 
-        for (x = 0; x < arraysize; x++)
-            if (c_array[x] > max_v)
-                max_v = c_array[x];
+static int calc_combed_score(AVFilterContext *ctx, const AVFrame *src)
+{
+    FieldMatchContext *fm = ctx->priv;
+    ThreadData td = { .f1 = src };
+    const int nb_jobs = av_clip(src->height / 2, 1, fm->nb_threads);
+    int i, j, max_v = 0;
+
+    ff_filter_execute(ctx, combed_mask_slice, &td, NULL,
+                      ff_filter_get_nb_jobs(ctx, AV_CEIL_RSHIFT(src->height, fm->vsub[INPUT_MAIN])));
+    if (fm->chroma)
+        ff_filter_execute(ctx, combed_chroma_slice, &td, NULL, nb_jobs);
+    ff_filter_execute(ctx, combed_blocks_slice, &td, NULL, nb_jobs);
+
+    for (j = 1; j < nb_jobs; j++) {
+        const int *c_array = fm->c_array + j * fm->c_array_size;
+        for (i = 0; i < fm->c_array_size; i++)
+            fm->c_array[i] += c_array[i];
     }
+    for (i = 0; i < fm->c_array_size; i++)
+        if (fm->c_array[i] > max_v)
+            max_v = fm->c_array[i];
     return max_v;
 }
 
@@ -411,23 +497,34 @@ static void build_abs_diff_mask(const uint8_t *prvp, int prv_linesize,
     }
 }
 
+static int abs_diff_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const int tpitch = td->plane ? fm->tpitchuv : fm->tpitchy;
+    const int height = td->height >> 1;
+    const int start = (height *  jobnr     ) / nb_jobs;
+    const int end   = (height * (jobnr + 1)) / nb_jobs;
+
+    build_abs_diff_mask(td->prvp + start * td->prvd_linesize, td->prvd_linesize,
+                        td->nxtp + start * td->nxtd_linesize, td->nxtd_linesize,
+                        fm->tbuffer + start * tpitch, tpitch, td->width, end - start);
+    return 0;
+}
+
 /**
- * Build a map over which pixels differ a lot/a little
+ * Build a map over which pixels differ a lot/a little, for the lines
+ * [y_start, y_end) of the (y += 2) iteration
  */
-static void build_diff_map(FieldMatchContext *fm,
-                           const uint8_t *prvp, int prv_linesize,
-                           const uint8_t *nxtp, int nxt_linesize,
+static void build_diff_map(const FieldMatchContext *fm,
                            uint8_t *dstp, int dst_linesize, int height,
-                           int width, int plane)
+                           int width, int plane, int y_start, int y_end)
 {
     int x, y, u, diff, count;
     int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
-    const uint8_t *dp = fm->tbuffer + tpitch;
+    const uint8_t *dp = fm->tbuffer + tpitch * (y_start >> 1);
 
-    build_abs_diff_mask(prvp, prv_linesize, nxtp, nxt_linesize,
-                        fm->tbuffer, tpitch, width, height>>1);
-
-    for (y = 2; y < height - 2; y += 2) {
+    for (y = y_start; y < y_end; y += 2) {
         for (x = 1; x < width - 1; x++) {
             diff = dp[x];
             if (diff > 3) {
@@ -472,6 +569,92 @@ static void build_diff_map(FieldMatchContext *fm,
     }
 }
 
+static int diff_map_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const int nb_lines = FFMAX(0, (td->height - 3) / 2);
+    const int start = 2 + 2 * ((nb_lines *  jobnr     ) / nb_jobs);
+    const int end   = 2 + 2 * ((nb_lines * (jobnr + 1)) / nb_jobs);
+
+    build_diff_map(fm, td->dstp + ((start - 2) >> 1) * td->map_linesize, td->map_linesize,
+                   td->height, td->width, td->plane, start, end);
+    return 0;
+}
+
+static int compare_fields_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const int nb_lines = FFMAX(0, (td->height - 3) / 2);
+    const int start = 2 + 2 * ((nb_lines *  jobnr     ) / nb_jobs);
+    const int end   = 2 + 2 * ((nb_lines * (jobnr + 1)) / nb_jobs);
+    const int i = (start - 2) >> 1;
+    const int map_linesize  = td->map_linesize;
+    const int srcf_linesize = td->srcf_linesize;
+    const int prvf_linesize = td->prvf_linesize;
+    const int nxtf_linesize = td->nxtf_linesize;
+    const uint8_t *mapp  = td->mapp  + i * map_linesize;
+    const uint8_t *srcpf = td->srcpf + i * srcf_linesize;
+    const uint8_t *srcf  = td->srcf  + i * srcf_linesize;
+    const uint8_t *srcnf = td->srcnf + i * srcf_linesize;
+    const uint8_t *prvpf = td->prvpf + i * prvf_linesize;
+    const uint8_t *prvnf = td->prvnf + i * prvf_linesize;
+    const uint8_t *nxtpf = td->nxtpf + i * nxtf_linesize;
+    const uint8_t *nxtnf = td->nxtnf + i * nxtf_linesize;
+    const int y0a = td->y0a, y1a = td->y1a;
+    uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
+    uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
+    int64_t *sums = fm->sums + 6 * jobnr;
+    int x, y, temp1, temp2;
+
+    for (y = start; y < end; y += 2) {
+        if (y0a == y1a || y < y0a || y > y1a) {
+            for (x = td->startx; x < td->stopx; x++) {
+                if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
+                    temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
+
+                    temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
+                    if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
+                        accumPc += temp2;
+                    if (temp2 > 42) {
+                        if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
+                            accumPm += temp2;
+                        if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
+                            accumPml += temp2;
+                    }
+
+                    temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
+                    if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
+                        accumNc += temp2;
+                    if (temp2 > 42) {
+                        if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
+                            accumNm += temp2;
+                        if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
+                            accumNml += temp2;
+                    }
+                }
+            }
+        }
+        prvpf += prvf_linesize;
+        prvnf += prvf_linesize;
+        srcpf += srcf_linesize;
+        srcf  += srcf_linesize;
+        srcnf += srcf_linesize;
+        nxtpf += nxtf_linesize;
+        nxtnf += nxtf_linesize;
+        mapp  += map_linesize;
+    }
+
+    sums[0] = accumPc;
+    sums[1] = accumPm;
+    sums[2] = accumPml;
+    sums[3] = accumNc;
+    sums[4] = accumNm;
+    sums[5] = accumNml;
+    return 0;
+}
+
 enum { mP, mC, mN, mB, mU };
 
 static int get_field_base(int match, int field)
@@ -486,8 +669,9 @@ static AVFrame *select_frame(FieldMatchContext *fm, int match)
     else  /* match == mC */              return fm->src;
 }
 
-static int compare_fields(FieldMatchContext *fm, int match1, int match2, int field)
+static int compare_fields(AVFilterContext *ctx, int match1, int match2, int field)
 {
+    FieldMatchContext *fm = ctx->priv;
     int plane, ret;
     uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
     uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
@@ -496,7 +680,7 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
     const AVFrame *src = fm->src;
 
     for (plane = 0; plane < (fm->mchroma ? 3 : 1); plane++) {
-        int x, y, temp1, temp2, fbase;
+        int fbase, nb_jobs;
         const AVFrame *prev, *next;
         uint8_t *mapp    = fm->map_data[plane];
         int map_linesize = fm->map_linesize[plane];
@@ -507,12 +691,9 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         int prvf_linesize, nxtf_linesize;
         const int width  = get_width (fm, src, plane, INPUT_MAIN);
         const int height = get_height(fm, src, plane, INPUT_MAIN);
-        const int y0a = fm->y0 >> (plane ? fm->vsub[INPUT_MAIN] : 0);
-        const int y1a = fm->y1 >> (plane ? fm->vsub[INPUT_MAIN] : 0);
-        const int startx = (plane == 0 ? 8 : 8 >> fm->hsub[INPUT_MAIN]);
-        const int stopx  = width - startx;
         const uint8_t *srcpf, *srcf, *srcnf;
         const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
+        ThreadData td;
 
         fill_buf(mapp, width, height, map_linesize, 0);
 
@@ -537,49 +718,50 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         nxtnf = nxtpf + nxtf_linesize;                      // next frame, next     field
 
         map_linesize <<= 1;
-        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1))
-            build_diff_map(fm, prvpf, prvf_linesize, nxtpf, nxtf_linesize,
-                           mapp, map_linesize, height, width, plane);
-        else
-            build_diff_map(fm, prvnf, prvf_linesize, nxtnf, nxtf_linesize,
-                           mapp + map_linesize, map_linesize, height, width, plane);
-
-        for (y = 2; y < height - 2; y += 2) {
-            if (y0a == y1a || y < y0a || y > y1a) {
-                for (x = startx; x < stopx; x++) {
-                    if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
-                        temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
-
-                        temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumPc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumPm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumPml += temp2;
-                        }
 
-                        temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumNc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumNm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumNml += temp2;
-                        }
-                    }
-                }
-            }
-            prvpf += prvf_linesize;
-            prvnf += prvf_linesize;
-            srcpf += srcf_linesize;
-            srcf  += srcf_linesize;
-            srcnf += srcf_linesize;
-            nxtpf += nxtf_linesize;
-            nxtnf += nxtf_linesize;
-            mapp  += map_linesize;
+        td = (ThreadData) {
+            .plane  = plane,
+            .width  = width,
+            .height = height,
+            .y0a    = fm->y0 >> (plane ? fm->vsub[INPUT_MAIN] : 0),
+            .y1a    = fm->y1 >> (plane ? fm->vsub[INPUT_MAIN] : 0),
+            .startx = plane == 0 ? 8 : 8 >> fm->hsub[INPUT_MAIN],
+            .prvd_linesize = prvf_linesize,
+            .nxtd_linesize = nxtf_linesize,
+            .srcpf = srcpf, .srcf = srcf, .srcnf = srcnf,
+            .prvpf = prvpf, .prvnf = prvnf, .nxtpf = nxtpf, .nxtnf = nxtnf,
+            .srcf_linesize = srcf_linesize,
+            .prvf_linesize = prvf_linesize,
+            .nxtf_linesize = nxtf_linesize,
+            .mapp = mapp,
+            .map_linesize = map_linesize,
+        };
+        td.stopx = width - td.startx;
+        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1)) {
+            td.prvp = prvpf;
+            td.nxtp = nxtpf;
+            td.dstp = mapp;
+        } else {
+            td.prvp = prvnf;
+            td.nxtp = nxtnf;
+            td.dstp = mapp + map_linesize;
+        }
+
+        ff_filter_execute(ctx, abs_diff_mask_slice, &td, NULL,
+                          ff_filter_get_nb_jobs(ctx, height >> 1));
+        ff_filter_execute(ctx, diff_map_slice, &td, NULL,
+                          ff_filter_get_nb_jobs(ctx, (height - 3) / 2));
+
+        nb_jobs = av_clip((height - 3) / 2, 1, fm->nb_threads);
+        ff_filter_execute(ctx, compare_fields_slice, &td, NULL, nb_jobs);
+        for (int i = 0; i < nb_jobs; i++) {
+            const int64_t *sums = fm->sums + 6 * i;
+            accumPc  += sums[0];
+            accumPm  += sums[1];
+            accumPml += sums[2];
+            accumNc  += sums[3];
+            accumNm  += sums[4];
+            accumNml += sums[5];
         }
     }
 
@@ -659,7 +841,7 @@ static int checkmm(AVFilterContext *ctx, int *combs, int m1, int m2,
             gen_frames[mid] = create_weave_frame(ctx, mid, field,               \
                                                  fm->prv, fm->src, fm->nxt,     \
                                                  INPUT_MAIN);                   \
-        combs[mid] = calc_combed_score(fm, gen_frames[mid]);                    \
+        combs[mid] = calc_combed_score(ctx, gen_frames[mid]);                   \
     }                                                                           \
 } while (0)
 
@@ -734,7 +916,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
                 ret = AVERROR(ENOMEM);
                 goto fail;
             }
-            combs[i] = calc_combed_score(fm, gen_frames[i]);
+            combs[i] = calc_combed_score(ctx, gen_frames[i]);
         }
         av_log(ctx, AV_LOG_INFO, "COMBS: %3d %3d %3d %3d %3d\n",
                combs[0], combs[1], combs[2], combs[3], combs[4]);
@@ -747,22 +929,22 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     /* p/c selection and optional 3-way p/c/n matches */
-    match = compare_fields(fm, fxo[mC], fxo[mP], field);
+    match = compare_fields(ctx, fxo[mC], fxo[mP], field);
     if (fm->mode == MODE_PCN || fm->mode == MODE_PCN_UB)
-        match = compare_fields(fm, match, fxo[mN], field);
+        match = compare_fields(ctx, match, fxo[mN], field);
 
     /* scene change check */
     if (fm->combmatch == COMBMATCH_SC) {
         if (fm->lastn == outl->frame_count_in - 1) {
             if (fm->lastscdiff > fm->scthresh)
                 sc = 1;
-        } else if (luma_abs_diff(fm->prv, fm->src) > fm->scthresh) {
+        } else if (luma_abs_diff(ctx, fm->prv, fm->src) > fm->scthresh) {
             sc = 1;
         }
 
         if (!sc) {
             fm->lastn = outl->frame_count_in;
-            fm->lastscdiff = luma_abs_diff(fm->src, fm->nxt);
+            fm->lastscdiff = luma_abs_diff(ctx, fm->src, fm->nxt);
             sc = fm->lastscdiff > fm->scthresh;
         }
     }
@@ -972,11 +1154,15 @@ static int config_input(AVFilterLink *inlink)
     fm->tpitchy  = FFALIGN(w,      16);
     fm->tpitchuv = FFALIGN(w >> 1, 16);
 
+    fm->nb_threads = ff_filter_get_nb_threads(ctx);
+    fm->c_array_size = ((((w + fm->blockx/2)/fm->blockx)+1) *
+                        (((h + fm->blocky/2)/fm->blocky)+1)) << 2;
+
     fm->tbuffer = av_calloc((h/2 + 4) * fm->tpitchy, sizeof(*fm->tbuffer));
-    fm->c_array = av_malloc_array((((w + fm->blockx/2)/fm->blockx)+1) *
-                            (((h + fm->blocky/2)/fm->blocky)+1),
-                            4 * sizeof(*fm->c_array));
-    if (!fm->tbuffer || !fm->c_array)
+    fm->c_array = av_malloc_array(fm->c_array_size,
+                                  fm->nb_threads * sizeof(*fm->c_array));
+    fm->sums    = av_calloc(fm->nb_threads, 6 * sizeof(*fm->sums));
+    if (!fm->tbuffer || !fm->c_array || !fm->sums)
         return AVERROR(ENOMEM);
 
     return 0;
@@ -1034,6 +1220,7 @@ static av_cold void fieldmatch_uninit(AVFilterContext *ctx)
     av_freep(&fm->cmask_data[0]);
     av_freep(&fm->tbuffer);
     av_freep(&fm->c_array);
+    av_freep(&fm->sums);
 }
 
 static int config_output(AVFilterLink *outlink)
@@ -1067,7 +1254,7 @@ const FFFilter ff_vf_fieldmatch = {
     .p.name         = "fieldmatch",
     .p.description  = NULL_IF_CONFIG_SMALL("Field matching for inverse telecine."),
     .p.priv_class   = &fieldmatch_class,
-    .p.flags        = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .p.flags        = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
     .priv_size      = sizeof(FieldMatchContext),
     .init           = fieldmatch_init,
     .activate       = activate,
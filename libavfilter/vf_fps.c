@@ -297,17 +297,28 @@ static int write_frame(AVFilterContext *ctx, FPSContext *s, AVFilterLink *outlin
 
     /* Output a copy of the first buffered frame */
     } else {
-        frame = av_frame_clone(s->frames[0]);
-        if (!frame)
-            return AVERROR(ENOMEM);
+        int64_t pts = s->frames[0]->pts;
+
+        /* If the frame is dropped right after this output, hand it over
+         * rather than keeping a reference which would force a copy for a
+         * filter modifying it in place */
+        if ((s->frames_count == 2 && s->frames[1]->pts <= s->next_pts + 1) ||
+            (s->status            && s->status_pts     <= s->next_pts + 1)) {
+            s->cur_frame_out++;
+            frame = shift_frame(ctx, s);
+        } else {
+            frame = av_frame_clone(s->frames[0]);
+            if (!frame)
+                return AVERROR(ENOMEM);
+            s->cur_frame_out++;
+        }
         // Make sure Closed Captions will not be duplicated
         ff_ccfifo_inject(&s->cc_fifo, frame);
         frame->pts = s->next_pts++;
         frame->duration = 1;
 
         av_log(ctx, AV_LOG_DEBUG, "Writing frame with pts %"PRId64" to pts %"PRId64"\n",
-               s->frames[0]->pts, frame->pts);
-        s->cur_frame_out++;
+               pts, frame->pts);
         *again = 1;
         return ff_filter_frame(outlink, frame);
     }
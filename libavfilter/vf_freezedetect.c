@@ -22,6 +22,7 @@
  */
 
 #include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/timestamp.h"
@@ -42,11 +43,19 @@ typedef struct FreezeDetectContext {
     int64_t n;
     int64_t reference_n;
     int frozen;
+    int nb_threads;
+    uint64_t *sad_sums;          ///< per-job sums of absolute differences
 
     double noise;
     int64_t duration;            ///< minimum duration of frozen frame until notification
+    int line_step;
+    int frame_step;
 } FreezeDetectContext;
 
+typedef struct ThreadData {
+    AVFrame *reference, *frame;
+} ThreadData;
+
 #define OFFSET(x) offsetof(FreezeDetectContext, x)
 #define V AV_OPT_FLAG_VIDEO_PARAM
 #define F AV_OPT_FLAG_FILTERING_PARAM
@@ -56,6 +65,8 @@ static const AVOption freezedetect_options[] = {
     { "noise",               "set noise tolerance",                       OFFSET(noise),  AV_OPT_TYPE_DOUBLE,   {.dbl=0.001},     0,       1.0, V|F },
     { "d",                   "set minimum duration in seconds",        OFFSET(duration),  AV_OPT_TYPE_DURATION, {.i64=2000000},   0, INT64_MAX, V|F },
     { "duration",            "set minimum duration in seconds",        OFFSET(duration),  AV_OPT_TYPE_DURATION, {.i64=2000000},   0, INT64_MAX, V|F },
+    { "line_step",           "analyze only one line out of every line_step", OFFSET(line_step),  AV_OPT_TYPE_INT, {.i64=1}, 1, 1024, V|F },
+    { "frame_step",          "analyze only one frame out of every frame_step", OFFSET(frame_step), AV_OPT_TYPE_INT, {.i64=1}, 1, INT_MAX, V|F },
 
     {NULL}
 };
@@ -107,6 +118,11 @@ static int config_input(AVFilterLink *inlink)
     if (!s->sad)
         return AVERROR(EINVAL);
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->sad_sums = av_calloc(s->nb_threads, sizeof(*s->sad_sums));
+    if (!s->sad_sums)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -114,23 +130,52 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     FreezeDetectContext *s = ctx->priv;
     av_frame_free(&s->reference_frame);
+    av_freep(&s->sad_sums);
 }
 
-static int is_frozen(FreezeDetectContext *s, AVFrame *reference, AVFrame *frame)
+static int sad_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    FreezeDetectContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const int step = s->line_step;
     uint64_t sad = 0;
-    uint64_t count = 0;
-    double mafd;
+
     for (int plane = 0; plane < 4; plane++) {
         if (s->width[plane]) {
+            /* only every line_step-th line is analyzed */
+            const ptrdiff_t lines = (s->height[plane] + step - 1) / step;
+            const ptrdiff_t start = (lines *  jobnr     ) / nb_jobs;
+            const ptrdiff_t end   = (lines * (jobnr + 1)) / nb_jobs;
+            const ptrdiff_t linesize     = td->frame->linesize[plane];
+            const ptrdiff_t ref_linesize = td->reference->linesize[plane];
             uint64_t plane_sad;
-            s->sad(frame->data[plane], frame->linesize[plane],
-                   reference->data[plane], reference->linesize[plane],
-                   s->width[plane], s->height[plane], &plane_sad);
+
+            if (start >= end)
+                continue;
+            s->sad(td->frame->data[plane] + start * step * linesize, linesize * step,
+                   td->reference->data[plane] + start * step * ref_linesize, ref_linesize * step,
+                   s->width[plane], end - start, &plane_sad);
             sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
         }
     }
+    s->sad_sums[jobnr] = sad;
+    return 0;
+}
+
+static int is_frozen(AVFilterContext *ctx, AVFrame *reference, AVFrame *frame)
+{
+    FreezeDetectContext *s = ctx->priv;
+    ThreadData td = { .reference = reference, .frame = frame };
+    const int nb_jobs = av_clip(s->height[0] / s->line_step, 1, s->nb_threads);
+    uint64_t sad = 0;
+    uint64_t count = 0;
+    double mafd;
+
+    ff_filter_execute(ctx, sad_slice, &td, NULL, nb_jobs);
+    for (int i = 0; i < nb_jobs; i++)
+        sad += s->sad_sums[i];
+    for (int plane = 0; plane < 4; plane++)
+        count += s->width[plane] * ((s->height[plane] + s->line_step - 1) / s->line_step);
     mafd = (double)sad / count / (1ULL << s->bitdepth);
     return (mafd <= s->noise);
 }
@@ -160,6 +205,10 @@ static int activate(AVFilterContext *ctx)
         int frozen = 0;
         s->n++;
 
+        /* frames in between the analyzed ones keep the current state */
+        if (s->frame_step > 1 && (s->n - 1) % s->frame_step)
+            return ff_filter_frame(outlink, frame);
+
         if (s->reference_frame) {
             int64_t duration;
             if (s->reference_frame->pts == AV_NOPTS_VALUE || frame->pts == AV_NOPTS_VALUE || frame->pts < s->reference_frame->pts)     // Discontinuity?
@@ -167,7 +216,7 @@ static int activate(AVFilterContext *ctx)
             else
                 duration = av_rescale_q(frame->pts - s->reference_frame->pts, inlink->time_base, AV_TIME_BASE_Q);
 
-            frozen = is_frozen(s, s->reference_frame, frame);
+            frozen = is_frozen(ctx, s->reference_frame, frame);
             if (duration >= s->duration) {
                 if (!s->frozen)
                     set_meta(ctx, frame, "lavfi.freezedetect.freeze_start", av_ts2timestr(s->reference_frame->pts, &inlink->time_base));
@@ -209,7 +258,7 @@ const FFFilter ff_vf_freezedetect = {
     .p.name        = "freezedetect",
     .p.description = NULL_IF_CONFIG_SMALL("Detects frozen video input."),
     .p.priv_class  = &freezedetect_class,
-    .p.flags       = AVFILTER_FLAG_METADATA_ONLY,
+    .p.flags       = AVFILTER_FLAG_METADATA_ONLY | AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(FreezeDetectContext),
     .uninit        = uninit,
     FILTER_INPUTS(freezedetect_inputs),
@@ -21,6 +21,7 @@
 #include <float.h> /* FLT_MAX */
 
 #include "libavutil/common.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 
@@ -70,8 +71,14 @@ typedef struct IDETContext {
     int analyze_interlaced_flag;
     int analyze_interlaced_flag_done;
 
+    int line_step;
+    int roi_x, roi_y, roi_w, roi_h;
+
     const AVPixFmtDescriptor *csp;
     int eof;
+
+    int64_t (*slice_stats)[5];      ///< alpha[2], delta and gamma[2] of each job
+    int nb_threads;
 } IDETContext;
 
 #define OFFSET(x) offsetof(IDETContext, x)
@@ -83,6 +90,11 @@ static const AVOption idet_options[] = {
     { "rep_thres",  "set repeat threshold",      OFFSET(repeat_threshold),      AV_OPT_TYPE_FLOAT, {.dbl = 3.0},  -1, FLT_MAX, FLAGS },
     { "half_life", "half life of cumulative statistics", OFFSET(half_life),     AV_OPT_TYPE_FLOAT, {.dbl = 0.0},  -1, INT_MAX, FLAGS },
     { "analyze_interlaced_flag", "set number of frames to use to determine if the interlace flag is accurate", OFFSET(analyze_interlaced_flag), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "line_step", "analyze one pair of lines out of every line_step pairs", OFFSET(line_step), AV_OPT_TYPE_INT, {.i64 = 1 }, 1, INT_MAX, FLAGS },
+    { "x", "set the left edge of the analyzed area", OFFSET(roi_x), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "y", "set the top edge of the analyzed area",  OFFSET(roi_y), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "w", "set the width of the analyzed area",     OFFSET(roi_w), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "h", "set the height of the analyzed area",    OFFSET(roi_h), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, INT_MAX, FLAGS },
     { NULL }
 };
 
@@ -132,40 +144,88 @@ static const char *rep2str(RepeatedField repeated_field)
     return NULL;
 }
 
-static void filter(AVFilterContext *ctx)
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     IDETContext *idet = ctx->priv;
-    int y, i;
+    const int bps = (idet->csp->comp[0].depth + 7) >> 3;
     int64_t alpha[2]={0};
     int64_t delta=0;
     int64_t gamma[2]={0};
-    Type type, best_type;
-    RepeatedField repeat;
-    int match = 0;
-    AVDictionary **metadata = &idet->cur->metadata;
+    int64_t *stats = idet->slice_stats[jobnr];
     ff_idet_filter_func filter_line = idet->dsp.filter_line;
+    int y, i;
 
     for (i = 0; i < idet->csp->nb_components; i++) {
         int w = idet->cur->width;
         int h = idet->cur->height;
+        int x0 = idet->roi_x, x1 = idet->roi_w ? idet->roi_x + idet->roi_w : w;
+        int y0 = idet->roi_y, y1 = idet->roi_h ? idet->roi_y + idet->roi_h : h;
         int refs = idet->cur->linesize[i];
+        int start, end;
 
         if (i && i<3) {
-            w = AV_CEIL_RSHIFT(w, idet->csp->log2_chroma_w);
-            h = AV_CEIL_RSHIFT(h, idet->csp->log2_chroma_h);
+            w  = AV_CEIL_RSHIFT(w,  idet->csp->log2_chroma_w);
+            h  = AV_CEIL_RSHIFT(h,  idet->csp->log2_chroma_h);
+            x0 = x0 >> idet->csp->log2_chroma_w;
+            y0 = y0 >> idet->csp->log2_chroma_h;
+            x1 = AV_CEIL_RSHIFT(x1, idet->csp->log2_chroma_w);
+            y1 = AV_CEIL_RSHIFT(y1, idet->csp->log2_chroma_h);
         }
-
-        for (y = 2; y < h - 2; y++) {
-            uint8_t *prev = &idet->prev->data[i][y*refs];
-            uint8_t *cur  = &idet->cur ->data[i][y*refs];
-            uint8_t *next = &idet->next->data[i][y*refs];
-            alpha[ y   &1] += filter_line(cur-refs, prev, cur+refs, w);
-            alpha[(y^1)&1] += filter_line(cur-refs, next, cur+refs, w);
-            delta          += filter_line(cur-refs,  cur, cur+refs, w);
-            gamma[(y^1)&1] += filter_line(cur     , prev, cur     , w);
+        x1 = FFMIN(x1, w);
+        y0 = FFMAX(y0, 2);
+        y1 = FFMIN(y1, h - 2);
+        if (x0 >= x1 || y0 >= y1)
+            continue;
+
+        start = y0 + ((y1 - y0) *  jobnr     ) / nb_jobs;
+        end   = y0 + ((y1 - y0) * (jobnr + 1)) / nb_jobs;
+
+        for (y = start; y < end; y++) {
+            uint8_t *prev = &idet->prev->data[i][y*refs + x0*bps];
+            uint8_t *cur  = &idet->cur ->data[i][y*refs + x0*bps];
+            uint8_t *next = &idet->next->data[i][y*refs + x0*bps];
+
+            /* skip whole pairs of lines to keep both fields balanced */
+            if (idet->line_step > 1 && (y >> 1) % idet->line_step)
+                continue;
+
+            alpha[ y   &1] += filter_line(cur-refs, prev, cur+refs, x1 - x0);
+            alpha[(y^1)&1] += filter_line(cur-refs, next, cur+refs, x1 - x0);
+            delta          += filter_line(cur-refs,  cur, cur+refs, x1 - x0);
+            gamma[(y^1)&1] += filter_line(cur     , prev, cur     , x1 - x0);
         }
     }
 
+    stats[0] = alpha[0];
+    stats[1] = alpha[1];
+    stats[2] = delta;
+    stats[3] = gamma[0];
+    stats[4] = gamma[1];
+    return 0;
+}
+
+static void filter(AVFilterContext *ctx)
+{
+    IDETContext *idet = ctx->priv;
+    int i;
+    int64_t alpha[2]={0};
+    int64_t delta=0;
+    int64_t gamma[2]={0};
+    Type type, best_type;
+    RepeatedField repeat;
+    int match = 0;
+    AVDictionary **metadata = &idet->cur->metadata;
+    const int nb_jobs = av_clip(idet->cur->height - 4, 1, idet->nb_threads);
+
+    ff_filter_execute(ctx, filter_slice, NULL, NULL, nb_jobs);
+    for (i = 0; i < nb_jobs; i++) {
+        alpha[0] += idet->slice_stats[i][0];
+        alpha[1] += idet->slice_stats[i][1];
+        delta    += idet->slice_stats[i][2];
+        gamma[0] += idet->slice_stats[i][3];
+        gamma[1] += idet->slice_stats[i][4];
+    }
+
     if      (alpha[0] > idet->interlace_threshold * alpha[1]){
         type = TFF;
     }else if(alpha[1] > idet->interlace_threshold * alpha[0]){
@@ -302,6 +362,13 @@ static int filter_frame(AVFilterLink *link, AVFrame *picref)
         ff_idet_dsp_init(&idet->dsp, idet->csp->comp[0].depth);
     }
 
+    if (!idet->slice_stats) {
+        idet->nb_threads  = ff_filter_get_nb_threads(ctx);
+        idet->slice_stats = av_calloc(idet->nb_threads, sizeof(*idet->slice_stats));
+        if (!idet->slice_stats)
+            return AVERROR(ENOMEM);
+    }
+
     if (idet->analyze_interlaced_flag) {
         if (idet->cur->flags & AV_FRAME_FLAG_INTERLACED) {
             idet->cur->flags &= ~AV_FRAME_FLAG_INTERLACED;
@@ -380,6 +447,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&idet->prev);
     av_frame_free(&idet->cur );
     av_frame_free(&idet->next);
+    av_freep(&idet->slice_stats);
 }
 
 static const enum AVPixelFormat pix_fmts[] = {
@@ -453,7 +521,7 @@ static const AVFilterPad idet_outputs[] = {
 const FFFilter ff_vf_idet = {
     .p.name        = "idet",
     .p.description = NULL_IF_CONFIG_SMALL("Interlace detect Filter."),
-    .p.flags       = AVFILTER_FLAG_METADATA_ONLY,
+    .p.flags       = AVFILTER_FLAG_METADATA_ONLY | AVFILTER_FLAG_SLICE_THREADS,
     .p.priv_class  = &idet_class,
     .priv_size     = sizeof(IDETContext),
     .init          = init,
@@ -64,6 +64,8 @@ enum var_name {
 typedef struct LutContext {
     const AVClass *class;
     uint16_t lut[4][256 * 256];  ///< lookup table for each component
+    uint16_t (*fused_lut)[256 * 256]; ///< tables of a fused chain, applied instead of lut
+    uint8_t rgba_map[4];         ///< component index -> RGBA color index map
     char   *comp_expr_str[4];
     AVExpr *comp_expr[4];
     int hsub, vsub;
@@ -110,6 +112,7 @@ static av_cold void uninit(AVFilterContext *ctx)
         s->comp_expr[i] = NULL;
         av_freep(&s->comp_expr_str[i]);
     }
+    av_freep(&s->fused_lut);
 }
 
 #define YUV_FORMATS                                         \
@@ -217,7 +220,7 @@ static int config_props(AVFilterLink *inlink)
     AVFilterContext *ctx = inlink->dst;
     LutContext *s = ctx->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
-    uint8_t rgba_map[4]; /* component index -> RGBA color index map */
+    uint8_t *rgba_map = s->rgba_map;
     int min[4], max[4];
     int val, color, ret;
 
@@ -355,7 +358,7 @@ struct thread_data {
     const int h = td->h;\
     AVFrame *in = td->in;\
     AVFrame *out = td->out;\
-    const uint16_t (*tab)[256*256] = (const uint16_t (*)[256*256])s->lut;\
+    const uint16_t (*tab)[256*256] = (const uint16_t (*)[256*256])(s->fused_lut ? s->fused_lut : s->lut);\
     const int step = s->step;\
 \
     const int slice_start = (h *  jobnr   ) / nb_jobs;\
@@ -439,7 +442,7 @@ static int lut_packed_8bits(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
         int hsub = plane == 1 || plane == 2 ? s->hsub : 0;\
         int h = AV_CEIL_RSHIFT(td->h, vsub);\
         int w = AV_CEIL_RSHIFT(td->w, hsub);\
-        const uint16_t *tab = s->lut[plane];\
+        const uint16_t *tab = s->fused_lut ? s->fused_lut[plane] : s->lut[plane];\
 \
         const int slice_start = (h *  jobnr   ) / nb_jobs;\
         const int slice_end   = (h * (jobnr+1)) / nb_jobs;\
@@ -581,6 +584,43 @@ static int process_command(AVFilterContext *ctx, const char *cmd, const char *ar
     return config_props(ctx->inputs[0]);
 }
 
+static int get_lut(AVFilterContext *ctx, uint16_t *const luts[4])
+{
+    LutContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(ctx->inputs[0]->format);
+
+    for (int color = 0; color < desc->nb_components; color++) {
+        int comp = s->is_rgb ? s->rgba_map[color] : color;
+        memcpy(luts[color], s->lut[comp], sizeof(s->lut[comp]));
+    }
+
+    return 1;
+}
+
+static int set_lut(AVFilterContext *ctx, uint16_t *const luts[4])
+{
+    LutContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(ctx->inputs[0]->format);
+
+    if (!luts) {
+        av_freep(&s->fused_lut);
+        return 0;
+    }
+
+    if (!s->fused_lut) {
+        s->fused_lut = av_malloc(sizeof(s->lut));
+        if (!s->fused_lut)
+            return AVERROR(ENOMEM);
+    }
+    memcpy(s->fused_lut, s->lut, sizeof(s->lut));
+    for (int color = 0; color < desc->nb_components; color++) {
+        int comp = s->is_rgb ? s->rgba_map[color] : color;
+        memcpy(s->fused_lut[comp], luts[color], sizeof(s->lut[comp]));
+    }
+
+    return 0;
+}
+
 static const AVFilterPad inputs[] = {
     { .name         = "default",
       .type         = AVMEDIA_TYPE_VIDEO,
@@ -603,6 +643,8 @@ static const AVFilterPad inputs[] = {
         FILTER_OUTPUTS(ff_video_default_filterpad),                     \
         FILTER_QUERY_FUNC2(query_formats),                              \
         .process_command = process_command,                             \
+        .get_lut         = get_lut,                                     \
+        .set_lut         = set_lut,                                     \
     }
 
 AVFILTER_DEFINE_CLASS_EXT(lut, "lut/lutyuv/lutrgb", options);
@@ -346,6 +346,26 @@ static int process_command(AVFilterContext *ctx, const char *cmd, const char *ar
     return ret;
 }
 
+static int get_lut(AVFilterContext *ctx, uint16_t *const luts[4])
+{
+    NegateContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(ctx->inputs[0]->format);
+    const int is_packed = !(desc->flags & AV_PIX_FMT_FLAG_PLANAR) &&
+                           (desc->nb_components > 1);
+
+    for (int c = 0; c < desc->nb_components; c++) {
+        const int depth = desc->comp[c].depth;
+        const int max = depth <= 8 ? 255 : s->max;
+        const int negate = is_packed ? s->components & (1 << s->rgba_map[c]) :
+                                       s->planes & (1 << desc->comp[c].plane);
+
+        for (int v = 0; v < 1 << depth; v++)
+            luts[c][v] = negate ? max - v : v;
+    }
+
+    return 1;
+}
+
 static const AVFilterPad inputs[] = {
     {
         .name         = "default",
@@ -365,4 +385,5 @@ const FFFilter ff_vf_negate = {
     FILTER_OUTPUTS(ff_video_default_filterpad),
     FILTER_PIXFMTS_ARRAY(pix_fmts),
     .process_command = process_command,
+    .get_lut         = get_lut,
 };
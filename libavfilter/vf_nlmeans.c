@@ -372,7 +372,7 @@ static int nlmeans_plane(AVFilterContext *ctx, int w, int h, int p, int r,
                                            src, src_linesize,
                                            offx, offy, e, w, h);
                 ff_filter_execute(ctx, nlmeans_slice, &td, NULL,
-                                  FFMIN(td.endy - td.starty, ff_filter_get_nb_threads(ctx)));
+                                  ff_filter_get_nb_jobs(ctx, td.endy - td.starty));
             }
         }
     }
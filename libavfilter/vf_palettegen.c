@@ -79,6 +79,8 @@ typedef struct PaletteGenContext {
     struct hist_node histogram[HIST_SIZE];  // histogram/hashtable of the colors
     struct color_ref **refs;                // references of all the colors used in the stream
     int nb_refs;                            // number of color references (or number of different colors)
+    int nb_entries;                         // number of histogram entries, including the unused ones
+    int nb_alpha_refs;                      // number of color references that are not opaque
     struct range_box boxes[256];            // define the segmentation of the colorspace (the final palette)
     int nb_boxes;                           // number of boxes (increase will segmenting them)
     int palette_pushed;                     // if the palette frame is pushed into the outlink or not
@@ -283,7 +285,7 @@ static void write_palette(AVFilterContext *ctx, AVFrame *out)
 /**
  * Crawl the histogram to get all the defined colors, and create a linear list
  * of them (each color reference entry is a pointer to the value in the
- * histogram/hash table).
+ * histogram/hash table). Entries of colors not used anymore are skipped.
  */
 static struct color_ref **load_color_refs(const struct hist_node *hist, int nb_refs)
 {
@@ -297,7 +299,8 @@ static struct color_ref **load_color_refs(const struct hist_node *hist, int nb_r
         const struct hist_node *node = &hist[j];
 
         for (int i = 0; i < node->nb_entries; i++)
-            refs[k++] = &node->entries[i];
+            if (node->entries[i].count)
+                refs[k++] = &node->entries[i];
     }
 
     return refs;
@@ -392,36 +395,69 @@ static AVFrame *get_palette_frame(AVFilterContext *ctx)
 }
 
 /**
- * Locate the color in the hash table and increment its counter.
+ * Locate the color in the hash table and increase its counter by n. Return 1
+ * if the color was not referenced yet. An entry whose counter dropped to 0 is
+ * kept with its OkLab value, and may be taken over by another color.
  */
-static int color_inc(struct hist_node *hist, uint32_t color)
+static int color_inc(PaletteGenContext *s, uint32_t color, int n)
 {
     const uint32_t hash = ff_lowbias32(color) & (HIST_SIZE - 1);
-    struct hist_node *node = &hist[hash];
-    struct color_ref *e;
+    struct hist_node *node = &s->histogram[hash];
+    struct color_ref *e, *unused = NULL;
 
     for (int i = 0; i < node->nb_entries; i++) {
         e = &node->entries[i];
         if (e->color == color) {
-            e->count++;
-            return 0;
+            const int new = !e->count;
+            e->count += n;
+            s->nb_alpha_refs += new && color >> 24 != 0xff;
+            return new;
         }
+        if (!e->count && !unused)
+            unused = e;
     }
 
-    e = av_dynarray2_add((void**)&node->entries, &node->nb_entries,
-                         sizeof(*node->entries), NULL);
-    if (!e)
-        return AVERROR(ENOMEM);
+    e = unused;
+    if (!e) {
+        e = av_dynarray2_add((void**)&node->entries, &node->nb_entries,
+                             sizeof(*node->entries), NULL);
+        if (!e)
+            return AVERROR(ENOMEM);
+        s->nb_entries++;
+    }
     e->color = color;
     e->lab = ff_srgb_u8_to_oklab_int(color);
-    e->count = 1;
+    e->count = n;
+    s->nb_alpha_refs += color >> 24 != 0xff;
     return 1;
 }
 
+/**
+ * Locate the color in the hash table and decrease its counter by n. Return 1
+ * if the color is not referenced anymore.
+ */
+static int color_dec(PaletteGenContext *s, uint32_t color, int n)
+{
+    const uint32_t hash = ff_lowbias32(color) & (HIST_SIZE - 1);
+    struct hist_node *node = &s->histogram[hash];
+
+    for (int i = 0; i < node->nb_entries; i++) {
+        struct color_ref *e = &node->entries[i];
+        if (e->color == color) {
+            av_assert1(e->count >= n);
+            e->count -= n;
+            s->nb_alpha_refs -= !e->count && color >> 24 != 0xff;
+            return !e->count;
+        }
+    }
+    av_assert0(0);
+    return 0;
+}
+
 /**
  * Update histogram when pixels differ from previous frame.
  */
-static int update_histogram_diff(struct hist_node *hist,
+static int update_histogram_diff(PaletteGenContext *s,
                                  const AVFrame *f1, const AVFrame *f2)
 {
     int x, y, ret, nb_diff_colors = 0;
@@ -431,21 +467,62 @@ static int update_histogram_diff(struct hist_node *hist,
         const uint32_t *q = (const uint32_t *)(f2->data[0] + y*f2->linesize[0]);
 
         for (x = 0; x < f1->width; x++) {
+            int n = 1;
+
             if (p[x] == q[x])
                 continue;
-            ret = color_inc(hist, p[x]);
+            /* count runs of the same color at once */
+            while (x + n < f1->width && p[x + n] == p[x] && q[x + n] != p[x])
+                n++;
+            ret = color_inc(s, p[x], n);
             if (ret < 0)
                 return ret;
             nb_diff_colors += ret;
+            x += n - 1;
         }
     }
     return nb_diff_colors;
 }
 
+/**
+ * Turn the histogram of the previous frame f2 into the histogram of the
+ * current frame f1, by only moving the pixels that differ between them.
+ * Return 1 without finishing if more than max_diff pixels differ, the
+ * histogram must then be rebuilt.
+ */
+static int update_histogram_delta(PaletteGenContext *s, const AVFrame *f1,
+                                  const AVFrame *f2, int max_diff)
+{
+    int x, y, ret, nb_diff = 0;
+
+    for (y = 0; y < f1->height; y++) {
+        const uint32_t *p = (const uint32_t *)(f1->data[0] + y*f1->linesize[0]);
+        const uint32_t *q = (const uint32_t *)(f2->data[0] + y*f2->linesize[0]);
+
+        for (x = 0; x < f1->width; x++) {
+            int n = 1;
+
+            if (p[x] == q[x])
+                continue;
+            while (x + n < f1->width && p[x + n] == p[x] && q[x + n] == q[x])
+                n++;
+            ret = color_inc(s, p[x], n);
+            if (ret < 0)
+                return ret;
+            s->nb_refs += ret - color_dec(s, q[x], n);
+            x += n - 1;
+            nb_diff += n;
+        }
+        if (nb_diff > max_diff)
+            return 1;
+    }
+    return 0;
+}
+
 /**
  * Simple histogram of the frame.
  */
-static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
+static int update_histogram_frame(PaletteGenContext *s, const AVFrame *f)
 {
     int x, y, ret, nb_diff_colors = 0;
 
@@ -453,15 +530,30 @@ static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
         const uint32_t *p = (const uint32_t *)(f->data[0] + y*f->linesize[0]);
 
         for (x = 0; x < f->width; x++) {
-            ret = color_inc(hist, p[x]);
+            int n = 1;
+
+            while (x + n < f->width && p[x + n] == p[x])
+                n++;
+            ret = color_inc(s, p[x], n);
             if (ret < 0)
                 return ret;
             nb_diff_colors += ret;
+            x += n - 1;
         }
     }
     return nb_diff_colors;
 }
 
+static void reset_histogram(PaletteGenContext *s)
+{
+    for (int i = 0; i < HIST_SIZE; i++)
+        av_freep(&s->histogram[i].entries);
+    memset(s->histogram, 0, sizeof(s->histogram));
+    s->nb_refs = 0;
+    s->nb_entries = 0;
+    s->nb_alpha_refs = 0;
+}
+
 /**
  * Update the histogram for each passing frame. No frame will be pushed here.
  */
@@ -474,29 +566,64 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     if (in->color_trc != AVCOL_TRC_UNSPECIFIED && in->color_trc != AVCOL_TRC_IEC61966_2_1)
         av_log(ctx, AV_LOG_WARNING, "The input frame is not in sRGB, colors may be off\n");
 
-    ret = s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in)
-                        : update_histogram_frame(s->histogram, in);
-    if (ret > 0)
-        s->nb_refs += ret;
+    /* The histogram of the previous frame is updated into the one of this
+     * frame. It is rebuilt instead when the unused entries it accumulated
+     * slow down the lookups and the gathering of the references, or when
+     * most of the frame changed, as an update costs twice as much per pixel.
+     * Colors only differing by their alpha have the same OkLab value, so their
+     * order in the references depends on the one of the histogram entries,
+     * which an update does not preserve: the histogram is also rebuilt when
+     * such colors may be present. */
+    if (s->stats_mode == STATS_MODE_SINGLE_FRAMES && s->prev_frame &&
+        (s->prev_frame->width  != in->width ||
+         s->prev_frame->height != in->height ||
+         s->nb_alpha_refs ||
+         s->nb_entries - s->nb_refs > s->nb_refs / 2)) {
+        reset_histogram(s);
+        av_frame_free(&s->prev_frame);
+    }
+
+    if (s->stats_mode == STATS_MODE_SINGLE_FRAMES && s->prev_frame) {
+        ret = update_histogram_delta(s, in, s->prev_frame, in->width * in->height / 2);
+        if (ret || s->nb_alpha_refs) {
+            reset_histogram(s);
+            av_frame_free(&s->prev_frame);
+        }
+    }
+    if (s->stats_mode != STATS_MODE_SINGLE_FRAMES || !s->prev_frame) {
+        ret = s->prev_frame ? update_histogram_diff(s, s->prev_frame, in)
+                            : update_histogram_frame(s, in);
+        if (ret > 0)
+            s->nb_refs += ret;
+    }
+    if (ret < 0) {
+        if (s->stats_mode == STATS_MODE_SINGLE_FRAMES) {
+            reset_histogram(s);
+            av_frame_free(&s->prev_frame);
+        }
+        av_frame_free(&in);
+        return ret;
+    }
 
     if (s->stats_mode == STATS_MODE_DIFF_FRAMES) {
         av_frame_free(&s->prev_frame);
         s->prev_frame = in;
     } else if (s->stats_mode == STATS_MODE_SINGLE_FRAMES && s->nb_refs > 0) {
         AVFrame *out;
-        int i;
+
+        /* the histogram is kept and updated from the differences with the
+         * next frame */
+        av_frame_free(&s->prev_frame);
+        s->prev_frame = in;
 
         out = get_palette_frame(ctx);
-        out->pts = in->pts;
-        av_frame_free(&in);
-        ret = ff_filter_frame(ctx->outputs[0], out);
-        for (i = 0; i < HIST_SIZE; i++)
-            av_freep(&s->histogram[i].entries);
         av_freep(&s->refs);
-        s->nb_refs = 0;
         s->nb_boxes = 0;
         memset(s->boxes, 0, sizeof(s->boxes));
-        memset(s->histogram, 0, sizeof(s->histogram));
+        if (!out)
+            return AVERROR(ENOMEM);
+        out->pts = in->pts;
+        ret = ff_filter_frame(ctx->outputs[0], out);
     } else {
         av_frame_free(&in);
     }
@@ -24,12 +24,15 @@
  * Use a palette to downsample an input video stream.
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/bprint.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/qsort.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "formats.h"
@@ -70,6 +73,9 @@ struct color_node {
 
 #define CACHE_SIZE (1<<15)
 
+/* width of the blocks after which the progress of a line is reported */
+#define SYNC_WIDTH 64
+
 struct cached_color {
     uint32_t color;
     uint8_t pal_entry;
@@ -83,12 +89,15 @@ struct cache_node {
 struct PaletteUseContext;
 
 typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                              int x_start, int y_start, int width, int height);
+                              int x_start, int y_start, int width, int height,
+                              int jobnr, int nb_jobs);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node **cache;              /* lookup cache of each job */
+    int nb_cache;
+    int *job_ret;
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
@@ -103,6 +112,12 @@ typedef struct PaletteUseContext {
     AVFrame *last_in;
     AVFrame *last_out;
 
+    /* line scheduling of the slice threads */
+    atomic_int next_line;
+    atomic_int *line_progress;              /* number of pixels done on each line */
+    AVMutex lock;
+    AVCond cond;
+
     /* debug options */
     char *dot_filename;
     int calc_mean_err;
@@ -163,24 +178,6 @@ static av_always_inline uint32_t dither_color(uint32_t px, int er, int eg,
          | av_clip_uint8((px       & 0xff) + ((eb * scale) / (1<<shift)));
 }
 
-static av_always_inline int diff(const struct color_info *a, const struct color_info *b, const int trans_thresh)
-{
-    const uint8_t alpha_a = a->srgb >> 24;
-    const uint8_t alpha_b = b->srgb >> 24;
-
-    if (alpha_a < trans_thresh && alpha_b < trans_thresh) {
-        return 0;
-    } else if (alpha_a >= trans_thresh && alpha_b >= trans_thresh) {
-        const int64_t dL = a->lab[0] - b->lab[0];
-        const int64_t da = a->lab[1] - b->lab[1];
-        const int64_t db = a->lab[2] - b->lab[2];
-        const int64_t ret = dL*dL + da*da + db*db;
-        return FFMIN(ret, INT32_MAX - 1);
-    } else {
-        return INT32_MAX - 1;
-    }
-}
-
 static struct color_info get_color_from_srgb(uint32_t srgb)
 {
     const struct Lab lab = ff_srgb_u8_to_oklab_int(srgb);
@@ -193,16 +190,21 @@ struct nearest_color {
     int64_t dist_sqd;
 };
 
+/**
+ * Look for the nearest color of an opaque target in the tree. All the colors
+ * of the tree are opaque, so only their OkLab distance matters.
+ */
 static void colormap_nearest_node(const struct color_node *map,
                                   const int node_pos,
-                                  const struct color_info *target,
-                                  const int trans_thresh,
+                                  const int32_t *target,
                                   struct nearest_color *nearest)
 {
     const struct color_node *kd = map + node_pos;
+    const int64_t dL = target[0] - kd->c.lab[0];
+    const int64_t da = target[1] - kd->c.lab[1];
+    const int64_t db = target[2] - kd->c.lab[2];
+    const int64_t current_to_target = FFMIN(dL*dL + da*da + db*db, INT32_MAX - 1);
     int nearer_kd_id, further_kd_id;
-    const struct color_info *current = &kd->c;
-    const int64_t current_to_target = diff(target, current, trans_thresh);
 
     if (current_to_target < nearest->dist_sqd) {
         nearest->node_pos = node_pos;
@@ -210,23 +212,28 @@ static void colormap_nearest_node(const struct color_node *map,
     }
 
     if (kd->left_id != -1 || kd->right_id != -1) {
-        const int64_t dx = target->lab[kd->split] - current->lab[kd->split];
+        const int64_t dx = target[kd->split] - kd->c.lab[kd->split];
 
         if (dx <= 0) nearer_kd_id = kd->left_id,  further_kd_id = kd->right_id;
         else         nearer_kd_id = kd->right_id, further_kd_id = kd->left_id;
 
         if (nearer_kd_id != -1)
-            colormap_nearest_node(map, nearer_kd_id, target, trans_thresh, nearest);
+            colormap_nearest_node(map, nearer_kd_id, target, nearest);
 
         if (further_kd_id != -1 && dx*dx < nearest->dist_sqd)
-            colormap_nearest_node(map, further_kd_id, target, trans_thresh, nearest);
+            colormap_nearest_node(map, further_kd_id, target, nearest);
     }
 }
 
 static av_always_inline uint8_t colormap_nearest(const struct color_node *node, const struct color_info *target, const int trans_thresh)
 {
     struct nearest_color res = {.dist_sqd = INT_MAX, .node_pos = -1};
-    colormap_nearest_node(node, 0, target, trans_thresh, &res);
+
+    /* the tree only contains opaque colors, which are all at the same maximum
+     * distance from a transparent one: the root is the first to be picked */
+    if (target->srgb >> 24 < trans_thresh)
+        return node[0].palette_id;
+    colormap_nearest_node(node, 0, target->lab, &res);
     return node[res.node_pos].palette_id;
 }
 
@@ -239,11 +246,12 @@ struct stack_node {
  * Check if the requested color is in the cache already. If not, find it in the
  * color tree and cache it.
  */
-static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
+static av_always_inline int color_get(PaletteUseContext *s, struct cache_node *cache,
+                                      uint32_t color)
 {
     struct color_info clrinfo;
     const uint32_t hash = ff_lowbias32(color) & (CACHE_SIZE - 1);
-    struct cache_node *node = &s->cache[hash];
+    struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
     // first, check for transparency
@@ -268,11 +276,11 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(PaletteUseContext *s,
+static av_always_inline int get_dst_color_err(PaletteUseContext *s, struct cache_node *cache,
                                               uint32_t c, int *er, int *eg, int *eb)
 {
     uint32_t dstc;
-    const int dstx = color_get(s, c);
+    const int dstx = color_get(s, cache, c);
     if (dstx < 0)
         return dstx;
     dstc = s->palette[dstx];
@@ -289,170 +297,221 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
+/**
+ * Wait until the first x pixels of line y are done.
+ */
+static void wait_line(PaletteUseContext *s, int y, int x)
+{
+    atomic_int *progress = &s->line_progress[y];
+
+    if (atomic_load_explicit(progress, memory_order_acquire) >= x)
+        return;
+    ff_mutex_lock(&s->lock);
+    while (atomic_load_explicit(progress, memory_order_acquire) < x)
+        ff_cond_wait(&s->cond, &s->lock);
+    ff_mutex_unlock(&s->lock);
+}
+
+static void report_line(PaletteUseContext *s, int y, int x)
+{
+    ff_mutex_lock(&s->lock);
+    atomic_store_explicit(&s->line_progress[y], x, memory_order_release);
+    ff_cond_broadcast(&s->cond);
+    ff_mutex_unlock(&s->lock);
+}
+
+/* mark the line as done so that the jobs waiting for it do not hang */
+static int abort_line(PaletteUseContext *s, int y, int w, int sync, int err)
+{
+    if (sync)
+        report_line(s, y, w);
+    return err;
+}
+
+/*
+ * The lines are taken in order by the jobs. With error diffusion, a line
+ * receives errors from the previous ones, and spreads its own errors up to
+ * 2 pixels to the right on the same line and 2 pixels to the left on the next
+ * one: a pixel is only processed once the previous line is 4 pixels ahead, so
+ * that all the errors are added in the same order as with a single job.
+ */
 static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
+                                      int jobnr, int nb_jobs,
                                       enum dithering_mode dither)
 {
+    struct cache_node *cache = s->cache[jobnr];
     const int src_linesize = in ->linesize[0] >> 2;
     const int dst_linesize = out->linesize[0];
-    uint32_t *src = ((uint32_t *)in ->data[0]) + y_start*src_linesize;
-    uint8_t  *dst =              out->data[0]  + y_start*dst_linesize;
+    const int sync = nb_jobs > 1 && dither >= DITHERING_HECKBERT;
+    int y;
 
     w += x_start;
     h += y_start;
 
-    for (int y = y_start; y < h; y++) {
-        for (int x = x_start; x < w; x++) {
-            int er, eg, eb;
-
-            if (dither == DITHERING_BAYER) {
-                const int d = s->ordered_dither[(y & 7)<<3 | (x & 7)];
-                const uint8_t a8 = src[x] >> 24;
-                const uint8_t r8 = src[x] >> 16 & 0xff;
-                const uint8_t g8 = src[x] >>  8 & 0xff;
-                const uint8_t b8 = src[x]       & 0xff;
-                const uint8_t r = av_clip_uint8(r8 + d);
-                const uint8_t g = av_clip_uint8(g8 + d);
-                const uint8_t b = av_clip_uint8(b8 + d);
-                const uint32_t color_new = (unsigned)(a8) << 24 | r << 16 | g << 8 | b;
-                const int color = color_get(s, color_new);
-
-                if (color < 0)
-                    return color;
-                dst[x] = color;
-
-            } else if (dither == DITHERING_HECKBERT) {
-                const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
-                dst[x] = color;
-
-                if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 3, 3);
-                if (         down) src[src_linesize + x    ] = dither_color(src[src_linesize + x    ], er, eg, eb, 3, 3);
-                if (right && down) src[src_linesize + x + 1] = dither_color(src[src_linesize + x + 1], er, eg, eb, 2, 3);
-
-            } else if (dither == DITHERING_FLOYD_STEINBERG) {
-                const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
-                dst[x] = color;
-
-                if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 7, 4);
-                if (left  && down) src[src_linesize + x - 1] = dither_color(src[src_linesize + x - 1], er, eg, eb, 3, 4);
-                if (         down) src[src_linesize + x    ] = dither_color(src[src_linesize + x    ], er, eg, eb, 5, 4);
-                if (right && down) src[src_linesize + x + 1] = dither_color(src[src_linesize + x + 1], er, eg, eb, 1, 4);
-
-            } else if (dither == DITHERING_SIERRA2) {
-                const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
-                const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
-                dst[x] = color;
-
-                if (right)          src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 4, 4);
-                if (right2)         src[                 x + 2] = dither_color(src[                 x + 2], er, eg, eb, 3, 4);
-
-                if (down) {
-                    if (left2)      src[  src_linesize + x - 2] = dither_color(src[  src_linesize + x - 2], er, eg, eb, 1, 4);
-                    if (left)       src[  src_linesize + x - 1] = dither_color(src[  src_linesize + x - 1], er, eg, eb, 2, 4);
-                    if (1)          src[  src_linesize + x    ] = dither_color(src[  src_linesize + x    ], er, eg, eb, 3, 4);
-                    if (right)      src[  src_linesize + x + 1] = dither_color(src[  src_linesize + x + 1], er, eg, eb, 2, 4);
-                    if (right2)     src[  src_linesize + x + 2] = dither_color(src[  src_linesize + x + 2], er, eg, eb, 1, 4);
-                }
+    while ((y = atomic_fetch_add_explicit(&s->next_line, 1, memory_order_relaxed)) < h) {
+        uint32_t *src = ((uint32_t *)in ->data[0]) + y*src_linesize;
+        uint8_t  *dst =              out->data[0]  + y*dst_linesize;
+
+        for (int x0 = x_start; x0 < w; x0 += SYNC_WIDTH) {
+            const int x1 = FFMIN(x0 + SYNC_WIDTH, w);
+
+            if (sync && y > y_start)
+                wait_line(s, y - 1, FFMIN(x1 + 4, w));
+
+            for (int x = x0; x < x1; x++) {
+                int er, eg, eb;
+
+                if (dither == DITHERING_BAYER) {
+                    const int d = s->ordered_dither[(y & 7)<<3 | (x & 7)];
+                    const uint8_t a8 = src[x] >> 24;
+                    const uint8_t r8 = src[x] >> 16 & 0xff;
+                    const uint8_t g8 = src[x] >>  8 & 0xff;
+                    const uint8_t b8 = src[x]       & 0xff;
+                    const uint8_t r = av_clip_uint8(r8 + d);
+                    const uint8_t g = av_clip_uint8(g8 + d);
+                    const uint8_t b = av_clip_uint8(b8 + d);
+                    const uint32_t color_new = (unsigned)(a8) << 24 | r << 16 | g << 8 | b;
+                    const int color = color_get(s, cache, color_new);
+
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
+
+                } else if (dither == DITHERING_HECKBERT) {
+                    const int right = x < w - 1, down = y < h - 1;
+                    const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
+
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
+
+                    if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 3, 3);
+                    if (         down) src[src_linesize + x    ] = dither_color(src[src_linesize + x    ], er, eg, eb, 3, 3);
+                    if (right && down) src[src_linesize + x + 1] = dither_color(src[src_linesize + x + 1], er, eg, eb, 2, 3);
+
+                } else if (dither == DITHERING_FLOYD_STEINBERG) {
+                    const int right = x < w - 1, down = y < h - 1, left = x > x_start;
+                    const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
+
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
+
+                    if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 7, 4);
+                    if (left  && down) src[src_linesize + x - 1] = dither_color(src[src_linesize + x - 1], er, eg, eb, 3, 4);
+                    if (         down) src[src_linesize + x    ] = dither_color(src[src_linesize + x    ], er, eg, eb, 5, 4);
+                    if (right && down) src[src_linesize + x + 1] = dither_color(src[src_linesize + x + 1], er, eg, eb, 1, 4);
+
+                } else if (dither == DITHERING_SIERRA2) {
+                    const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
+                    const int right2 = x < w - 2,                    left2 = x > x_start + 1;
+                    const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
+
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
+
+                    if (right)          src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 4, 4);
+                    if (right2)         src[                 x + 2] = dither_color(src[                 x + 2], er, eg, eb, 3, 4);
+
+                    if (down) {
+                        if (left2)      src[  src_linesize + x - 2] = dither_color(src[  src_linesize + x - 2], er, eg, eb, 1, 4);
+                        if (left)       src[  src_linesize + x - 1] = dither_color(src[  src_linesize + x - 1], er, eg, eb, 2, 4);
+                        if (1)          src[  src_linesize + x    ] = dither_color(src[  src_linesize + x    ], er, eg, eb, 3, 4);
+                        if (right)      src[  src_linesize + x + 1] = dither_color(src[  src_linesize + x + 1], er, eg, eb, 2, 4);
+                        if (right2)     src[  src_linesize + x + 2] = dither_color(src[  src_linesize + x + 2], er, eg, eb, 1, 4);
+                    }
 
-            } else if (dither == DITHERING_SIERRA2_4A) {
-                const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
-                dst[x] = color;
-
-                if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 2, 2);
-                if (left  && down) src[src_linesize + x - 1] = dither_color(src[src_linesize + x - 1], er, eg, eb, 1, 2);
-                if (         down) src[src_linesize + x    ] = dither_color(src[src_linesize + x    ], er, eg, eb, 1, 2);
-
-            } else if (dither == DITHERING_SIERRA3) {
-                const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
-                const int right2 = x < w - 2, down2 = y < h - 2, left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
-
-                if (color < 0)
-                    return color;
-                dst[x] = color;
-
-                if (right)         src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 5, 5);
-                if (right2)        src[                 x + 2] = dither_color(src[                 x + 2], er, eg, eb, 3, 5);
-
-                if (down) {
-                    if (left2)     src[src_linesize   + x - 2] = dither_color(src[src_linesize   + x - 2], er, eg, eb, 2, 5);
-                    if (left)      src[src_linesize   + x - 1] = dither_color(src[src_linesize   + x - 1], er, eg, eb, 4, 5);
-                    if (1)         src[src_linesize   + x    ] = dither_color(src[src_linesize   + x    ], er, eg, eb, 5, 5);
-                    if (right)     src[src_linesize   + x + 1] = dither_color(src[src_linesize   + x + 1], er, eg, eb, 4, 5);
-                    if (right2)    src[src_linesize   + x + 2] = dither_color(src[src_linesize   + x + 2], er, eg, eb, 2, 5);
-
-                    if (down2) {
-                        if (left)  src[src_linesize*2 + x - 1] = dither_color(src[src_linesize*2 + x - 1], er, eg, eb, 2, 5);
-                        if (1)     src[src_linesize*2 + x    ] = dither_color(src[src_linesize*2 + x    ], er, eg, eb, 3, 5);
-                        if (right) src[src_linesize*2 + x + 1] = dither_color(src[src_linesize*2 + x + 1], er, eg, eb, 2, 5);
+                } else if (dither == DITHERING_SIERRA2_4A) {
+                    const int right = x < w - 1, down = y < h - 1, left = x > x_start;
+                    const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
+
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
+
+                    if (right)         src[               x + 1] = dither_color(src[               x + 1], er, eg, eb, 2, 2);
+                    if (left  && down) src[src_linesize + x - 1] = dither_color(src[src_linesize + x - 1], er, eg, eb, 1, 2);
+                    if (         down) src[src_linesize + x    ] = dither_color(src[src_linesize + x    ], er, eg, eb, 1, 2);
+
+                } else if (dither == DITHERING_SIERRA3) {
+                    const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
+                    const int right2 = x < w - 2, down2 = y < h - 2, left2 = x > x_start + 1;
+                    const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
+
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
+
+                    if (right)         src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 5, 5);
+                    if (right2)        src[                 x + 2] = dither_color(src[                 x + 2], er, eg, eb, 3, 5);
+
+                    if (down) {
+                        if (left2)     src[src_linesize   + x - 2] = dither_color(src[src_linesize   + x - 2], er, eg, eb, 2, 5);
+                        if (left)      src[src_linesize   + x - 1] = dither_color(src[src_linesize   + x - 1], er, eg, eb, 4, 5);
+                        if (1)         src[src_linesize   + x    ] = dither_color(src[src_linesize   + x    ], er, eg, eb, 5, 5);
+                        if (right)     src[src_linesize   + x + 1] = dither_color(src[src_linesize   + x + 1], er, eg, eb, 4, 5);
+                        if (right2)    src[src_linesize   + x + 2] = dither_color(src[src_linesize   + x + 2], er, eg, eb, 2, 5);
+
+                        if (down2) {
+                            if (left)  src[src_linesize*2 + x - 1] = dither_color(src[src_linesize*2 + x - 1], er, eg, eb, 2, 5);
+                            if (1)     src[src_linesize*2 + x    ] = dither_color(src[src_linesize*2 + x    ], er, eg, eb, 3, 5);
+                            if (right) src[src_linesize*2 + x + 1] = dither_color(src[src_linesize*2 + x + 1], er, eg, eb, 2, 5);
+                        }
                     }
-                }
 
-            } else if (dither == DITHERING_BURKES) {
-                const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
-                const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                } else if (dither == DITHERING_BURKES) {
+                    const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
+                    const int right2 = x < w - 2,                    left2 = x > x_start + 1;
+                    const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
-                if (color < 0)
-                    return color;
-                dst[x] = color;
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
 
-                if (right)      src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 8, 5);
-                if (right2)     src[                 x + 2] = dither_color(src[                 x + 2], er, eg, eb, 4, 5);
+                    if (right)      src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 8, 5);
+                    if (right2)     src[                 x + 2] = dither_color(src[                 x + 2], er, eg, eb, 4, 5);
 
-                if (down) {
-                    if (left2)  src[src_linesize   + x - 2] = dither_color(src[src_linesize   + x - 2], er, eg, eb, 2, 5);
-                    if (left)   src[src_linesize   + x - 1] = dither_color(src[src_linesize   + x - 1], er, eg, eb, 4, 5);
-                    if (1)      src[src_linesize   + x    ] = dither_color(src[src_linesize   + x    ], er, eg, eb, 8, 5);
-                    if (right)  src[src_linesize   + x + 1] = dither_color(src[src_linesize   + x + 1], er, eg, eb, 4, 5);
-                    if (right2) src[src_linesize   + x + 2] = dither_color(src[src_linesize   + x + 2], er, eg, eb, 2, 5);
-                }
+                    if (down) {
+                        if (left2)  src[src_linesize   + x - 2] = dither_color(src[src_linesize   + x - 2], er, eg, eb, 2, 5);
+                        if (left)   src[src_linesize   + x - 1] = dither_color(src[src_linesize   + x - 1], er, eg, eb, 4, 5);
+                        if (1)      src[src_linesize   + x    ] = dither_color(src[src_linesize   + x    ], er, eg, eb, 8, 5);
+                        if (right)  src[src_linesize   + x + 1] = dither_color(src[src_linesize   + x + 1], er, eg, eb, 4, 5);
+                        if (right2) src[src_linesize   + x + 2] = dither_color(src[src_linesize   + x + 2], er, eg, eb, 2, 5);
+                    }
 
-            } else if (dither == DITHERING_ATKINSON) {
-                const int right  = x < w - 1, down  = y < h - 1, left = x > x_start;
-                const int right2 = x < w - 2, down2 = y < h - 2;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                } else if (dither == DITHERING_ATKINSON) {
+                    const int right  = x < w - 1, down  = y < h - 1, left = x > x_start;
+                    const int right2 = x < w - 2, down2 = y < h - 2;
+                    const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
-                if (color < 0)
-                    return color;
-                dst[x] = color;
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
 
-                if (right)     src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 1, 3);
-                if (right2)    src[                 x + 2] = dither_color(src[                 x + 2], er, eg, eb, 1, 3);
+                    if (right)     src[                 x + 1] = dither_color(src[                 x + 1], er, eg, eb, 1, 3);
+                    if (right2)    src[                 x + 2] = dither_color(src[                 x + 2], er, eg, eb, 1, 3);
 
-                if (down) {
-                    if (left)  src[src_linesize   + x - 1] = dither_color(src[src_linesize   + x - 1], er, eg, eb, 1, 3);
-                    if (1)     src[src_linesize   + x    ] = dither_color(src[src_linesize   + x    ], er, eg, eb, 1, 3);
-                    if (right) src[src_linesize   + x + 1] = dither_color(src[src_linesize   + x + 1], er, eg, eb, 1, 3);
-                    if (down2) src[src_linesize*2 + x    ] = dither_color(src[src_linesize*2 + x    ], er, eg, eb, 1, 3);
-                }
+                    if (down) {
+                        if (left)  src[src_linesize   + x - 1] = dither_color(src[src_linesize   + x - 1], er, eg, eb, 1, 3);
+                        if (1)     src[src_linesize   + x    ] = dither_color(src[src_linesize   + x    ], er, eg, eb, 1, 3);
+                        if (right) src[src_linesize   + x + 1] = dither_color(src[src_linesize   + x + 1], er, eg, eb, 1, 3);
+                        if (down2) src[src_linesize*2 + x    ] = dither_color(src[src_linesize*2 + x    ], er, eg, eb, 1, 3);
+                    }
 
-            } else {
-                const int color = color_get(s, src[x]);
+                } else {
+                    const int color = color_get(s, cache, src[x]);
 
-                if (color < 0)
-                    return color;
-                dst[x] = color;
+                    if (color < 0)
+                        return abort_line(s, y, w, sync, color);
+                    dst[x] = color;
+                }
             }
+
+            if (sync)
+                report_line(s, y, x1);
         }
-        src += src_linesize;
-        dst += dst_linesize;
     }
     return 0;
 }
@@ -767,12 +826,52 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x, y, w, h;
+} ThreadData;
+
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    const ThreadData *td = arg;
+
+    return s->set_frame(s, td->out, td->in, td->x, td->y, td->w, td->h,
+                        jobnr, nb_jobs);
+}
+
+static int alloc_caches(PaletteUseContext *s, int nb_jobs)
+{
+    struct cache_node **cache;
+    int *job_ret;
+
+    if (nb_jobs <= s->nb_cache)
+        return 0;
+
+    cache = av_realloc_array(s->cache, nb_jobs, sizeof(*s->cache));
+    if (!cache)
+        return AVERROR(ENOMEM);
+    s->cache = cache;
+    job_ret = av_realloc_array(s->job_ret, nb_jobs, sizeof(*s->job_ret));
+    if (!job_ret)
+        return AVERROR(ENOMEM);
+    s->job_ret = job_ret;
+
+    for (; s->nb_cache < nb_jobs; s->nb_cache++) {
+        s->cache[s->nb_cache] = av_calloc(CACHE_SIZE, sizeof(**s->cache));
+        if (!s->cache[s->nb_cache])
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
-    int x, y, w, h, ret;
+    int x, y, w, h, ret, nb_jobs;
     AVFilterContext *ctx = inlink->dst;
     PaletteUseContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
+    ThreadData td;
 
     AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out) {
@@ -795,12 +894,33 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
+    /* each job has its own cache, they are not worth filling for a few lines */
+    nb_jobs = FFMIN(h / 16 + 1, ff_filter_get_nb_threads(ctx));
+    ret = alloc_caches(s, nb_jobs);
     if (ret < 0) {
         av_frame_free(&out);
         *outf = NULL;
         return ret;
     }
+
+    atomic_store_explicit(&s->next_line, y, memory_order_relaxed);
+    for (int i = y; i < y + h; i++)
+        atomic_store_explicit(&s->line_progress[i], 0, memory_order_relaxed);
+
+    td.in  = in;
+    td.out = out;
+    td.x   = x;
+    td.y   = y;
+    td.w   = w;
+    td.h   = h;
+    ff_filter_execute(ctx, set_frame_slice, &td, s->job_ret, nb_jobs);
+    for (int i = 0; i < nb_jobs; i++) {
+        if (s->job_ret[i] < 0) {
+            av_frame_free(&out);
+            *outf = NULL;
+            return s->job_ret[i];
+        }
+    }
     memcpy(out->data[1], s->palette, AVPALETTE_SIZE);
     *outf = out;
     return 0;
@@ -822,6 +942,11 @@ static int config_output(AVFilterLink *outlink)
     outlink->w = ctx->inputs[0]->w;
     outlink->h = ctx->inputs[0]->h;
 
+    av_freep(&s->line_progress);
+    s->line_progress = av_calloc(outlink->h, sizeof(*s->line_progress));
+    if (!s->line_progress)
+        return AVERROR(ENOMEM);
+
     outlink->time_base = ctx->inputs[0]->time_base;
     if ((ret = ff_framesync_configure(&s->fs)) < 0)
         return ret;
@@ -854,9 +979,11 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        for (int n = 0; n < s->nb_cache; n++) {
+            for (i = 0; i < CACHE_SIZE; i++)
+                av_freep(&s->cache[n][i].entries);
+            memset(s->cache[n], 0, CACHE_SIZE * sizeof(*s->cache[n]));
+        }
     }
 
     i = 0;
@@ -905,9 +1032,10 @@ static int load_apply_palette(FFFrameSync *fs)
 
 #define DEFINE_SET_FRAME(name, value)                                           \
 static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
-                            int x_start, int y_start, int w, int h)             \
+                            int x_start, int y_start, int w, int h,             \
+                            int jobnr, int nb_jobs)                             \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value);                \
+    return set_frame(s, out, in, x_start, y_start, w, h, jobnr, nb_jobs, value); \
 }
 
 DEFINE_SET_FRAME(none,            DITHERING_NONE)
@@ -943,6 +1071,18 @@ static int dither_value(int p)
 static av_cold int init(AVFilterContext *ctx)
 {
     PaletteUseContext *s = ctx->priv;
+    int ret;
+
+    ret = ff_mutex_init(&s->lock, NULL);
+    if (ret)
+        return AVERROR(ret);
+    ret = ff_cond_init(&s->cond, NULL);
+    if (ret)
+        return AVERROR(ret);
+
+    ret = alloc_caches(s, 1);
+    if (ret < 0)
+        return ret;
 
     s->last_in  = av_frame_alloc();
     s->last_out = av_frame_alloc();
@@ -972,10 +1112,18 @@ static av_cold void uninit(AVFilterContext *ctx)
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (int i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    for (int n = 0; n < s->nb_cache; n++) {
+        for (int i = 0; i < CACHE_SIZE; i++)
+            av_freep(&s->cache[n][i].entries);
+        av_freep(&s->cache[n]);
+    }
+    av_freep(&s->cache);
+    av_freep(&s->job_ret);
+    av_freep(&s->line_progress);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
+    ff_cond_destroy(&s->cond);
+    ff_mutex_destroy(&s->lock);
 }
 
 static const AVFilterPad paletteuse_inputs[] = {
@@ -1001,6 +1149,7 @@ const FFFilter ff_vf_paletteuse = {
     .p.name        = "paletteuse",
     .p.description = NULL_IF_CONFIG_SMALL("Use a palette to downsample an input video stream."),
     .p.priv_class  = &paletteuse_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(PaletteUseContext),
     .init          = init,
     .uninit        = uninit,
@@ -21,11 +21,13 @@
 #include "config_components.h"
 
 #include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 
 #include "avfilter.h"
 #include "drawutils.h"
@@ -34,12 +36,26 @@
 #include "framesync.h"
 #include "video.h"
 
+#define MAX_CANVASES 4
+
 typedef struct StackItem {
     int x[4], y[4];
     int linesize[4];
     int height[4];
+    int pos_x, pos_y;
+    int direct;
 } StackItem;
 
+/**
+ * Output frame whose tiles are handed to the inputs as buffers, see
+ * get_video_buffer().
+ */
+typedef struct StackCanvas {
+    AVFrame *frame;
+    int64_t gen;
+    uint8_t *used;
+} StackCanvas;
+
 typedef struct StackContext {
     const AVClass *class;
     const AVPixFmtDescriptor *desc;
@@ -61,6 +77,13 @@ typedef struct StackContext {
     StackItem *items;
     AVFrame **frames;
     FFFrameSync fs;
+
+    int direct;
+    int covered;
+    StackCanvas canvas[MAX_CANVASES];
+    int64_t *next_gen;
+    AVMutex lock;
+    int64_t nb_tiles, nb_direct_tiles;
 } StackContext;
 
 static int query_formats(const AVFilterContext *ctx,
@@ -81,11 +104,17 @@ static int query_formats(const AVFilterContext *ctx,
                                   ff_formats_pixdesc_filter(0, reject_flags));
 }
 
+static AVFrame *get_video_buffer(AVFilterLink *inlink, int w, int h);
+
 static av_cold int init(AVFilterContext *ctx)
 {
     StackContext *s = ctx->priv;
     int i, ret;
 
+    ret = ff_mutex_init(&s->lock, NULL);
+    if (ret)
+        return AVERROR(ret);
+
     if (!strcmp(ctx->filter->name, "vstack"))
         s->is_vertical = 1;
 
@@ -128,10 +157,21 @@ static av_cold int init(AVFilterContext *ctx)
     if (!s->items)
         return AVERROR(ENOMEM);
 
+    s->next_gen = av_calloc(s->nb_inputs, sizeof(*s->next_gen));
+    if (!s->next_gen)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < MAX_CANVASES; i++) {
+        s->canvas[i].used = av_calloc(s->nb_inputs, sizeof(*s->canvas[i].used));
+        if (!s->canvas[i].used)
+            return AVERROR(ENOMEM);
+    }
+
     for (i = 0; i < s->nb_inputs; i++) {
         AVFilterPad pad = { 0 };
 
         pad.type = AVMEDIA_TYPE_VIDEO;
+        pad.get_buffer.video = get_video_buffer;
         pad.name = av_asprintf("input%d", i);
         if (!pad.name)
             return AVERROR(ENOMEM);
@@ -154,6 +194,8 @@ static int process_slice(AVFilterContext *ctx, void *arg, int job, int nb_jobs)
     for (int i = start; i < end; i++) {
         StackItem *item = &s->items[i];
 
+        if (item->direct)
+            continue;
         for (int p = 0; p < s->nb_planes; p++) {
             av_image_copy_plane(out->data[p] + out->linesize[p] * item->y[p] + item->x[p],
                                 out->linesize[p],
@@ -166,13 +208,158 @@ static int process_slice(AVFilterContext *ctx, void *arg, int job, int nb_jobs)
     return 0;
 }
 
+/**
+ * Get the canvas of a generation, allocating it if needed.
+ * Must be called with the lock held.
+ */
+static StackCanvas *get_canvas(AVFilterContext *ctx, int64_t gen)
+{
+    StackContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    StackCanvas *c = NULL;
+
+    for (int i = 0; i < MAX_CANVASES; i++) {
+        StackCanvas *cv = &s->canvas[i];
+
+        if (cv->frame && cv->gen == gen)
+            return cv;
+        /* Once all the tiles handed out are freed, e.g. because their frames
+         * were dropped before being output, the canvas can never be used. */
+        if (cv->frame && av_buffer_get_ref_count(cv->frame->buf[0]) == 1 &&
+            memchr(cv->used, 1, s->nb_inputs))
+            av_frame_free(&cv->frame);
+        if (!cv->frame && !c)
+            c = cv;
+    }
+    /* all canvases in use: some input is far ahead of the others */
+    if (!c)
+        return NULL;
+
+    c->frame = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!c->frame)
+        return NULL;
+    if (s->fillcolor_enable && !s->covered)
+        ff_fill_rectangle(&s->draw, &s->color, c->frame->data, c->frame->linesize,
+                          0, 0, outlink->w, outlink->h);
+    c->gen = gen;
+    memset(c->used, 0, s->nb_inputs);
+    return c;
+}
+
+/**
+ * Hand the input a view of its tile in a canvas, so that the filter before
+ * writes it directly in place instead of xstack copying it. The n-th buffer
+ * requested on each input is taken from the n-th canvas, which the inputs
+ * normally fill together; process_frame() only uses a canvas as output when
+ * every tile of it is either the frame to output or not handed out, and
+ * copies the tiles otherwise.
+ */
+static AVFrame *get_video_buffer(AVFilterLink *inlink, int w, int h)
+{
+    AVFilterContext *ctx = inlink->dst;
+    StackContext *s = ctx->priv;
+    const int i = FF_INLINK_IDX(inlink);
+    const StackItem *item = &s->items[i];
+    AVFrame *view = NULL;
+    StackCanvas *c;
+
+    if (!s->direct || w != inlink->w || h != inlink->h)
+        return ff_default_get_video_buffer(inlink, w, h);
+
+    ff_mutex_lock(&s->lock);
+    c = get_canvas(ctx, s->next_gen[i]++);
+    if (c && (view = av_frame_alloc())) {
+        if (av_frame_ref(view, c->frame) < 0) {
+            av_frame_free(&view);
+        } else {
+            view->width  = w;
+            view->height = h;
+            for (int p = 0; p < s->nb_planes; p++)
+                view->data[p] += item->y[p] * view->linesize[p] + item->x[p];
+            view->sample_aspect_ratio = inlink->sample_aspect_ratio;
+            view->colorspace  = inlink->colorspace;
+            view->color_range = inlink->color_range;
+            view->alpha_mode  = inlink->alpha_mode;
+            c->used[i] = 1;
+        }
+    }
+    ff_mutex_unlock(&s->lock);
+
+    return view ? view : ff_default_get_video_buffer(inlink, w, h);
+}
+
+static int is_tile_of(const StackContext *s, int i, const AVFrame *frame,
+                      const AVFrame *canvas)
+{
+    const StackItem *item = &s->items[i];
+
+    return frame && frame->buf[0] && canvas->buf[0] &&
+           frame->buf[0]->buffer == canvas->buf[0]->buffer &&
+           frame->data[0] == canvas->data[0] + item->y[0] * canvas->linesize[0] + item->x[0];
+}
+
+/**
+ * Take the oldest canvas usable as output for the current frames, if any,
+ * and drop the older ones, which can no longer be completed.
+ */
+static AVFrame *take_canvas(StackContext *s)
+{
+    StackCanvas *best = NULL;
+    AVFrame *out = NULL;
+
+    ff_mutex_lock(&s->lock);
+    for (int j = 0; j < MAX_CANVASES; j++) {
+        StackCanvas *c = &s->canvas[j];
+        int i;
+
+        if (!c->frame || (best && best->gen < c->gen))
+            continue;
+        for (i = 0; i < s->nb_inputs; i++)
+            if (c->used[i] && !is_tile_of(s, i, s->frames[i], c->frame))
+                break;
+        if (i == s->nb_inputs)
+            best = c;
+    }
+    if (best) {
+        out = best->frame;
+        best->frame = NULL;
+        for (int j = 0; j < MAX_CANVASES; j++)
+            if (s->canvas[j].frame && s->canvas[j].gen < best->gen)
+                av_frame_free(&s->canvas[j].frame);
+        for (int i = 0; i < s->nb_inputs; i++) {
+            s->items[i].direct = best->used[i];
+            /* let an input that skipped buffers catch up with the others */
+            s->next_gen[i] = FFMAX(s->next_gen[i], best->gen + 1);
+        }
+    }
+    ff_mutex_unlock(&s->lock);
+
+    return out;
+}
+
+/**
+ * Drop the reference framesync holds on a frame written directly into the
+ * output, so that the output is writable downstream. If framesync may still
+ * output the frame again, it keeps a copy of its own.
+ */
+static int release_tile(StackContext *s, int i)
+{
+    AVFrame *frame;
+    int ret = ff_framesync_get_frame(&s->fs, i, &frame, 1);
+
+    if (ret < 0)
+        return ret;
+    av_frame_free(&frame);
+    return s->fs.in[i].frame ? av_frame_make_writable(s->fs.in[i].frame) : 0;
+}
+
 static int process_frame(FFFrameSync *fs)
 {
     AVFilterContext *ctx = fs->parent;
     AVFilterLink *outlink = ctx->outputs[0];
     StackContext *s = fs->opaque;
     AVFrame **in = s->frames;
-    AVFrame *out;
+    AVFrame *out = NULL;
     int i, ret;
 
     for (i = 0; i < s->nb_inputs; i++) {
@@ -180,22 +367,69 @@ static int process_frame(FFFrameSync *fs)
             return ret;
     }
 
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
-    if (!out)
-        return AVERROR(ENOMEM);
+    if (s->direct)
+        out = take_canvas(s);
+    if (!out) {
+        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out)
+            return AVERROR(ENOMEM);
+        if (s->fillcolor_enable)
+            ff_fill_rectangle(&s->draw, &s->color, out->data, out->linesize,
+                              0, 0, outlink->w, outlink->h);
+        for (i = 0; i < s->nb_inputs; i++)
+            s->items[i].direct = 0;
+    }
     out->pts = av_rescale_q(s->fs.pts, s->fs.time_base, outlink->time_base);
     out->sample_aspect_ratio = outlink->sample_aspect_ratio;
 
-    if (s->fillcolor_enable)
-        ff_fill_rectangle(&s->draw, &s->color, out->data, out->linesize,
-                          0, 0, outlink->w, outlink->h);
-
     ff_filter_execute(ctx, process_slice, out, NULL,
                       FFMIN(s->nb_inputs, ff_filter_get_nb_threads(ctx)));
 
+    for (i = 0; i < s->nb_inputs; i++) {
+        if (s->items[i].direct && (ret = release_tile(s, i)) < 0) {
+            av_frame_free(&out);
+            return ret;
+        }
+        s->nb_direct_tiles += s->items[i].direct;
+    }
+    s->nb_tiles += s->nb_inputs;
+
     return ff_filter_frame(outlink, out);
 }
 
+/**
+ * Check whether the inputs can be given their tile of the output frame as
+ * buffer: the tiles must not overlap and must be suitably aligned.
+ */
+static void config_direct(AVFilterContext *ctx, int width, int height)
+{
+    StackContext *s = ctx->priv;
+    const int align = av_cpu_max_align();
+    int64_t area = 0;
+
+    s->direct = 1;
+    for (int i = 0; i < s->nb_inputs && s->direct; i++) {
+        const AVFilterLink *a = ctx->inputs[i];
+        const StackItem *ia = &s->items[i];
+
+        for (int p = 0; p < s->nb_planes; p++)
+            if (ia->x[p] % align)
+                s->direct = 0;
+        for (int j = 0; j < i; j++) {
+            const AVFilterLink *b = ctx->inputs[j];
+            const StackItem *ib = &s->items[j];
+
+            if (ia->pos_x < ib->pos_x + b->w && ib->pos_x < ia->pos_x + a->w &&
+                ia->pos_y < ib->pos_y + b->h && ib->pos_y < ia->pos_y + a->h)
+                s->direct = 0;
+        }
+        area += (int64_t)a->w * a->h;
+    }
+    s->covered = s->direct && area == (int64_t)width * height;
+    av_log(ctx, AV_LOG_VERBOSE, "Inputs %s written directly into the output.\n",
+           s->direct ? "are" : "are not");
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -233,6 +467,7 @@ static int config_output(AVFilterLink *outlink)
             if (i) {
                 item->y[1] = item->y[2] = AV_CEIL_RSHIFT(height, s->desc->log2_chroma_h);
                 item->y[0] = item->y[3] = height;
+                item->pos_y = height;
 
                 height += ctx->inputs[i]->h;
             }
@@ -258,6 +493,7 @@ static int config_output(AVFilterLink *outlink)
                 if ((ret = av_image_fill_linesizes(item->x, inlink->format, width)) < 0) {
                     return ret;
                 }
+                item->pos_x = width;
 
                 width += ctx->inputs[i]->w;
             }
@@ -294,6 +530,8 @@ static int config_output(AVFilterLink *outlink)
 
                 item->y[1] = item->y[2] = AV_CEIL_RSHIFT(inh, s->desc->log2_chroma_h);
                 item->y[0] = item->y[3] = inh;
+                item->pos_x = inw;
+                item->pos_y = inh;
                 inw += ctx->inputs[k]->w;
             }
             height += row_height;
@@ -383,6 +621,8 @@ static int config_output(AVFilterLink *outlink)
 
             item->y[1] = item->y[2] = AV_CEIL_RSHIFT(inh, s->desc->log2_chroma_h);
             item->y[0] = item->y[3] = inh;
+            item->pos_x = inw;
+            item->pos_y = inh;
 
             width  = FFMAX(width,  inlink->w + inw);
             height = FFMAX(height, inlink->h + inh);
@@ -396,6 +636,8 @@ static int config_output(AVFilterLink *outlink)
     ol->frame_rate      = frame_rate;
     outlink->sample_aspect_ratio = sar;
 
+    config_direct(ctx, width, height);
+
     for (i = 1; i < s->nb_inputs; i++) {
         il = ff_filter_link(ctx->inputs[i]);
         if (ol->frame_rate.num != il->frame_rate.num ||
@@ -433,9 +675,18 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     StackContext *s = ctx->priv;
 
+    if (s->direct)
+        av_log(ctx, AV_LOG_VERBOSE, "%"PRId64" of %"PRId64" tiles written directly "
+               "into the output.\n", s->nb_direct_tiles, s->nb_tiles);
     ff_framesync_uninit(&s->fs);
     av_freep(&s->frames);
     av_freep(&s->items);
+    av_freep(&s->next_gen);
+    for (int i = 0; i < MAX_CANVASES; i++) {
+        av_frame_free(&s->canvas[i].frame);
+        av_freep(&s->canvas[i].used);
+    }
+    ff_mutex_destroy(&s->lock);
 }
 
 static int activate(AVFilterContext *ctx)
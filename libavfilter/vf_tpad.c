@@ -49,6 +49,7 @@ typedef struct TPadContext {
     int eof;
     AVFrame *cache_start;
     AVFrame *cache_stop;
+    int stop_held;          ///< cache_stop has not been sent yet
 } TPadContext;
 
 #define OFFSET(x) offsetof(TPadContext, x)
@@ -155,16 +156,41 @@ static int activate(AVFilterContext *ctx)
         if (ret < 0)
             return ret;
         if (ret > 0) {
+            frame->pts += s->pts;
             if (s->stop_mode == MODE_CLONE && s->pad_stop != 0) {
-                av_frame_free(&s->cache_stop);
-                s->cache_stop = av_frame_clone(frame);
+                if (l->write_intent || s->stop_held) {
+                    /* Hold the frame back until the next one shows it is not
+                     * the last, rather than keeping a reference to every
+                     * frame sent, which would force all of them to be copied.
+                     * The write intent may change when the graph is fused
+                     * again at runtime, so once a frame is held the following
+                     * ones are held too, and a reference kept to a frame
+                     * already sent is dropped on the switch. */
+                    if (!s->stop_held)
+                        av_frame_free(&s->cache_stop);
+                    FFSWAP(AVFrame *, frame, s->cache_stop);
+                    s->stop_held = 1;
+                    if (!frame) {
+                        ff_filter_set_ready(ctx, 100);
+                        return 0;
+                    }
+                } else {
+                    av_frame_free(&s->cache_stop);
+                    s->cache_stop = av_frame_clone(frame);
+                }
             }
-            frame->pts += s->pts;
             return ff_filter_frame(outlink, frame);
         }
     }
 
     if (s->eof) {
+        if (s->stop_held) {
+            s->stop_held = 0;
+            frame = av_frame_clone(s->cache_stop);
+            if (!frame)
+                return AVERROR(ENOMEM);
+            return ff_filter_frame(outlink, frame);
+        }
         if (!s->pad_stop) {
             ff_outlink_set_status(outlink, AVERROR_EOF, s->pts);
             return 0;
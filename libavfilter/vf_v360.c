@@ -4122,10 +4122,10 @@ static int allocate_plane(V360Context *s, int sizeof_uv, int sizeof_ker, int siz
 {
     const int pr_height = s->pr_height[p];
 
-    for (int n = 0; n < s->nb_threads; n++) {
+    for (int n = 0; n < s->nb_jobs; n++) {
         SliceXYRemap *r = &s->slice_remap[n];
-        const int slice_start = (pr_height *  n     ) / s->nb_threads;
-        const int slice_end   = (pr_height * (n + 1)) / s->nb_threads;
+        const int slice_start = (pr_height *  n     ) / s->nb_jobs;
+        const int slice_end   = (pr_height * (n + 1)) / s->nb_jobs;
         const int height = slice_end - slice_start;
 
         if (!r->u[p])
@@ -4866,7 +4866,7 @@ static int config_output(AVFilterLink *outlink)
     outlink->h = h;
     outlink->w = w;
 
-    s->nb_threads = FFMIN(outlink->h, ff_filter_get_nb_threads(ctx));
+    s->nb_jobs = ff_filter_get_nb_jobs(ctx, outlink->h);
     s->nb_planes = av_pix_fmt_count_planes(inlink->format);
     have_alpha   = !!(desc->flags & AV_PIX_FMT_FLAG_ALPHA);
 
@@ -4880,7 +4880,7 @@ static int config_output(AVFilterLink *outlink)
     }
 
     if (!s->slice_remap)
-        s->slice_remap = av_calloc(s->nb_threads, sizeof(*s->slice_remap));
+        s->slice_remap = av_calloc(s->nb_jobs, sizeof(*s->slice_remap));
     if (!s->slice_remap)
         return AVERROR(ENOMEM);
 
@@ -4895,7 +4895,7 @@ static int config_output(AVFilterLink *outlink)
 
     set_mirror_modifier(s->h_flip, s->v_flip, s->d_flip, s->output_mirror_modifier);
 
-    ff_filter_execute(ctx, v360_slice, NULL, NULL, s->nb_threads);
+    ff_filter_execute(ctx, v360_slice, NULL, NULL, s->nb_jobs);
 
     return 0;
 }
@@ -4918,7 +4918,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     td.in = in;
     td.out = out;
 
-    ff_filter_execute(ctx, s->remap_slice, &td, NULL, s->nb_threads);
+    ff_filter_execute(ctx, s->remap_slice, &td, NULL, s->nb_jobs);
 
     av_frame_free(&in);
     return ff_filter_frame(outlink, out);
@@ -4964,7 +4964,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     V360Context *s = ctx->priv;
 
-    for (int n = 0; n < s->nb_threads && s->slice_remap; n++) {
+    for (int n = 0; n < s->nb_jobs && s->slice_remap; n++) {
         SliceXYRemap *r = &s->slice_remap[n];
 
         for (int p = 0; p < s->nb_allocated; p++) {
@@ -61,6 +61,9 @@ static const AVOption options[] = {
     {"protocol_whitelist", "List of protocols that are allowed to be used", OFFSET(protocol_whitelist), AV_OPT_TYPE_STRING, { .str = NULL },  0, 0, D },
     {"protocol_blacklist", "List of protocols that are not allowed to be used", OFFSET(protocol_blacklist), AV_OPT_TYPE_STRING, { .str = NULL },  0, 0, D },
     {"rw_timeout", "Timeout for IO operations (in microseconds)", offsetof(URLContext, rw_timeout), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM | AV_OPT_FLAG_DECODING_PARAM },
+    {"adaptive_buffer", "Adapt the IO buffer size to the read throughput", OFFSET(adaptive_buffer), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    {"adaptive_buffer_min", "Minimum IO buffer size with adaptive_buffer", OFFSET(adaptive_buffer_min), AV_OPT_TYPE_INT, { .i64 = 4096 }, 512, INT_MAX / 2, D },
+    {"adaptive_buffer_max", "Maximum IO buffer size with adaptive_buffer", OFFSET(adaptive_buffer_max), AV_OPT_TYPE_INT, { .i64 = 4 << 20 }, 512, INT_MAX / 2, D },
     { NULL }
 };
 
@@ -465,6 +468,16 @@ int ffio_fdopen(AVIOContext **sp, URLContext *h)
             s->seekable |= AVIO_SEEKABLE_TIME;
     }
     ((FFIOContext*)s)->short_seek_get = ffurl_get_short_seek;
+    /* Packetized protocols need buffers of exactly max_packet_size */
+    if (h->adaptive_buffer && !max_packet_size && !s->write_flag) {
+        ((FFIOContext*)s)->adaptive_min_size = h->adaptive_buffer_min;
+        ((FFIOContext*)s)->adaptive_max_size = FFMAX(h->adaptive_buffer_min,
+                                                     h->adaptive_buffer_max);
+    }
+    if (!s->write_flag) {
+        ffurl_get_mapping(h, &((FFIOContext*)s)->mapping);
+        ((FFIOContext*)s)->map_range = ffurl_map_range;
+    }
     s->av_class = &ff_avio_class;
     return 0;
 }
@@ -633,8 +646,11 @@ int avio_close(AVIOContext *s)
                "Statistics: %"PRId64" bytes written, %d seeks, %d writeouts\n",
                ctx->bytes_written, ctx->seek_count, ctx->writeout_count);
     else
-        av_log(s, AV_LOG_VERBOSE, "Statistics: %"PRId64" bytes read, %d seeks\n",
-               ctx->bytes_read, ctx->seek_count);
+        av_log(s, AV_LOG_VERBOSE, "Statistics: %"PRId64" bytes read, %d seeks, "
+               "%"PRId64" reads (%"PRId64" bytes on average), %d buffer resizes\n",
+               ctx->bytes_read, ctx->seek_count, ctx->read_count,
+               ctx->read_count ? ctx->bytes_read / ctx->read_count : 0,
+               ctx->resize_count);
     av_opt_free(s);
 
     error = s->error;
@@ -845,6 +861,22 @@ int ffurl_get_short_seek(void *urlcontext)
     return h->prot->url_get_short_seek(h);
 }
 
+int ffurl_get_mapping(URLContext *h, AVBufferRef **mapping)
+{
+    if (!h || !h->prot || !h->prot->url_get_mapping)
+        return AVERROR(ENOSYS);
+    return h->prot->url_get_mapping(h, mapping);
+}
+
+int ffurl_map_range(void *urlcontext, int64_t pos, int size, AVBufferRef **buf)
+{
+    URLContext *h = urlcontext;
+
+    if (!h || !h->prot || !h->prot->url_map_range)
+        return AVERROR(ENOSYS);
+    return h->prot->url_map_range(h, pos, size, buf);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h || !h->prot || !h->prot->url_shutdown)
@@ -21,6 +21,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/log.h"
 
 extern const AVClass ff_avio_class;
@@ -76,6 +77,36 @@ typedef struct FFIOContext {
      * is updated each time a successful writeout ends up further position-wise
      */
     int64_t written_output_size;
+
+    /**
+     * Read-only memory mapping of the whole resource, if provided by the
+     * protocol. Allows reading data without copying it.
+     */
+    AVBufferRef *mapping;
+
+    /**
+     * A callback returning a private, writable and padded buffer holding
+     * the given range of the resource, without copying it.
+     */
+    int (*map_range)(void *opaque, int64_t pos, int size, AVBufferRef **buf);
+
+    /**
+     * Read statistics
+     */
+    int64_t read_count;
+    int resize_count;
+
+    /**
+     * Adaptive buffer sizing, enabled if adaptive_max_size is non zero.
+     * The buffer size follows the measured read throughput so that each
+     * read covers a roughly constant duration.
+     */
+    int adaptive_min_size;
+    int adaptive_max_size;
+    int adaptive_size;          ///< size to switch to on the next refill
+    int64_t adaptive_start;     ///< start of the measurement window
+    int64_t adaptive_bytes;     ///< bytes read in the window
+    int64_t adaptive_requested; ///< bytes requested in the window
 } FFIOContext;
 
 static av_always_inline FFIOContext *ffiocontext(AVIOContext *ctx)
@@ -119,6 +150,19 @@ void ffio_init_write_context(FFIOContext *s, uint8_t *buffer, int buffer_size);
  */
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
 
+/**
+ * Read size bytes from AVIOContext into a buffer mapping them from the
+ * resource, without copying them.
+ * The buffer is writable, and its data is followed by
+ * AV_INPUT_BUFFER_PADDING_SIZE zero bytes.
+ *
+ * @param buf set to the new buffer on success, its data pointing to the
+ *            requested bytes
+ * @return size on success, <0 if the data cannot be mapped, in which case
+ *         nothing was read
+ */
+int ffio_read_ref(AVIOContext *s, int size, AVBufferRef **buf);
+
 void ffio_fill(AVIOContext *s, int b, int64_t count);
 
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
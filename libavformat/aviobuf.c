@@ -27,6 +27,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/avassert.h"
+#include "libavutil/time.h"
 #include "libavcodec/defs.h"
 #include "avio.h"
 #include "avio_internal.h"
@@ -129,6 +130,7 @@ void avio_context_free(AVIOContext **ps)
     if (s) {
         av_freep(&s->protocol_whitelist);
         av_freep(&s->protocol_blacklist);
+        av_buffer_unref(&ffiocontext(s)->mapping);
     }
     av_freep(ps);
 }
@@ -511,6 +513,39 @@ static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
 
 /* Input stream */
 
+#define ADAPTIVE_WINDOW      100000 ///< microseconds between size decisions
+#define ADAPTIVE_READ_PERIOD  10000 ///< duration of data a read should cover
+
+static void adaptive_update(FFIOContext *ctx, int len, int requested)
+{
+    int64_t now = av_gettime_relative();
+    int64_t elapsed, target;
+    int size;
+
+    ctx->adaptive_bytes     += len;
+    ctx->adaptive_requested += requested;
+    if (!ctx->adaptive_start) {
+        ctx->adaptive_start = now;
+        return;
+    }
+    elapsed = now - ctx->adaptive_start;
+    if (elapsed < ADAPTIVE_WINDOW)
+        return;
+
+    target = av_rescale(ctx->adaptive_bytes, ADAPTIVE_READ_PERIOD, elapsed);
+    for (size = ctx->adaptive_min_size; size < target && size < ctx->adaptive_max_size; )
+        size = FFMIN(2LL * size, ctx->adaptive_max_size);
+
+    /* Short reads mean the protocol does not deliver more per call anyway */
+    if (size > ctx->pub.buffer_size && 2 * ctx->adaptive_bytes < ctx->adaptive_requested)
+        size = ctx->pub.buffer_size;
+    ctx->adaptive_size = size;
+
+    ctx->adaptive_start     = now;
+    ctx->adaptive_bytes     = 0;
+    ctx->adaptive_requested = 0;
+}
+
 static void fill_buffer(AVIOContext *s)
 {
     FFIOContext *const ctx = (FFIOContext *)s;
@@ -519,6 +554,7 @@ static void fill_buffer(AVIOContext *s)
     uint8_t *dst        = s->buf_end - s->buffer + max_buffer_size <= s->buffer_size ?
                           s->buf_end : s->buffer;
     int len             = s->buffer_size - (dst - s->buffer);
+    int requested;
 
     /* can't fill the buffer without read_packet, just set EOF if appropriate */
     if (!s->read_packet && s->buf_ptr >= s->buf_end)
@@ -535,6 +571,20 @@ static void fill_buffer(AVIOContext *s)
         s->checksum_ptr = s->buffer;
     }
 
+    if (ctx->adaptive_size && ctx->adaptive_size != s->buffer_size &&
+        dst == s->buffer && s->buf_ptr >= s->buf_end) {
+        int ret = set_buf_size(s, ctx->adaptive_size);
+        if (ret < 0) {
+            av_log(s, AV_LOG_WARNING, "Failed to resize buffer\n");
+        } else {
+            av_log(s, AV_LOG_DEBUG, "Buffer size set to %d\n", s->buffer_size);
+            ctx->resize_count++;
+        }
+        ctx->adaptive_size = 0;
+        s->checksum_ptr = dst = s->buffer;
+        len = s->buffer_size;
+    }
+
     /* make buffer smaller in case it ended up large after probing */
     if (s->read_packet && ctx->orig_buffer_size &&
         s->buffer_size > ctx->orig_buffer_size  && len >= ctx->orig_buffer_size) {
@@ -548,7 +598,9 @@ static void fill_buffer(AVIOContext *s)
         len = ctx->orig_buffer_size;
     }
 
+    requested = len;
     len = read_packet_wrapper(s, dst, len);
+    ctx->read_count++;
     if (len == AVERROR_EOF) {
         /* do not modify buffer if EOF reached so that a seek back can
            be done without rereading data */
@@ -562,6 +614,8 @@ static void fill_buffer(AVIOContext *s)
         s->buf_end = dst + len;
         ffiocontext(s)->bytes_read += len;
         s->bytes_read = ffiocontext(s)->bytes_read;
+        if (ctx->adaptive_max_size)
+            adaptive_update(ctx, len, requested);
     }
 }
 
@@ -672,18 +726,63 @@ int ffio_read_size(AVIOContext *s, unsigned char *buf, int size)
     return AVERROR_INVALIDDATA;
 }
 
+/* Return the mapped data at the current position and skip over it,
+ * or NULL if size bytes are not mapped. */
+static const uint8_t *mapped_data(AVIOContext *s, int size)
+{
+    AVBufferRef *mapping = ffiocontext(s)->mapping;
+    int64_t pos;
+    const uint8_t *data;
+
+    if (!mapping || s->write_flag || size < 0)
+        return NULL;
+    pos = avio_tell(s);
+    if (pos < 0 || pos + size > mapping->size)
+        return NULL;
+    data = mapping->data + pos;
+
+    if (s->buf_end - s->buf_ptr >= size)
+        s->buf_ptr += size;
+    else if (avio_seek(s, pos + size, SEEK_SET) < 0)
+        return NULL;
+    return data;
+}
+
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data)
 {
     if (s->buf_end - s->buf_ptr >= size && !s->write_flag) {
         *data = s->buf_ptr;
         s->buf_ptr += size;
         return size;
+    } else if ((*data = mapped_data(s, size))) {
+        return size;
     } else {
         *data = buf;
         return avio_read(s, buf, size);
     }
 }
 
+int ffio_read_ref(AVIOContext *s, int size, AVBufferRef **buf)
+{
+    FFIOContext *const ctx = ffiocontext(s);
+    int64_t pos = avio_tell(s);
+    int ret;
+
+    if (!ctx->map_range || s->write_flag || size <= 0 || pos < 0)
+        return AVERROR(ENOSYS);
+    ret = ctx->map_range(s->opaque, pos, size, buf);
+    if (ret < 0)
+        return ret;
+
+    if (s->buf_end - s->buf_ptr >= size)
+        s->buf_ptr += size;
+    else if (avio_seek(s, pos + size, SEEK_SET) < 0) {
+        av_buffer_unref(buf);
+        return AVERROR(ENOSYS);
+    }
+    return size;
+}
+
 int avio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
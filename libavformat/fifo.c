@@ -22,17 +22,23 @@
 #include <stdatomic.h>
 
 #include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/random_seed.h"
 #include "libavutil/time.h"
 #include "libavutil/thread.h"
 #include "libavutil/threadmessage.h"
 #include "avformat.h"
+#include "avio_internal.h"
 #include "internal.h"
 #include "mux.h"
+#include "url.h"
 
 #define FIFO_DEFAULT_QUEUE_SIZE              60
 #define FIFO_DEFAULT_MAX_RECOVERY_ATTEMPTS   0
 #define FIFO_DEFAULT_RECOVERY_WAIT_TIME_USEC 5000000 // 5 seconds
+#define FIFO_DEFAULT_SPOOL_SEGMENT_SIZE      (64 << 20)
 
 typedef struct FifoContext {
     const AVClass *class;
@@ -83,6 +89,22 @@ typedef struct FifoContext {
     atomic_int_least64_t queue_duration;
     int64_t last_sent_dts;
     int64_t timeshift;
+
+    /* If set, packet payloads of the timeshift buffer are spooled to
+     * segment files in this directory and only the packet properties
+     * are kept in the queue. */
+    char *timeshift_dir;
+    int64_t spool_segment_size;
+    uint32_t spool_id;
+
+    /* Written only by the producer (muxer caller) thread */
+    AVIOContext *spool_out;
+    int spool_out_seg;
+    int64_t spool_out_pos;
+
+    /* Written only by the consumer thread */
+    AVIOContext *spool_in;
+    int spool_in_seg;
 } FifoContext;
 
 typedef struct FifoThreadContext {
@@ -115,14 +137,145 @@ typedef enum FifoMessageType {
     FIFO_NOOP,
     FIFO_WRITE_HEADER,
     FIFO_WRITE_PACKET,
-    FIFO_FLUSH_OUTPUT
+    FIFO_FLUSH_OUTPUT,
+    FIFO_WRITE_SPOOLED_PACKET,
 } FifoMessageType;
 
 typedef struct FifoMessage {
     FifoMessageType type;
     AVPacket pkt;
+
+    /* Location of the payload of FIFO_WRITE_SPOOLED_PACKET messages,
+     * pkt only carries the packet properties in that case. */
+    int spool_seg;
+    int spool_size;
+    int64_t spool_pos;
 } FifoMessage;
 
+static char *spool_segment_name(const FifoContext *fifo, int seg)
+{
+    return av_asprintf("%s/fifo-%08"PRIx32"-%06d.seg",
+                       fifo->timeshift_dir, fifo->spool_id, seg);
+}
+
+static void spool_delete_segments(AVFormatContext *avf, int first, int last)
+{
+    FifoContext *fifo = avf->priv_data;
+
+    for (int seg = first; seg <= last; seg++) {
+        char *name = spool_segment_name(fifo, seg);
+        int ret;
+
+        if (!name)
+            return;
+        ret = ffurl_delete(name);
+        if (ret < 0 && ret != AVERROR(ENOENT))
+            av_log(avf, AV_LOG_WARNING, "Could not delete %s: %s\n",
+                   name, av_err2str(ret));
+        av_free(name);
+    }
+}
+
+static int spool_open_segment(AVFormatContext *avf, AVIOContext **pb,
+                              int seg, int flags)
+{
+    FifoContext *fifo = avf->priv_data;
+    char *name = spool_segment_name(fifo, seg);
+    int ret;
+
+    if (!name)
+        return AVERROR(ENOMEM);
+
+    ret = avio_open2(pb, name, flags, &avf->interrupt_callback, NULL);
+    if (ret < 0)
+        av_log(avf, AV_LOG_ERROR, "Error opening timeshift segment %s: %s\n",
+               name, av_err2str(ret));
+    av_free(name);
+    return ret;
+}
+
+/* Called from the producer thread: append the payload of pkt to the
+ * current segment and turn msg into a spooled packet referencing it. */
+static int spool_write_packet(AVFormatContext *avf, FifoMessage *msg,
+                              const AVPacket *pkt)
+{
+    FifoContext *fifo = avf->priv_data;
+    int ret;
+
+    if (fifo->spool_out && fifo->spool_out_pos &&
+        fifo->spool_out_pos + pkt->size > fifo->spool_segment_size) {
+        avio_closep(&fifo->spool_out);
+        fifo->spool_out_seg++;
+    }
+    if (!fifo->spool_out) {
+        ret = spool_open_segment(avf, &fifo->spool_out, fifo->spool_out_seg,
+                                 AVIO_FLAG_WRITE);
+        if (ret < 0)
+            return ret;
+        fifo->spool_out_pos = 0;
+    }
+
+    avio_write(fifo->spool_out, pkt->data, pkt->size);
+    /* The consumer may read the payload as soon as the message is queued */
+    avio_flush(fifo->spool_out);
+    ret = fifo->spool_out->error;
+    if (ret < 0)
+        return ret;
+
+    ret = av_packet_copy_props(&msg->pkt, pkt);
+    if (ret < 0)
+        return ret;
+
+    msg->type       = FIFO_WRITE_SPOOLED_PACKET;
+    msg->spool_seg  = fifo->spool_out_seg;
+    msg->spool_pos  = fifo->spool_out_pos;
+    msg->spool_size = pkt->size;
+    fifo->spool_out_pos += pkt->size;
+
+    return 0;
+}
+
+/* Called from the consumer thread: read back the payload of a spooled
+ * packet and turn msg into a regular FIFO_WRITE_PACKET message. */
+static int spool_read_packet(AVFormatContext *avf, FifoMessage *msg)
+{
+    FifoContext *fifo = avf->priv_data;
+    AVPacket *pkt = &msg->pkt;
+    int ret;
+
+    if (!fifo->spool_in || fifo->spool_in_seg != msg->spool_seg) {
+        avio_closep(&fifo->spool_in);
+        /* Segments are consumed in order, earlier ones are not needed
+         * anymore, including those whose packets were flushed. */
+        spool_delete_segments(avf, fifo->spool_in_seg, msg->spool_seg - 1);
+        fifo->spool_in_seg = msg->spool_seg;
+        ret = spool_open_segment(avf, &fifo->spool_in, msg->spool_seg,
+                                 AVIO_FLAG_READ);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (avio_tell(fifo->spool_in) != msg->spool_pos) {
+        int64_t pos = avio_seek(fifo->spool_in, msg->spool_pos, SEEK_SET);
+        if (pos < 0)
+            return pos;
+    }
+
+    ret = av_buffer_realloc(&pkt->buf, msg->spool_size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (ret < 0)
+        return ret;
+    memset(pkt->buf->data + msg->spool_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    pkt->data = pkt->buf->data;
+    pkt->size = msg->spool_size;
+
+    ret = ffio_read_size(fifo->spool_in, pkt->data, pkt->size);
+    if (ret < 0)
+        return ret;
+
+    msg->type = FIFO_WRITE_PACKET;
+    return 0;
+}
+
 static int fifo_thread_write_header(FifoThreadContext *ctx)
 {
     AVFormatContext *avf = ctx->avf;
@@ -301,7 +454,8 @@ static void free_message(void *msg)
 {
     FifoMessage *fifo_msg = msg;
 
-    if (fifo_msg->type == FIFO_WRITE_PACKET)
+    if (fifo_msg->type == FIFO_WRITE_PACKET ||
+        fifo_msg->type == FIFO_WRITE_SPOOLED_PACKET)
         av_packet_unref(&fifo_msg->pkt);
 }
 
@@ -493,6 +647,14 @@ static void *fifo_consumer_thread(void *data)
                 av_usleep(10000);
 
         ret = av_thread_message_queue_recv(queue, &msg, 0);
+        if (ret >= 0 && msg.type == FIFO_WRITE_SPOOLED_PACKET) {
+            ret = spool_read_packet(avf, &msg);
+            if (ret < 0) {
+                av_log(avf, AV_LOG_ERROR, "Error reading timeshift buffer: %s\n",
+                       av_err2str(ret));
+                free_message(&msg);
+            }
+        }
         if (ret < 0) {
             av_thread_message_queue_set_err_send(queue, ret);
             break;
@@ -547,8 +709,13 @@ static int fifo_init(AVFormatContext *avf)
                " only when drop_pkts_on_overflow is also turned on\n");
         return AVERROR(EINVAL);
     }
+    if (fifo->timeshift_dir && !fifo->timeshift) {
+        av_log(avf, AV_LOG_ERROR, "timeshift_dir requires timeshift to be set\n");
+        return AVERROR(EINVAL);
+    }
     atomic_init(&fifo->queue_duration, 0);
     fifo->last_sent_dts = AV_NOPTS_VALUE;
+    fifo->spool_id = av_get_random_seed();
 
 #ifdef FIFO_TEST
     /* This exists for the fifo_muxer test tool. */
@@ -603,7 +770,13 @@ static int fifo_write_packet(AVFormatContext *avf, AVPacket *pkt)
     FifoMessage msg = {.type = pkt ? FIFO_WRITE_PACKET : FIFO_FLUSH_OUTPUT};
     int ret;
 
-    if (pkt) {
+    if (pkt && fifo->timeshift_dir) {
+        ret = spool_write_packet(avf, &msg, pkt);
+        if (ret < 0) {
+            av_packet_unref(&msg.pkt);
+            return ret;
+        }
+    } else if (pkt) {
         ret = av_packet_ref(&msg.pkt,pkt);
         if (ret < 0)
             return ret;
@@ -686,6 +859,11 @@ static void fifo_deinit(AVFormatContext *avf)
 
     avformat_free_context(fifo->avf);
     av_thread_message_queue_free(&fifo->queue);
+    if (fifo->timeshift_dir) {
+        avio_closep(&fifo->spool_out);
+        avio_closep(&fifo->spool_in);
+        spool_delete_segments(avf, fifo->spool_in_seg, fifo->spool_out_seg);
+    }
     if (fifo->overflow_flag_lock_initialized)
         pthread_mutex_destroy(&fifo->overflow_flag_lock);
 }
@@ -725,6 +903,12 @@ static const AVOption options[] = {
         {"timeshift", "Delay fifo output", OFFSET(timeshift),
          AV_OPT_TYPE_DURATION, {.i64 = 0}, 0, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM},
 
+        {"timeshift_dir", "Directory used to store the timeshift buffer on disk", OFFSET(timeshift_dir),
+         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM},
+
+        {"timeshift_segment_size", "Maximum size of one timeshift buffer segment file", OFFSET(spool_segment_size),
+         AV_OPT_TYPE_INT64, {.i64 = FIFO_DEFAULT_SPOOL_SEGMENT_SIZE}, 1, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+
         {NULL},
 };
 
@@ -21,7 +21,9 @@
 
 #include "config_components.h"
 
+#include "libavcodec/defs.h"
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
@@ -39,6 +41,12 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#if CONFIG_LIBURING
+#include <liburing.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -89,6 +97,21 @@
 
 /* standard file protocol */
 
+#if CONFIG_LIBURING
+/* Alignment of buffers, offsets and sizes required by O_DIRECT */
+#define URING_ALIGN 4096
+
+typedef struct URingBuffer {
+    uint8_t *data;
+    int64_t pos;        ///< file offset of data[0]
+    int size;           ///< number of bytes requested
+    int done;           ///< bytes of a write completed by earlier requests
+    int len;            ///< result of the completed request
+    int pending;
+    int write;
+} URingBuffer;
+#endif
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -100,6 +123,30 @@ typedef struct FileContext {
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+#if HAVE_MMAP
+    int use_mmap;
+    AVBufferRef *mapping;
+    int64_t map_pos;
+    long page_size;
+    AVBufferRef *window;    ///< private mapping packets are cut from
+    int64_t window_pos;     ///< file offset of window->data[0]
+    int64_t window_next;    ///< the bytes before may hold the padding of a packet
+    int size_changed;
+#endif
+#if CONFIG_LIBURING
+    int use_io_uring;
+    int uring_depth;
+    int direct;
+
+    struct io_uring ring;
+    URingBuffer *bufs;
+    int nb_pending;
+    int buf_size;
+    int cur;            ///< buffer holding (read) or receiving (write) pos
+    int64_t pos;        ///< logical position in the file
+    int64_t submit_pos; ///< file offset of the next read-ahead request
+    int write_error;
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
@@ -108,6 +155,14 @@ static const AVOption file_options[] = {
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
     { "pkt_size", "Maximum packet size", offsetof(FileContext, pkt_size), AV_OPT_TYPE_INT, { .i64 = 262144 }, 1, INT_MAX, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+#if HAVE_MMAP
+    { "mmap", "map input files in memory and let demuxers reference packets without copying", offsetof(FileContext, use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+#endif
+#if CONFIG_LIBURING
+    { "io_uring", "use io_uring with queued read-ahead and asynchronous writes", offsetof(FileContext, use_io_uring), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_uring_depth", "number of pkt_size buffers in flight with io_uring", offsetof(FileContext, uring_depth), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, 256, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "direct", "bypass the page cache (O_DIRECT) when reading with io_uring", offsetof(FileContext, direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+#endif
     { NULL }
 };
 
@@ -138,11 +193,431 @@ static const AVClass fd_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if CONFIG_LIBURING
+static int uring_submit(FileContext *c, int idx, int write)
+{
+    URingBuffer *b = &c->bufs[idx];
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&c->ring);
+    int ret;
+
+    if (!sqe)
+        return AVERROR(EBUSY);
+    if (write)
+        io_uring_prep_write(sqe, c->fd, b->data + b->done, b->size - b->done, b->pos + b->done);
+    else
+        io_uring_prep_read(sqe, c->fd, b->data, b->size, b->pos);
+    io_uring_sqe_set_data(sqe, b);
+
+    ret = io_uring_submit(&c->ring);
+    if (ret < 0)
+        return AVERROR(-ret);
+    b->pending = 1;
+    b->write = write;
+    b->len = 0;
+    c->nb_pending++;
+    return 0;
+}
+
+/* Wait until buffer idx has completed, or until every request has
+ * completed if idx is negative. */
+static int uring_wait(FileContext *c, int idx)
+{
+    while (c->nb_pending && (idx < 0 || c->bufs[idx].pending)) {
+        struct io_uring_cqe *cqe;
+        URingBuffer *b;
+        int res, ret = io_uring_wait_cqe(&c->ring, &cqe);
+        if (ret == -EINTR)
+            continue;
+        if (ret < 0)
+            return AVERROR(-ret);
+        b = io_uring_cqe_get_data(cqe);
+        res = cqe->res;
+        b->pending = 0;
+        c->nb_pending--;
+        io_uring_cqe_seen(&c->ring, cqe);
+
+        /* Like write(), a request may write only part of the data */
+        if (b->write && res > 0 && b->done + res < b->size) {
+            b->done += res;
+            ret = uring_submit(c, b - c->bufs, 1);
+            if (ret < 0)
+                return ret;
+            continue;
+        }
+        b->len = res < 0 ? res : b->done + res;
+    }
+    return 0;
+}
+
+/* Queue read-ahead requests on every idle buffer, in file order
+ * starting from the current one. */
+static int uring_fill(FileContext *c)
+{
+    for (int i = 0; i < c->uring_depth; i++) {
+        int idx = (c->cur + i) % c->uring_depth;
+        URingBuffer *b = &c->bufs[idx];
+        int ret;
+
+        if (b->pending || b->pos >= 0)
+            continue;
+        b->pos  = c->submit_pos;
+        b->size = c->buf_size;
+        b->done = 0;
+        ret = uring_submit(c, idx, 0);
+        if (ret < 0)
+            return ret;
+        c->submit_pos += c->buf_size;
+    }
+    return 0;
+}
+
+static int uring_read(URLContext *h, unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    URingBuffer *b = &c->bufs[c->cur];
+    int64_t offset;
+    int ret;
+
+    ret = uring_fill(c);
+    if (ret < 0)
+        return ret;
+    ret = uring_wait(c, c->cur);
+    if (ret < 0)
+        return ret;
+    if (b->len < 0)
+        return AVERROR(-b->len);
+
+    offset = c->pos - b->pos;
+    if (offset >= b->len) {
+        /* A short read means the end of the file was reached, the data
+         * may still grow though, so keep the buffer for the next call */
+        if (b->len < b->size) {
+            c->submit_pos = c->pos & ~(int64_t)(URING_ALIGN - 1);
+            for (int i = 0; i < c->uring_depth; i++)
+                c->bufs[i].pos = -1;
+            ret = uring_wait(c, -1);
+            return ret < 0 ? ret : AVERROR_EOF;
+        }
+        b->pos = -1;
+        c->cur = (c->cur + 1) % c->uring_depth;
+        return uring_read(h, buf, size);
+    }
+
+    size = FFMIN(size, b->len - offset);
+    memcpy(buf, b->data + offset, size);
+    c->pos += size;
+    if (c->pos - b->pos == b->size) {
+        b->pos = -1;
+        c->cur = (c->cur + 1) % c->uring_depth;
+        ret = uring_fill(c);
+        if (ret < 0)
+            return ret;
+    }
+    return size;
+}
+
+/* Writes are copied into the next free buffer and completed in the
+ * background; errors are reported by a later write, seek or close. */
+static int uring_write(URLContext *h, const unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    URingBuffer *b = &c->bufs[c->cur];
+    int ret;
+
+    ret = uring_wait(c, c->cur);
+    if (ret < 0)
+        return ret;
+    if (b->pos >= 0 && b->len != b->size && !c->write_error)
+        c->write_error = b->len < 0 ? AVERROR(-b->len) : AVERROR(EIO);
+    if (c->write_error)
+        return c->write_error;
+
+    size = FFMIN(size, c->buf_size);
+    memcpy(b->data, buf, size);
+    b->pos  = c->pos;
+    b->size = size;
+    b->done = 0;
+    ret = uring_submit(c, c->cur, 1);
+    if (ret < 0)
+        return ret;
+    c->pos += size;
+    c->cur = (c->cur + 1) % c->uring_depth;
+    return size;
+}
+
+static int uring_drain(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    int ret = uring_wait(c, -1);
+    if (ret < 0)
+        return ret;
+
+    for (int i = 0; i < c->uring_depth; i++) {
+        URingBuffer *b = &c->bufs[i];
+        if ((h->flags & AVIO_FLAG_WRITE) && b->pos >= 0 &&
+            b->len != b->size && !c->write_error)
+            c->write_error = b->len < 0 ? AVERROR(-b->len) : AVERROR(EIO);
+        b->pos = -1;
+    }
+    return c->write_error;
+}
+
+static int64_t uring_seek(URLContext *h, int64_t pos, int whence)
+{
+    FileContext *c = h->priv_data;
+    int ret;
+
+    switch (whence) {
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        pos += c->pos;
+        break;
+    case SEEK_END: {
+        struct stat st;
+        /* Queued writes may still extend the file */
+        if (h->flags & AVIO_FLAG_WRITE) {
+            ret = uring_drain(h);
+            if (ret < 0)
+                return ret;
+        }
+        if (fstat(c->fd, &st) < 0)
+            return AVERROR(errno);
+        pos += st.st_size;
+        break;
+    }
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    if (!(h->flags & AVIO_FLAG_WRITE)) {
+        /* Seeking within the current buffer keeps the read-ahead */
+        URingBuffer *b = &c->bufs[c->cur];
+        if (b->pos >= 0 && !b->pending && b->len > 0 &&
+            pos >= b->pos && pos < b->pos + b->len) {
+            c->pos = pos;
+            return pos;
+        }
+    }
+
+    ret = uring_drain(h);
+    if (ret < 0)
+        return ret;
+    c->pos = pos;
+    c->submit_pos = pos & ~(int64_t)(URING_ALIGN - 1);
+    c->cur = 0;
+    return pos;
+}
+
+static void uring_free(FileContext *c)
+{
+    uring_wait(c, -1);
+    io_uring_queue_exit(&c->ring);
+    for (int i = 0; i < c->uring_depth; i++)
+        free(c->bufs[i].data);
+    av_freep(&c->bufs);
+}
+
+static int uring_init(URLContext *h, int flags)
+{
+    FileContext *c = h->priv_data;
+    int ret;
+
+    if ((flags & AVIO_FLAG_READ) && (flags & AVIO_FLAG_WRITE)) {
+        av_log(h, AV_LOG_WARNING, "io_uring is not supported in read-write mode\n");
+        return 0;
+    }
+    if (h->is_streamed || c->follow) {
+        av_log(h, AV_LOG_WARNING, "io_uring is not supported on pipes or with follow\n");
+        return 0;
+    }
+
+    ret = io_uring_queue_init(c->uring_depth, &c->ring, 0);
+    if (ret < 0) {
+        av_log(h, AV_LOG_WARNING, "io_uring initialization failed: %s, "
+               "falling back to blocking I/O\n", av_err2str(AVERROR(-ret)));
+        return 0;
+    }
+
+    c->bufs = av_calloc(c->uring_depth, sizeof(*c->bufs));
+    if (!c->bufs) {
+        io_uring_queue_exit(&c->ring);
+        return AVERROR(ENOMEM);
+    }
+    c->buf_size = FFALIGN(c->pkt_size, URING_ALIGN);
+    for (int i = 0; i < c->uring_depth; i++) {
+        c->bufs[i].pos = -1;
+        if (posix_memalign((void **)&c->bufs[i].data, URING_ALIGN, c->buf_size)) {
+            uring_free(c);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    c->pos = c->submit_pos = 0;
+    c->cur = 0;
+    h->min_packet_size = h->max_packet_size = c->buf_size;
+    return 0;
+}
+#endif
+
+#if HAVE_MMAP
+/* Mapping a range costs page faults, smaller packets are cheaper to copy. */
+#define MMAP_MIN_RANGE (64 * 1024)
+/* Packets are cut from private mappings of at least this size. */
+#define MMAP_WINDOW (16 * 1024 * 1024)
+
+static void mmap_unmap(void *opaque, uint8_t *data)
+{
+    munmap(data, (size_t)(uintptr_t)opaque);
+}
+
+static int mmap_init(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    struct stat st;
+    void *data;
+
+    if (fstat(c->fd, &st) < 0 || h->is_streamed || !S_ISREG(st.st_mode) ||
+        st.st_size <= 0 || st.st_size > SIZE_MAX) {
+        av_log(h, AV_LOG_VERBOSE, "Not mapping non-regular or empty file\n");
+        return 0;
+    }
+    c->page_size = sysconf(_SC_PAGESIZE);
+    if (c->page_size <= 0 || c->page_size & (c->page_size - 1))
+        return 0;
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (data == MAP_FAILED) {
+        av_log(h, AV_LOG_WARNING, "mmap failed: %s, using regular reads\n",
+               av_err2str(AVERROR(errno)));
+        return 0;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    c->mapping = av_buffer_create(data, st.st_size, mmap_unmap,
+                                  (void *)(uintptr_t)st.st_size,
+                                  AV_BUFFER_FLAG_READONLY);
+    if (!c->mapping) {
+        munmap(data, st.st_size);
+        return AVERROR(ENOMEM);
+    }
+    c->map_pos = 0;
+    return 0;
+}
+
+static int mmap_read(URLContext *h, unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+
+    if (c->map_pos >= c->mapping->size)
+        return AVERROR_EOF;
+    size = FFMIN(size, c->mapping->size - c->map_pos);
+    memcpy(buf, c->mapping->data + c->map_pos, size);
+    c->map_pos += size;
+    return size;
+}
+
+/* Map a private window starting at the page of pos and covering at least
+ * up to end. The file must still have the size it had when it was opened:
+ * once it changes, it may be truncated under the mapping, and the range is
+ * read instead. */
+static int mmap_window(URLContext *h, int64_t pos, int64_t end)
+{
+    FileContext *c = h->priv_data;
+    int64_t start = pos & ~(int64_t)(c->page_size - 1);
+    struct stat st;
+    uint8_t *data;
+    size_t len;
+
+    if (c->size_changed)
+        return AVERROR(ENOSYS);
+    if (fstat(c->fd, &st) < 0 || st.st_size != c->mapping->size) {
+        av_log(h, AV_LOG_WARNING, "File size changed, packets are no longer mapped\n");
+        c->size_changed = 1;
+        return AVERROR(ENOSYS);
+    }
+
+    len  = FFMIN(FFMAX(end - start, MMAP_WINDOW),
+                 FFALIGN((int64_t)c->mapping->size, c->page_size) - start);
+    data = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, c->fd, start);
+    if (data == MAP_FAILED)
+        return AVERROR(errno);
+
+    av_buffer_unref(&c->window);
+    c->window = av_buffer_create(data, len, mmap_unmap, (void *)(uintptr_t)len, 0);
+    if (!c->window) {
+        munmap(data, len);
+        return AVERROR(ENOMEM);
+    }
+    c->window_pos  = start;
+    c->window_next = pos;
+    return 0;
+}
+
+/* Return the range from a private window, so that its user may modify it,
+ * and zero the padding following it. The window is shared by the packets
+ * read in file order, as long as none starts in the padding of the previous
+ * one; the others get a new window. */
+static int file_map_range(URLContext *h, int64_t pos, int size, AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+    int64_t end;
+    AVBufferRef *ref;
+    int ret;
+
+    if (!c->mapping || size < MMAP_MIN_RANGE || pos < 0)
+        return AVERROR(ENOSYS);
+    /* Pages entirely past the end of the file cannot be accessed */
+    end = pos + size + AV_INPUT_BUFFER_PADDING_SIZE;
+    if (end > FFALIGN((int64_t)c->mapping->size, c->page_size))
+        return AVERROR(ENOSYS);
+
+    if (!c->window || pos < c->window_next ||
+        end > c->window_pos + (int64_t)c->window->size) {
+        ret = mmap_window(h, pos, end);
+        if (ret < 0)
+            return ret;
+    }
+
+    ref = av_buffer_ref(c->window);
+    if (!ref)
+        return AVERROR(ENOMEM);
+    ref->data += pos - c->window_pos;
+    ref->size  = size + AV_INPUT_BUFFER_PADDING_SIZE;
+    memset(ref->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    c->window_next = end;
+    *buf = ref;
+    return 0;
+}
+
+static int file_get_mapping(URLContext *h, AVBufferRef **mapping)
+{
+    FileContext *c = h->priv_data;
+
+    if (!c->mapping)
+        return AVERROR(ENOSYS);
+    *mapping = av_buffer_ref(c->mapping);
+    return *mapping ? 0 : AVERROR(ENOMEM);
+}
+#endif
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
+#if HAVE_MMAP
+    if (c->mapping)
+        return mmap_read(h, buf, size);
+#endif
     size = FFMIN(size, c->blocksize);
+#if CONFIG_LIBURING
+    if (c->bufs)
+        return uring_read(h, buf, size);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -155,6 +630,10 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
+#if CONFIG_LIBURING
+    if (c->bufs)
+        return uring_write(h, buf, FFMIN(size, c->blocksize));
+#endif
     size = FFMIN(size, c->blocksize);
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
@@ -223,7 +702,24 @@ static int fd_dup(URLContext *h, int oldfd)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret = close(c->fd);
+    int ret;
+#if CONFIG_LIBURING
+    int uring_ret = 0;
+    if (c->bufs) {
+        uring_ret = uring_drain(h);
+        uring_free(c);
+    }
+#endif
+#if HAVE_MMAP
+    /* Packets may still reference the mappings after the file is closed */
+    av_buffer_unref(&c->mapping);
+    av_buffer_unref(&c->window);
+#endif
+    ret = close(c->fd);
+#if CONFIG_LIBURING
+    if (uring_ret < 0 && ret != -1)
+        return uring_ret;
+#endif
     return (ret == -1) ? AVERROR(errno) : 0;
 }
 
@@ -235,10 +731,34 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 
     if (whence == AVSEEK_SIZE) {
         struct stat st;
+#if CONFIG_LIBURING
+        if (c->bufs && (h->flags & AVIO_FLAG_WRITE)) {
+            ret = uring_drain(h);
+            if (ret < 0)
+                return ret;
+        }
+#endif
         ret = fstat(c->fd, &st);
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+#if HAVE_MMAP
+    if (c->mapping) {
+        if (whence == SEEK_CUR)
+            pos += c->map_pos;
+        else if (whence == SEEK_END)
+            pos += c->mapping->size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->map_pos = pos;
+    }
+#endif
+#if CONFIG_LIBURING
+    if (c->bufs)
+        return uring_seek(h, pos, whence);
+#endif
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -304,8 +824,19 @@ static int file_open(URLContext *h, const char *filename, int flags)
     }
 #ifdef O_BINARY
     access |= O_BINARY;
+#endif
+#if CONFIG_LIBURING && defined(O_DIRECT)
+    if (c->use_io_uring && c->direct && access == O_RDONLY)
+        access |= O_DIRECT;
 #endif
     fd = avpriv_open(filename, access, 0666);
+#if CONFIG_LIBURING && defined(O_DIRECT)
+    /* tmpfs and some FUSE file systems refuse O_DIRECT */
+    if (fd == -1 && errno == EINVAL && (access & O_DIRECT)) {
+        av_log(h, AV_LOG_VERBOSE, "O_DIRECT is not supported, using the page cache\n");
+        fd = avpriv_open(filename, access & ~O_DIRECT, 0666);
+    }
+#endif
     if (fd == -1)
         return AVERROR(errno);
     c->fd = fd;
@@ -320,6 +851,27 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE)) {
+        int ret = mmap_init(h);
+        if (ret < 0) {
+            close(fd);
+            return ret;
+        }
+        if (c->mapping)
+            return 0;
+    }
+#endif
+#if CONFIG_LIBURING
+    if (c->use_io_uring) {
+        int ret = uring_init(h, flags);
+        if (ret < 0) {
+            close(fd);
+            return ret;
+        }
+    }
+#endif
+
     return 0;
 }
 
@@ -418,6 +970,10 @@ const URLProtocol ff_file_protocol = {
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
+#if HAVE_MMAP
+    .url_get_mapping     = file_get_mapping,
+    .url_map_range       = file_map_range,
+#endif
     .priv_data_size      = sizeof(FileContext),
     .priv_data_class     = &file_class,
     .url_open_dir        = file_open_dir,
@@ -21,8 +21,10 @@
  * Haivision Open SRT (Secure Reliable Transport) protocol
  */
 
+#include <float.h>
 #include <srt/srt.h>
 
+#include "libavutil/avstring.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
@@ -45,12 +47,27 @@
 #define SRT_LIVE_MAX_PAYLOAD_SIZE 1456
 #endif
 
+/* Socket groups (connection bonding) are available since SRT 1.5.0 */
+#if SRT_VERSION_VALUE >= 0x010500
+#define SRT_HAVE_GROUPS 1
+#else
+#define SRT_HAVE_GROUPS 0
+#endif
+
+#define SRT_MAX_LINKS 16
+
 enum SRTMode {
     SRT_MODE_CALLER = 0,
     SRT_MODE_LISTENER = 1,
     SRT_MODE_RENDEZVOUS = 2
 };
 
+enum SRTGroupType {
+    SRT_GROUP_NONE = 0,
+    SRT_GROUP_BROADCAST = 1,
+    SRT_GROUP_BACKUP = 2
+};
+
 typedef struct SRTContext {
     const AVClass *class;
     int fd;
@@ -93,10 +110,30 @@ typedef struct SRTContext {
     SRT_TRANSTYPE transtype;
     int linger;
     int tsbpd;
+
+    enum SRTGroupType group_type;
+    char *links;
+    int groupconnect;
+    int is_group;
+
+    int64_t stats_period;
+    int64_t last_stats_time;
+    /* Exported statistics. For a group, the counters and rates are summed over
+     * the connected links, rtt is the lowest and buffer_ms the highest value. */
+    double rtt;
+    double bandwidth;
+    double send_rate;
+    double recv_rate;
+    int64_t pkt_loss;
+    int64_t pkt_retrans;
+    int64_t pkt_drop;
+    int buffer_ms;
+    int links_active;
 } SRTContext;
 
 #define D AV_OPT_FLAG_DECODING_PARAM
 #define E AV_OPT_FLAG_ENCODING_PARAM
+#define X AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY
 #define OFFSET(x) offsetof(SRTContext, x)
 static const AVOption libsrt_options[] = {
     { "timeout",        "Timeout of socket I/O operations (in microseconds)",                   OFFSET(rw_timeout),       AV_OPT_TYPE_INT64, { .i64 = -1 }, -1, INT64_MAX, .flags = D|E },
@@ -146,6 +183,22 @@ static const AVOption libsrt_options[] = {
     { "file",           NULL, 0, AV_OPT_TYPE_CONST,  { .i64 = SRTT_FILE }, INT_MIN, INT_MAX, .flags = D|E, .unit = "transtype" },
     { "linger",         "Number of seconds that the socket waits for unsent data when closing", OFFSET(linger),           AV_OPT_TYPE_INT,      { .i64 = -1 }, -1, INT_MAX,   .flags = D|E },
     { "tsbpd",          "Timestamp-based packet delivery",                                      OFFSET(tsbpd),            AV_OPT_TYPE_BOOL,     { .i64 = -1 }, -1, 1,         .flags = D|E },
+    { "group_type",     "Socket group type used to bond several links (caller mode)",          OFFSET(group_type),       AV_OPT_TYPE_INT,      { .i64 = SRT_GROUP_NONE }, SRT_GROUP_NONE, SRT_GROUP_BACKUP, .flags = D|E, .unit = "group_type" },
+    { "none",           NULL, 0, AV_OPT_TYPE_CONST,  { .i64 = SRT_GROUP_NONE },      INT_MIN, INT_MAX, .flags = D|E, .unit = "group_type" },
+    { "broadcast",      NULL, 0, AV_OPT_TYPE_CONST,  { .i64 = SRT_GROUP_BROADCAST }, INT_MIN, INT_MAX, .flags = D|E, .unit = "group_type" },
+    { "backup",         NULL, 0, AV_OPT_TYPE_CONST,  { .i64 = SRT_GROUP_BACKUP },    INT_MIN, INT_MAX, .flags = D|E, .unit = "group_type" },
+    { "links",          "Additional comma-separated host:port endpoints of the group",         OFFSET(links),            AV_OPT_TYPE_STRING,   { .str = NULL },              .flags = D|E },
+    { "groupconnect",   "Accept group connections (listener mode)",                             OFFSET(groupconnect),     AV_OPT_TYPE_BOOL,     { .i64 = 0 },  0, 1,         .flags = D|E },
+    { "stats_period",   "Interval between statistics updates (in microseconds), 0 disables",   OFFSET(stats_period),     AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = D|E },
+    { "rtt",            "Smoothed round trip time (in milliseconds)",                           OFFSET(rtt),              AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = X },
+    { "bandwidth",      "Estimated link bandwidth (in Mbit/s)",                                 OFFSET(bandwidth),        AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = X },
+    { "send_rate",      "Sending rate (in Mbit/s)",                                             OFFSET(send_rate),        AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = X },
+    { "recv_rate",      "Receiving rate (in Mbit/s)",                                           OFFSET(recv_rate),        AV_OPT_TYPE_DOUBLE,   { .dbl = 0 },  0, DBL_MAX,   .flags = X },
+    { "pkt_loss",       "Total number of lost packets",                                         OFFSET(pkt_loss),         AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "pkt_retrans",    "Total number of retransmitted packets",                                OFFSET(pkt_retrans),      AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "pkt_drop",       "Total number of packets dropped as too late",                          OFFSET(pkt_drop),         AV_OPT_TYPE_INT64,    { .i64 = 0 },  0, INT64_MAX, .flags = X },
+    { "buffer_ms",      "Timespan of the data held in the send or receive buffer (in milliseconds)", OFFSET(buffer_ms), AV_OPT_TYPE_INT,     { .i64 = 0 },  0, INT_MAX,   .flags = X },
+    { "links_active",   "Number of connected links",                                            OFFSET(links_active),     AV_OPT_TYPE_INT,      { .i64 = 0 },  0, INT_MAX,   .flags = X },
     { NULL }
 };
 
@@ -168,6 +221,15 @@ static int libsrt_getsockopt(URLContext *h, int fd, SRT_SOCKOPT optname, const c
     return 0;
 }
 
+static int libsrt_setsockopt(URLContext *h, int fd, SRT_SOCKOPT optname, const char * optnamestr, const void * optval, int optlen)
+{
+    if (srt_setsockopt(fd, 0, optname, optval, optlen) < 0) {
+        av_log(h, AV_LOG_ERROR, "failed to set option %s on socket: %s\n", optnamestr, srt_getlasterror_str());
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
 static int libsrt_socket_nonblock(int socket, int enable)
 {
     int ret, blocking = enable ? 0 : 1;
@@ -288,15 +350,6 @@ static int libsrt_listen_connect(int eid, int fd, const struct sockaddr *addr, s
     return ret;
 }
 
-static int libsrt_setsockopt(URLContext *h, int fd, SRT_SOCKOPT optname, const char * optnamestr, const void * optval, int optlen)
-{
-    if (srt_setsockopt(fd, 0, optname, optval, optlen) < 0) {
-        av_log(h, AV_LOG_ERROR, "failed to set option %s on socket: %s\n", optnamestr, srt_getlasterror_str());
-        return AVERROR(EIO);
-    }
-    return 0;
-}
-
 /* - The "POST" options can be altered any time on a connected socket.
      They MAY have also some meaning when set prior to connecting; such
      option is SRTO_RCVSYN, which makes connect/accept call asynchronous.
@@ -449,6 +502,13 @@ static int libsrt_setup(URLContext *h, const char *uri, int flags)
         int read_eid = ret = libsrt_epoll_create(h, fd, 0);
         if (ret < 0)
             goto fail1;
+#if SRT_HAVE_GROUPS
+        if (s->groupconnect &&
+            (ret = libsrt_setsockopt(h, fd, SRTO_GROUPCONNECT, "SRTO_GROUPCONNECT", &s->groupconnect, sizeof(s->groupconnect))) < 0) {
+            srt_epoll_release(read_eid);
+            goto fail1;
+        }
+#endif
         // multi-client
         ret = libsrt_listen(read_eid, fd, cur_ai->ai_addr, cur_ai->ai_addrlen, h, s->listen_timeout);
         srt_epoll_release(read_eid);
@@ -456,6 +516,12 @@ static int libsrt_setup(URLContext *h, const char *uri, int flags)
             goto fail1;
         srt_close(fd);
         fd = ret;
+#if SRT_HAVE_GROUPS
+        /* With groupconnect the accepted id refers to the whole group */
+        s->is_group = !!(fd & SRTGROUP_MASK);
+        if (s->is_group)
+            av_log(h, AV_LOG_VERBOSE, "accepted group connection\n");
+#endif
     } else {
         int write_eid = ret = libsrt_epoll_create(h, fd, 1);
         if (ret < 0)
@@ -519,6 +585,224 @@ static int libsrt_setup(URLContext *h, const char *uri, int flags)
     return ret;
 }
 
+#if SRT_HAVE_GROUPS
+static int libsrt_prepare_link(URLContext *h, SRT_SOCKGROUPCONFIG *link,
+                               const char *hostname, int port)
+{
+    struct addrinfo hints = { 0 }, *ai;
+    char portstr[10];
+    int ret;
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    snprintf(portstr, sizeof(portstr), "%d", port);
+    ret = getaddrinfo(hostname, portstr, &hints, &ai);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR,
+               "Failed to resolve hostname %s: %s\n",
+               hostname, gai_strerror(ret));
+        return AVERROR(EIO);
+    }
+    *link = srt_prepare_endpoint(NULL, ai->ai_addr, ai->ai_addrlen);
+    freeaddrinfo(ai);
+    return 0;
+}
+
+/* Connect a broadcast or backup group to the URL endpoint and all
+ * endpoints listed in the links option. */
+static int libsrt_setup_group(URLContext *h, const char *uri, int flags)
+{
+    SRTContext *s = h->priv_data;
+    SRT_SOCKGROUPCONFIG targets[SRT_MAX_LINKS];
+    char hostname[1024], proto[1024], path[1024];
+    const char *p = s->links;
+    int64_t open_timeout = 0;
+    int port, grp, eid, ret, nb_targets = 0;
+
+    av_url_split(proto, sizeof(proto), NULL, 0, hostname, sizeof(hostname),
+        &port, path, sizeof(path), uri);
+    if (strcmp(proto, "srt"))
+        return AVERROR(EINVAL);
+    if (port <= 0 || port >= 65536) {
+        av_log(h, AV_LOG_ERROR, "Port missing in uri\n");
+        return AVERROR(EINVAL);
+    }
+    if (s->mode != SRT_MODE_CALLER) {
+        av_log(h, AV_LOG_ERROR, "Socket groups require caller mode, "
+               "use groupconnect on the listener side\n");
+        return AVERROR(EINVAL);
+    }
+    if (s->rw_timeout >= 0)
+        open_timeout = h->rw_timeout = s->rw_timeout;
+
+    ret = libsrt_prepare_link(h, &targets[nb_targets++], hostname, port);
+    if (ret < 0)
+        return ret;
+
+    while (p && *p) {
+        char *link = av_get_token(&p, ",");
+        char *sep;
+
+        if (!link)
+            return AVERROR(ENOMEM);
+        if (*p)
+            p++;
+        sep = strrchr(link, ':');
+        if (!sep || nb_targets >= SRT_MAX_LINKS) {
+            av_log(h, AV_LOG_ERROR, "Invalid or too many links: '%s'\n", link);
+            av_free(link);
+            return AVERROR(EINVAL);
+        }
+        *sep = 0;
+        port = strtol(sep + 1, NULL, 10);
+        if (port <= 0 || port >= 65536) {
+            av_log(h, AV_LOG_ERROR, "Invalid port for link '%s'\n", link);
+            av_free(link);
+            return AVERROR(EINVAL);
+        }
+        /* Strip the brackets of IPv6 addresses */
+        if (link[0] == '[' && sep[-1] == ']') {
+            sep[-1] = 0;
+            ret = libsrt_prepare_link(h, &targets[nb_targets++], link + 1, port);
+        } else {
+            ret = libsrt_prepare_link(h, &targets[nb_targets++], link, port);
+        }
+        av_free(link);
+        if (ret < 0)
+            return ret;
+    }
+
+    grp = srt_create_group(s->group_type == SRT_GROUP_BACKUP ? SRT_GTYPE_BACKUP
+                                                            : SRT_GTYPE_BROADCAST);
+    if (grp < 0)
+        return libsrt_neterrno(h);
+
+    if ((ret = libsrt_set_options_pre(h, grp)) < 0)
+        goto fail;
+    if (libsrt_socket_nonblock(grp, 1) < 0)
+        av_log(h, AV_LOG_DEBUG, "libsrt_socket_nonblock failed\n");
+
+    ret = eid = libsrt_epoll_create(h, grp, 1);
+    if (ret < 0)
+        goto fail;
+    if (srt_connect_group(grp, targets, nb_targets) < 0 &&
+        srt_getlasterror(NULL) != SRT_EASYNCRCV) {
+        ret = libsrt_neterrno(h);
+        srt_epoll_release(eid);
+        goto fail;
+    }
+    /* The group becomes writable as soon as one of its links is connected */
+    ret = libsrt_network_wait_fd_timeout(h, eid, 1, open_timeout, &h->interrupt_callback);
+    srt_epoll_release(eid);
+    if (ret < 0) {
+        av_log(h, AV_LOG_ERROR, "Connection of group to %s failed: %s\n",
+               h->filename, av_err2str(ret));
+        goto fail;
+    }
+    av_log(h, AV_LOG_VERBOSE, "Connected %s group of %d links\n",
+           s->group_type == SRT_GROUP_BACKUP ? "backup" : "broadcast", nb_targets);
+
+    if ((ret = libsrt_set_options_post(h, grp)) < 0)
+        goto fail;
+
+    if (flags & AVIO_FLAG_WRITE) {
+        int packet_size = 0;
+        int optlen = sizeof(packet_size);
+        if (!libsrt_getsockopt(h, grp, SRTO_PAYLOADSIZE, "SRTO_PAYLOADSIZE", &packet_size, &optlen) &&
+            packet_size > 0)
+            h->max_packet_size = packet_size;
+    }
+
+    ret = eid = libsrt_epoll_create(h, grp, flags & AVIO_FLAG_WRITE);
+    if (ret < 0)
+        goto fail;
+
+    h->is_streamed = 1;
+    s->fd = grp;
+    s->eid = eid;
+    s->is_group = 1;
+    return 0;
+
+fail:
+    srt_close(grp);
+    return ret;
+}
+#endif
+
+static void libsrt_add_link_stats(SRTContext *s, const SRT_TRACEBSTATS *perf, int write)
+{
+    s->rtt          = s->links_active ? FFMIN(s->rtt, perf->msRTT) : perf->msRTT;
+    s->bandwidth   += perf->mbpsBandwidth;
+    s->send_rate   += perf->mbpsSendRate;
+    s->recv_rate   += perf->mbpsRecvRate;
+    s->pkt_retrans += perf->pktRetransTotal;
+    if (write) {
+        s->pkt_loss  += perf->pktSndLossTotal;
+        s->pkt_drop  += perf->pktSndDropTotal;
+        s->buffer_ms  = FFMAX(s->buffer_ms, perf->msSndBuf);
+    } else {
+        s->pkt_loss  += perf->pktRcvLossTotal;
+        s->pkt_drop  += perf->pktRcvDropTotal;
+        s->buffer_ms  = FFMAX(s->buffer_ms, perf->msRcvBuf);
+    }
+    s->links_active++;
+}
+
+static void libsrt_log_link_stats(URLContext *h, int id, const SRT_TRACEBSTATS *perf)
+{
+    av_log(h, AV_LOG_VERBOSE,
+           "link %d: rtt %.2f ms, bw %.2f Mbit/s, send %.2f Mbit/s, recv %.2f Mbit/s, "
+           "loss %d/%d, retrans %d, drop %d/%d, buffer %d/%d ms, flight %d\n",
+           id, perf->msRTT, perf->mbpsBandwidth, perf->mbpsSendRate, perf->mbpsRecvRate,
+           perf->pktSndLossTotal, perf->pktRcvLossTotal, perf->pktRetransTotal,
+           perf->pktSndDropTotal, perf->pktRcvDropTotal,
+           perf->msSndBuf, perf->msRcvBuf, perf->pktFlightSize);
+}
+
+/* Refresh the exported statistics of the connection (or of every member
+ * of the group) at most once per stats_period. */
+static void libsrt_update_stats(URLContext *h)
+{
+    SRTContext *s = h->priv_data;
+    int write = h->flags & AVIO_FLAG_WRITE;
+    SRT_TRACEBSTATS perf;
+    int64_t now = av_gettime_relative();
+
+    if (now - s->last_stats_time < s->stats_period)
+        return;
+    s->last_stats_time = now;
+
+    s->rtt = s->bandwidth = s->send_rate = s->recv_rate = 0;
+    s->pkt_loss = s->pkt_retrans = s->pkt_drop = 0;
+    s->buffer_ms = s->links_active = 0;
+
+#if SRT_HAVE_GROUPS
+    if (s->is_group) {
+        SRT_SOCKGROUPDATA members[SRT_MAX_LINKS];
+        size_t nb_members = FF_ARRAY_ELEMS(members);
+
+        if (srt_group_data(s->fd, members, &nb_members) < 0) {
+            av_log(h, AV_LOG_WARNING, "failed to get group data: %s\n", srt_getlasterror_str());
+            return;
+        }
+        for (size_t i = 0; i < nb_members; i++) {
+            if (members[i].sockstate != SRTS_CONNECTED ||
+                srt_bstats(members[i].id, &perf, 0) < 0)
+                continue;
+            libsrt_log_link_stats(h, i, &perf);
+            libsrt_add_link_stats(s, &perf, write);
+        }
+        return;
+    }
+#endif
+    if (srt_bstats(s->fd, &perf, 0) < 0) {
+        av_log(h, AV_LOG_WARNING, "failed to get statistics: %s\n", srt_getlasterror_str());
+        return;
+    }
+    libsrt_log_link_stats(h, 0, &perf);
+    libsrt_add_link_stats(s, &perf, write);
+}
+
 static int libsrt_open(URLContext *h, const char *uri, int flags)
 {
     SRTContext *s = h->priv_data;
@@ -536,7 +820,16 @@ static int libsrt_open(URLContext *h, const char *uri, int flags)
         if (ret < 0)
             goto err;
     }
-    ret = libsrt_setup(h, uri, flags);
+    if (s->group_type != SRT_GROUP_NONE) {
+#if SRT_HAVE_GROUPS
+        ret = libsrt_setup_group(h, uri, flags);
+#else
+        av_log(h, AV_LOG_ERROR, "Socket groups require libsrt 1.5.0 or newer\n");
+        ret = AVERROR(ENOSYS);
+#endif
+    } else {
+        ret = libsrt_setup(h, uri, flags);
+    }
     if (ret < 0)
         goto err;
     return 0;
@@ -562,6 +855,9 @@ static int libsrt_read(URLContext *h, uint8_t *buf, int size)
         ret = libsrt_neterrno(h);
     }
 
+    if (s->stats_period)
+        libsrt_update_stats(h);
+
     return ret;
 }
 
@@ -581,6 +877,9 @@ static int libsrt_write(URLContext *h, const uint8_t *buf, int size)
         ret = libsrt_neterrno(h);
     }
 
+    if (s->stats_period)
+        libsrt_update_stats(h);
+
     return ret;
 }
 
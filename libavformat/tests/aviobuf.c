@@ -0,0 +1,108 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/avio.h"
+#include "libavformat/avio_internal.h"
+
+/* long enough for a few measurement windows of adaptive buffering */
+#define DURATION 500000
+
+typedef struct Source {
+    const char *name;
+    int buffer_size;    ///< initial buffer size
+    int max_read;       ///< largest read returned, 0 for unlimited
+    int delay;          ///< microseconds spent in each read
+    int64_t pos;
+} Source;
+
+static int read_source(void *opaque, uint8_t *buf, int size)
+{
+    Source *src = opaque;
+
+    if (src->max_read)
+        size = FFMIN(size, src->max_read);
+    for (int i = 0; i < size; i++)
+        buf[i] = (src->pos + i) % 251;
+    src->pos += size;
+    if (src->delay)
+        av_usleep(src->delay);
+    return size;
+}
+
+/* Read the source for DURATION, checking that no data is lost or
+ * reordered when the buffer is resized. */
+static int run_test(Source *src)
+{
+    AVIOContext *pb;
+    FFIOContext *ctx;
+    uint8_t *buffer = av_malloc(src->buffer_size);
+    uint8_t buf[1000];
+    int64_t pos = 0, start;
+    int ok = 1;
+
+    if (!buffer)
+        return AVERROR(ENOMEM);
+    pb = avio_alloc_context(buffer, src->buffer_size, 0, src, read_source, NULL, NULL);
+    if (!pb) {
+        av_free(buffer);
+        return AVERROR(ENOMEM);
+    }
+    ctx = ffiocontext(pb);
+    ctx->adaptive_min_size = 4096;
+    ctx->adaptive_max_size = 65536;
+
+    start = av_gettime_relative();
+    while (ok && av_gettime_relative() - start < DURATION) {
+        int len = avio_read(pb, buf, sizeof(buf));
+        if (len != sizeof(buf))
+            ok = 0;
+        for (int i = 0; ok && i < len; i++)
+            ok = buf[i] == (pos + i) % 251;
+        pos += len;
+    }
+
+    printf("%s: buffer size %d -> %d, data %s\n", src->name, src->buffer_size,
+           pb->buffer_size, ok ? "ok" : "corrupted");
+    av_freep(&pb->buffer);
+    avio_context_free(&pb);
+    return ok ? 0 : AVERROR_INVALIDDATA;
+}
+
+int main(void)
+{
+    Source sources[] = {
+        /* fast reads grow the buffer to the maximum */
+        { "fast",        4096                },
+        /* 64 KB/s: 640 bytes cover 10 ms, the minimum is used once the
+         * buffer has been consumed and is refilled from its start */
+        { "slow",        16384, 128,  2000   },
+        /* a fast protocol returning short reads does not get a larger buffer */
+        { "short reads", 4096,  1000         },
+    };
+    int ret = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(sources); i++)
+        if (run_test(&sources[i]) < 0)
+            ret = 1;
+    return ret;
+}
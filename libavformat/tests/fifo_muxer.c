@@ -315,6 +315,8 @@ typedef struct TestCase {
 
 #define BUFFER_SIZE 64
 
+static const char *timeshift_dir = ".";
+
 static int run_test(const TestCase *test)
 {
     AVDictionary *opts = NULL;
@@ -337,6 +339,13 @@ static int run_test(const TestCase *test)
         }
     }
 
+    /* The timeshift buffer is stored in the directory given to the test */
+    if (av_dict_get(opts, "timeshift", NULL, 0) &&
+        (ret = av_dict_set(&opts, "timeshift_dir", timeshift_dir, 0)) < 0) {
+        fprintf(stderr, "Failed to set the timeshift directory: %s\n", av_err2str(ret));
+        goto end;
+    }
+
     snprintf(buffer, BUFFER_SIZE,
              "print_deinit_summary=%d:write_header_ret=%d:write_trailer_ret=%d",
              (int)test->print_summary_on_deinit, test->write_header_ret,
@@ -385,6 +394,12 @@ const TestCase tests[] = {
         {fifo_overflow_drop_test, "overflow with packet dropping", "queue_size=3:drop_pkts_on_overflow=1",
          0, 0, 0, {0, 0, SLEEPTIME_50_MS}},
 
+        /* Timeshift buffer stored on disk with segments small enough to hold
+         * only a few packets each, all packets should come back in order. */
+        {fifo_basic_test, "timeshift spooled to disk",
+         "timeshift=0.01:timeshift_segment_size=40",
+         1, 0, 0, {0, 0, 0}},
+
         {NULL}
 };
 
@@ -392,6 +407,9 @@ int main(int argc, char *argv[])
 {
     int i, ret, ret_all = 0;
 
+    if (argc > 1)
+        timeshift_dir = argv[1];
+
     for (i = 0; tests[i].test_func; i++) {
         ret = run_test(&tests[i]);
         if (!ret_all && ret < 0)
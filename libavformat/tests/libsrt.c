@@ -0,0 +1,141 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <srt/srt.h>
+
+#include "libavutil/error.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/opt.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "libavformat/avio.h"
+#include "libavformat/url.h"
+
+#define NB_PACKETS  100
+#define PACKET_SIZE 1316
+
+/* A broadcast group of two links to the same listener. Without group
+ * support in libsrt a single connection is tested instead. */
+#if SRT_VERSION_VALUE >= 0x010500
+#define NB_LINKS 2
+#define CALLER_OPTS "group_type=broadcast&links=127.0.0.1:%d&"
+#else
+#define NB_LINKS 1
+#define CALLER_OPTS ""
+#endif
+
+typedef struct Receiver {
+    char url[256];
+    int nb_packets;
+    int ret;
+} Receiver;
+
+/* Packets starting with 'w' are sent until every link is up, 'n' packets
+ * carry a sequence number and 'e' ends the transfer. */
+static void *receive_packets(void *arg)
+{
+    Receiver *r = arg;
+    URLContext *uc = NULL;
+    uint8_t buf[PACKET_SIZE];
+    int ret;
+
+    ret = ffurl_open_whitelist(&uc, r->url, AVIO_FLAG_READ, NULL, NULL, NULL, NULL, NULL);
+    while (ret >= 0) {
+        ret = ffurl_read(uc, buf, sizeof(buf));
+        if (ret < 0 || buf[0] == 'w')
+            continue;
+        if (buf[0] == 'e') {
+            ret = 0;
+            break;
+        }
+        if (ret != PACKET_SIZE || buf[0] != 'n' || AV_RB16(buf + 1) != r->nb_packets) {
+            ret = AVERROR_INVALIDDATA;
+            break;
+        }
+        r->nb_packets++;
+    }
+    ffurl_closep(&uc);
+    r->ret = ret;
+    return NULL;
+}
+
+static int send_packet(URLContext *uc, uint8_t type, int seq)
+{
+    uint8_t buf[PACKET_SIZE];
+
+    memset(buf, seq, sizeof(buf));
+    buf[0] = type;
+    AV_WB16(buf + 1, seq);
+    return ffurl_write(uc, buf, sizeof(buf));
+}
+
+int main(int argc, char **argv)
+{
+    const int port = argc > 1 ? strtol(argv[1], NULL, 10) : 23451;
+    Receiver receiver = { 0 };
+    URLContext *uc = NULL;
+    pthread_t thread;
+    char url[256];
+    int64_t links = 0;
+    int ret;
+
+    snprintf(receiver.url, sizeof(receiver.url),
+             "srt://127.0.0.1:%d?mode=listener&groupconnect=1&listen_timeout=5000000&timeout=5000000",
+             port);
+    snprintf(url, sizeof(url), "srt://127.0.0.1:%d?" CALLER_OPTS "stats_period=1", port, port);
+
+    if ((ret = pthread_create(&thread, NULL, receive_packets, &receiver))) {
+        fprintf(stderr, "Failed to start the receiver: %s\n", av_err2str(AVERROR(ret)));
+        return 1;
+    }
+
+    /* the listener may not be ready yet */
+    for (int i = 0; i < 50; i++) {
+        ret = ffurl_open_whitelist(&uc, url, AVIO_FLAG_WRITE, NULL, NULL, NULL, NULL, NULL);
+        if (ret >= 0)
+            break;
+        av_usleep(100000);
+    }
+    /* the statistics are updated on each write */
+    for (int i = 0; ret >= 0 && links < NB_LINKS && i < 500; i++) {
+        ret = send_packet(uc, 'w', i);
+        if (ret >= 0)
+            ret = av_opt_get_int(uc, "links_active", AV_OPT_SEARCH_CHILDREN, &links);
+        av_usleep(10000);
+    }
+    for (int i = 0; ret >= 0 && i < NB_PACKETS; i++)
+        ret = send_packet(uc, 'n', i);
+    if (ret >= 0)
+        ret = send_packet(uc, 'e', 0);
+    if (ret < 0)
+        fprintf(stderr, "Failed to send: %s\n", av_err2str(ret));
+
+    /* the pending packets are dropped when the sender is closed */
+    pthread_join(thread, NULL);
+    ffurl_closep(&uc);
+
+    if (receiver.ret < 0)
+        fprintf(stderr, "Failed to receive: %s\n", av_err2str(receiver.ret));
+    printf("all links active: %s\n", links == NB_LINKS ? "yes" : "no");
+    printf("packets received in order: %d\n", receiver.nb_packets);
+    return ret < 0 || receiver.ret < 0;
+}
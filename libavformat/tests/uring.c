@@ -0,0 +1,122 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavformat/avio.h"
+#include "libavformat/url.h"
+
+/* not a multiple of the buffer size, to end with a short read */
+#define FILE_SIZE (300 * 1024 + 123)
+
+static uint8_t data[FILE_SIZE];
+static uint8_t buf[FILE_SIZE];
+
+static int open_file(AVIOContext **pb, const char *filename, int flags, const char *options)
+{
+    AVDictionary *opts = NULL;
+    int ret = av_dict_parse_string(&opts, options, "=", ":", 0);
+    if (ret >= 0)
+        ret = avio_open2(pb, filename, flags, NULL, &opts);
+    av_dict_free(&opts);
+    return ret;
+}
+
+/* Write the file in chunks of various sizes and check its size. */
+static int write_file(const char *filename, const char *options)
+{
+    AVIOContext *pb;
+    int64_t size;
+    int ret = open_file(&pb, filename, AVIO_FLAG_WRITE, options);
+    if (ret < 0)
+        return ret;
+
+    for (int pos = 0, len = 1; pos < FILE_SIZE; pos += len, len = len * 7 % 40000 + 1)
+        avio_write(pb, data + pos, FFMIN(len, FILE_SIZE - pos));
+    avio_flush(pb);
+    size = avio_size(pb);
+    if (!pb->error && size != FILE_SIZE)
+        pb->error = AVERROR_INVALIDDATA;
+    ret = pb->error;
+    avio_closep(&pb);
+    return ret;
+}
+
+/* Read the whole file, then ranges starting at various positions. */
+static int read_file(const char *filename, const char *options)
+{
+    static const int64_t positions[] = { 0, 4095, 4096, 200000, FILE_SIZE - 10, 17 };
+    AVIOContext *pb;
+    int ret = open_file(&pb, filename, AVIO_FLAG_READ, options);
+    if (ret < 0)
+        return ret;
+
+    ret = avio_read(pb, buf, FILE_SIZE + 1);
+    if (ret >= 0 && (ret != FILE_SIZE || memcmp(buf, data, FILE_SIZE)))
+        ret = AVERROR_INVALIDDATA;
+
+    for (int i = 0; ret >= 0 && i < FF_ARRAY_ELEMS(positions); i++) {
+        const int64_t pos = positions[i];
+        const int len = FFMIN(FILE_SIZE - pos, 50000);
+
+        ret = avio_seek(pb, pos, SEEK_SET);
+        if (ret >= 0)
+            ret = avio_read(pb, buf, len);
+        if (ret >= 0 && (ret != len || memcmp(buf, data + pos, len)))
+            ret = AVERROR_INVALIDDATA;
+    }
+    avio_closep(&pb);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        const char *write_opts, *read_opts;
+    } tests[] = {
+        { "defaults",       "io_uring=1",                          "io_uring=1"                     },
+        { "small buffers",  "io_uring=1:pkt_size=4096:io_uring_depth=3",
+                            "io_uring=1:pkt_size=4096:io_uring_depth=3"                             },
+        { "blocksize",      "io_uring=1:blocksize=1000",           "io_uring=1:blocksize=1000"      },
+        { "direct",         "io_uring=1",                          "io_uring=1:direct=1"            },
+        { "mixed",          "",                                    "io_uring=1:pkt_size=10000"      },
+    };
+    char filename[1024];
+    int ret = 0;
+
+    snprintf(filename, sizeof(filename), "%s/uring.tmp", argc > 1 ? argv[1] : ".");
+    for (int i = 0; i < FILE_SIZE; i++)
+        data[i] = i * 29 + (i >> 11);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        int ret1 = write_file(filename, tests[i].write_opts);
+        int ret2 = ret1 < 0 ? ret1 : read_file(filename, tests[i].read_opts);
+
+        printf("%s: %s\n", tests[i].name, ret2 < 0 ? av_err2str(ret2) : "ok");
+        if (ret2 < 0)
+            ret = 1;
+    }
+    ffurl_delete(filename);
+    return ret;
+}
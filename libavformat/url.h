@@ -26,6 +26,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -46,6 +47,9 @@ typedef struct URLContext {
     const char *protocol_whitelist;
     const char *protocol_blacklist;
     int min_packet_size;        /**< if non zero, the stream is packetized with this min packet size */
+    int adaptive_buffer;        /**< adapt the AVIOContext buffer size to the read throughput */
+    int adaptive_buffer_min;
+    int adaptive_buffer_max;
 } URLContext;
 
 typedef struct URLProtocol {
@@ -83,6 +87,8 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    int (*url_get_mapping)(URLContext *h, AVBufferRef **mapping);
+    int (*url_map_range)(URLContext *h, int64_t pos, int size, AVBufferRef **buf);
     int (*url_shutdown)(URLContext *h, int flags);
     const AVClass *priv_data_class;
     int priv_data_size;
@@ -263,6 +269,24 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_get_short_seek(void *urlcontext);
 
+/**
+ * Return a read-only memory mapping of the whole resource, if the
+ * protocol provides one.
+ *
+ * @param mapping set to a new reference to the mapping on success
+ * @return 0 on success or <0 on error.
+ */
+int ffurl_get_mapping(URLContext *h, AVBufferRef **mapping);
+
+/**
+ * Return a new writable buffer holding size bytes of the resource starting
+ * at pos, followed by AV_INPUT_BUFFER_PADDING_SIZE zero bytes, without
+ * copying them.
+ *
+ * @return 0 on success or <0 on error, e.g. if the range cannot be mapped.
+ */
+int ffurl_map_range(void *urlcontext, int64_t pos, int size, AVBufferRef **buf);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
@@ -108,6 +108,13 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
     pkt->pos  = avio_tell(s);
 
+    if (ffiocontext(s)->mapping &&
+        ffio_read_ref(s, size, &pkt->buf) >= 0) {
+        pkt->data = pkt->buf->data;
+        pkt->size = size;
+        return size;
+    }
+
     return append_packet_chunked(s, pkt, size);
 }
 
@@ -178,6 +178,7 @@ static void resample_free(ResampleContext **cc){
     if(!c)
         return;
     av_freep(&c->filter_bank);
+    av_freep(&c->batch_buf);
     av_freep(cc);
 }
 
@@ -346,6 +347,53 @@ static int set_compensation(ResampleContext *c, int sample_delta, int compensati
     return 0;
 }
 
+static void interleave_batch(uint8_t *dst, uint8_t * const *src, int nb_samples, int bps)
+{
+    int i, ch;
+
+#define INTERLEAVE(type)                                                    \
+    for (i = 0; i < nb_samples; i++)                                        \
+        for (ch = 0; ch < RESAMPLE_BATCH; ch++)                             \
+            ((type *)dst)[i * RESAMPLE_BATCH + ch] = ((const type *)src[ch])[i];
+
+    switch (bps) {
+    case 2: INTERLEAVE(int16_t); break;
+    case 4: INTERLEAVE(int32_t); break;
+    case 8: INTERLEAVE(int64_t); break;
+    }
+#undef INTERLEAVE
+}
+
+/**
+ * Resample RESAMPLE_BATCH channels at a time, then the remaining ones one by
+ * one. Returns the number of consumed source samples.
+ */
+static int resample_batches(ResampleContext *c, AudioData *dst, int dst_size,
+                            AudioData *src, int src_size)
+{
+    int64_t end_index = c->index + (int64_t)dst_size * c->dst_incr_div +
+                        (c->frac + (int64_t)dst_size * c->dst_incr_mod) / c->src_incr;
+    int nb_samples = av_clip64(end_index / c->phase_count + c->filter_length + 1, 0, src_size);
+    int i = 0, consumed = 0;
+
+    av_fast_malloc(&c->batch_buf, &c->batch_buf_size,
+                   (size_t)nb_samples * RESAMPLE_BATCH * c->felem_size);
+    /* without the interleaved copy, all the channels are resampled one by one */
+    if (c->batch_buf) {
+        for (; i + RESAMPLE_BATCH <= dst->ch_count; i += RESAMPLE_BATCH) {
+            const int last = i + RESAMPLE_BATCH == dst->ch_count;
+
+            interleave_batch(c->batch_buf, src->ch + i, nb_samples, c->felem_size);
+            consumed = c->dsp.resample_common_batch(c, (void * const *)(dst->ch + i),
+                                                    c->batch_buf, dst_size, last);
+        }
+    }
+    for (; i < dst->ch_count; i++)
+        consumed = c->dsp.resample_common(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+
+    return consumed;
+}
+
 static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
     int i;
     int64_t max_src_size = (INT64_MAX/2 / c->phase_count) / c->src_incr;
@@ -388,8 +436,13 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
              * when frac and dst_incr_mod are zero */
             resample_func = (c->linear && (c->frac || c->dst_incr_mod)) ?
                             c->dsp.resample_linear : c->dsp.resample_common;
-            for (i = 0; i < dst->ch_count; i++)
-                *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            if (resample_func == c->dsp.resample_common && c->dsp.resample_common_batch &&
+                dst->ch_count >= RESAMPLE_BATCH) {
+                *consumed = resample_batches(c, dst, dst_size, src, src_size);
+            } else {
+                for (i = 0; i < dst->ch_count; i++)
+                    *consumed = resample_func(c, dst->ch[i], src->ch[i], dst_size, i+1 == dst->ch_count);
+            }
         }
     }
 
@@ -27,6 +27,11 @@
 
 #include "swresample_internal.h"
 
+/**
+ * Number of channels resampled together by resample_common_batch.
+ */
+#define RESAMPLE_BATCH 4
+
 typedef struct ResampleContext {
     const AVClass *av_class;
     uint8_t *filter_bank;
@@ -49,6 +54,8 @@ typedef struct ResampleContext {
     int felem_size;
     int filter_shift;
     int phase_count_compensation;      /* desired phase_count when compensation is enabled */
+    uint8_t *batch_buf;                /* interleaved source samples of a batch of channels */
+    unsigned int batch_buf_size;
 
     struct {
         void (*resample_one)(void *dst, const void *src,
@@ -57,6 +64,11 @@ typedef struct ResampleContext {
                                const void *src, int n, int update_ctx);
         int (*resample_linear)(struct ResampleContext *c, void *dst,
                                const void *src, int n, int update_ctx);
+        /* Optional C kernel for RESAMPLE_BATCH channels, only set while
+         * resample_common is the C version: no arch provides a batched
+         * kernel, the SIMD resample_common is used for each channel instead */
+        int (*resample_common_batch)(struct ResampleContext *c, void * const *dst,
+                                     const void *src, int n, int update_ctx);
     } dsp;
 } ResampleContext;
 
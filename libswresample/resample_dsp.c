@@ -45,29 +45,38 @@
 
 void swri_resample_dsp_init(ResampleContext *c)
 {
+    int (*resample_common)(struct ResampleContext *c, void *dst,
+                           const void *src, int n, int update_ctx);
+
     switch(c->format){
     case AV_SAMPLE_FMT_S16P:
         c->dsp.resample_one = resample_one_int16;
         c->dsp.resample_common = resample_common_int16;
         c->dsp.resample_linear = resample_linear_int16;
+        c->dsp.resample_common_batch = resample_common_batch_int16;
         break;
     case AV_SAMPLE_FMT_S32P:
         c->dsp.resample_one = resample_one_int32;
         c->dsp.resample_common = resample_common_int32;
         c->dsp.resample_linear = resample_linear_int32;
+        c->dsp.resample_common_batch = resample_common_batch_int32;
         break;
     case AV_SAMPLE_FMT_FLTP:
         c->dsp.resample_one = resample_one_float;
         c->dsp.resample_common = resample_common_float;
         c->dsp.resample_linear = resample_linear_float;
+        c->dsp.resample_common_batch = resample_common_batch_float;
         break;
     case AV_SAMPLE_FMT_DBLP:
         c->dsp.resample_one = resample_one_double;
         c->dsp.resample_common = resample_common_double;
         c->dsp.resample_linear = resample_linear_double;
+        c->dsp.resample_common_batch = resample_common_batch_double;
         break;
     }
 
+    resample_common = c->dsp.resample_common;
+
 #if ARCH_X86
     swri_resample_dsp_x86_init(c);
 #elif ARCH_ARM
@@ -75,4 +84,9 @@ void swri_resample_dsp_init(ResampleContext *c)
 #elif ARCH_AARCH64
     swri_resample_dsp_aarch64_init(c);
 #endif
+
+    /* The batched kernel only replaces the C resample_common. S32P, which no
+     * arch has SIMD for, and builds without asm use it. */
+    if (c->dsp.resample_common != resample_common)
+        c->dsp.resample_common_batch = NULL;
 }
@@ -140,6 +140,76 @@ static int RENAME(resample_common)(ResampleContext *c,
     return sample_index;
 }
 
+/**
+ * Same as resample_common() for RESAMPLE_BATCH channels at once, the
+ * source samples being interleaved. The filter coefficients are loaded once
+ * for all the channels, and the channels can be processed in parallel.
+ */
+static int RENAME(resample_common_batch)(ResampleContext *c,
+                                         void * const *dest, const void *source,
+                                         int n, int update_ctx)
+{
+    const DELEM *src = source;
+    int dst_index;
+    int index= c->index;
+    int frac= c->frac;
+    int sample_index = 0;
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    for (dst_index = 0; dst_index < n; dst_index++) {
+        FELEM *filter = ((FELEM *) c->filter_bank) + c->filter_alloc * index;
+        const DELEM *s = src + sample_index * RESAMPLE_BATCH;
+
+        FELEM2 val [RESAMPLE_BATCH];
+        FELEM2 val2[RESAMPLE_BATCH];
+        int i, ch;
+        for (ch = 0; ch < RESAMPLE_BATCH; ch++) {
+            val [ch] = FOFFSET;
+            val2[ch] = 0;
+        }
+        for (i = 0; i + 1 < c->filter_length; i+=2) {
+            for (ch = 0; ch < RESAMPLE_BATCH; ch++) {
+                val [ch] += s[ i      * RESAMPLE_BATCH + ch] * (FELEM2)filter[i    ];
+                val2[ch] += s[(i + 1) * RESAMPLE_BATCH + ch] * (FELEM2)filter[i + 1];
+            }
+        }
+        if (i < c->filter_length)
+            for (ch = 0; ch < RESAMPLE_BATCH; ch++)
+                val[ch] += s[i * RESAMPLE_BATCH + ch] * (FELEM2)filter[i];
+        for (ch = 0; ch < RESAMPLE_BATCH; ch++) {
+            DELEM *dst = dest[ch];
+#ifdef FELEML
+            OUT(dst[dst_index], val[ch] + (FELEML)val2[ch]);
+#else
+            OUT(dst[dst_index], val[ch] + val2[ch]);
+#endif
+        }
+
+        frac  += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+
+    if(update_ctx){
+        c->frac= frac;
+        c->index= index;
+    }
+
+    return sample_index;
+}
+
 static int RENAME(resample_linear)(ResampleContext *c,
                                    void *dest, const void *source,
                                    int n, int update_ctx)
@@ -12,7 +12,7 @@ fate-fifo-muxer-wav: REF = 4dda5dcc7ecdc2218b0739a152ada802
 FATE_SAMPLES_FIFO_MUXER-$(call ALLYES, FIFO_MUXER, WAV_DEMUXER) += fate-fifo-muxer-wav
 
 fate-fifo-muxer-tst: libavformat/tests/fifo_muxer$(EXESUF)
-fate-fifo-muxer-tst: CMD = run libavformat/tests/fifo_muxer$(EXESUF)
+fate-fifo-muxer-tst: CMD = run libavformat/tests/fifo_muxer$(EXESUF) $(TARGET_PATH)/tests/data
 FATE_FIFO_MUXER-$(call ALLYES, FIFO_MUXER NETWORK) += fate-fifo-muxer-tst
 
 FATE_SAMPLES_FFMPEG += $(FATE_SAMPLES_FIFO_MUXER-yes)
@@ -135,6 +135,12 @@ fate-filter-firequalizer: CMP = oneoff
 fate-filter-firequalizer: CMP_UNIT = s16
 fate-filter-firequalizer: SIZE_TOLERANCE = 1058400 - 1097208
 
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, MULTIEQUALIZER ARESAMPLE, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-multiequalizer
+fate-filter-multiequalizer: tests/data/asynth-44100-2.wav
+fate-filter-multiequalizer: tests/data/filtergraphs/multiequalizer
+fate-filter-multiequalizer: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+fate-filter-multiequalizer: CMD = framecrc -i $(SRC) -frames:a 20 -/af $(TARGET_PATH)/tests/data/filtergraphs/multiequalizer
+
 FATE_AFILTER-$(call FILTERDEMDECENCMUX, PAN, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-pan-mono1
 fate-filter-pan-mono1: tests/data/asynth-44100-2.wav
 fate-filter-pan-mono1: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
@@ -188,6 +194,23 @@ fate-filter-pan-downmix2: CMD = framecrc -ss 3.14 -i $(SRC) -frames:a 20 -filter
 FATE_AFILTER-$(call ALLYES, LAVFI_INDEV AEVALSRC_FILTER SILENCEREMOVE_FILTER ARESAMPLE_FILTER) += fate-filter-silenceremove
 fate-filter-silenceremove: CMD = framecrc -auto_conversion_filters -f lavfi -i "aevalsrc=between(t\,1\,2)+between(t\,4\,5)+between(t\,7\,9):d=10:n=8192,silenceremove=start_periods=0:start_duration=0:start_threshold=0:stop_periods=-1:stop_duration=0:stop_threshold=-90dB:window=0:detection=avg"
 
+# The level rises slowly, so that the required limiter gain keeps rising over
+# the whole lookahead.
+tests/data/loudnorm-ramp.wav: TAG = GEN
+tests/data/loudnorm-ramp.wav: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "aevalsrc=(0.05+t/4)*sin(2*PI*10*t):s=16000:d=3:n=1600" -flags +bitexact -fflags +bitexact \
+        -c:a pcm_s16le -y $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_AFILTER-$(call ALLYES, LAVFI_INDEV AEVALSRC_FILTER LOUDNORM_FILTER ARESAMPLE_FILTER WAV_MUXER WAV_DEMUXER PCM_S16LE_DECODER PCM_S16LE_ENCODER PCM_S16LE_MUXER PIPE_PROTOCOL) += fate-filter-loudnorm-lookahead
+fate-filter-loudnorm-lookahead: tests/data/loudnorm-ramp.wav
+fate-filter-loudnorm-lookahead: SRC = $(TARGET_PATH)/tests/data/loudnorm-ramp.wav
+fate-filter-loudnorm-lookahead: CMD = pcm -i $(SRC) -af loudnorm=lookahead=0.01:TP=-3
+fate-filter-loudnorm-lookahead: REF = $(SRC)
+fate-filter-loudnorm-lookahead: CMP = stddev
+fate-filter-loudnorm-lookahead: CMP_TARGET = 7207.44
+fate-filter-loudnorm-lookahead: FUZZ = 1
+
 FATE_FILTER_STEREOTOOLS-$(call FRAMECRC) += fate-filter-stereotools
 FATE_AFILTER_SAMPLES-$(call FILTERDEMDECENCMUX, STEREOTOOLS ARESAMPLE, WAV, PCM_S16LE, PCM_S16LE, WAV) += $(FATE_FILTER_STEREOTOOLS-yes)
 fate-filter-stereotools: SRC = $(TARGET_SAMPLES)/audio-reference/luckynight_2ch_44kHz_s16.wav
@@ -253,6 +276,13 @@ $(FATE_AMIX): SRC1 = $(TARGET_PATH)/tests/data/asynth-44100-2-2.wav
 $(FATE_AMIX): CMP  = oneoff
 $(FATE_AMIX): CMP_UNIT = f32
 
+# five inputs with frames longer than the mixing blocks, mixed by several threads
+FATE_AFILTER-$(call ALLYES, SINE_FILTER PAN_FILTER AMIX_FILTER ARESAMPLE_FILTER PCM_S16LE_ENCODER PCM_S16LE_MUXER FILE_PROTOCOL) += fate-filter-amix-sines fate-filter-amix-sines-threads
+fate-filter-amix-sines fate-filter-amix-sines-threads: tests/data/filtergraphs/amix-sines
+fate-filter-amix-sines: CMD = md5 -auto_conversion_filters -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/amix-sines -f s16le
+fate-filter-amix-sines-threads: CMD = md5 -auto_conversion_filters -filter_threads 4 -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/amix-sines -f s16le
+fate-filter-amix-sines-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-amix-sines
+
 FATE_AFILTER_SAMPLES-$(call PCM, FLV, NELLYMOSER, PCM_S16LE_MUXER ARESAMPLE_FILTER) += fate-filter-aresample
 fate-filter-aresample: SRC = $(TARGET_SAMPLES)/nellymoser/nellymoser-discont.flv
 fate-filter-aresample: CMD = pcm -analyzeduration 10000000 -i $(SRC) -af aresample=min_comp=0.001:min_hard_comp=0.1:first_pts=0
@@ -425,6 +455,13 @@ fate-filter-atempo: REF = $(SAMPLES)/filter-reference/atempo.pcm
 fate-filter-aloop: CMD = framecrc -filter_complex "sine=r=48000:f=480:d=4,aloop=loop=4:start=48000:size=48000,asetnsamples=9600"
 FATE_AFILTER-$(call ALLYES, SINE_FILTER ALOOP_FILTER ASETNSAMPLES_FILTER PCM_S16LE_ENCODER FRAMECRC_MUXER PIPE_PROTOCOL) += fate-filter-aloop
 
+# Batched audio must be identical sample for sample to the unbatched one.
+AUDIO_BATCH_GRAPH = "sine=r=48000:d=2:samples_per_frame=64,volume=0.5:precision=fixed,aresample=44100,pan=mono|c0=c0,atrim=start_sample=1000,volume=2:precision=fixed"
+FATE_AFILTER-$(call ALLYES, SINE_FILTER VOLUME_FILTER ARESAMPLE_FILTER PAN_FILTER ATRIM_FILTER PCM_S16LE_ENCODER PCM_S16LE_MUXER FILE_PROTOCOL) += fate-filter-audio-nobatch fate-filter-audio-batch
+fate-filter-audio-nobatch: CMD = md5 -auto_conversion_filters -filter_complex $(AUDIO_BATCH_GRAPH) -f s16le
+fate-filter-audio-batch: CMD = md5 -auto_conversion_filters -filter_audio_batch 0.1 -filter_complex $(AUDIO_BATCH_GRAPH) -f s16le
+fate-filter-audio-batch: REF = $(SRC_PATH)/tests/ref/fate/filter-audio-nobatch
+
 fate-filter-anullsink: CMD = framecrc -f lavfi -i "sine=d=1" -af "aresample=22050,asplit[a][b];[a]anullsink;[b]atrim=end_sample=256"
 FATE_AFILTER-$(call ALLYES, LAVFI_INDEV SINE_FILTER ARESAMPLE_FILTER ASPLIT_FILTER ANULLSINK_FILTER ATRIM_FILTER PCM_S16LE_ENCODER FRAMECRC_MUXER PIPE_PROTOCOL) += fate-filter-anullsink
 
@@ -56,6 +56,18 @@ FATE_FILTER_PALETTEGEN-$(call FILTERDEMDEC, SCALE PALETTEGEN, MATROSKA, H264) +=
 fate-filter-palettegen-1: CMD = framecrc -i $(TARGET_SAMPLES)/filter/anim.mkv -vf scale,palettegen,scale -pix_fmt bgra
 fate-filter-palettegen-2: CMD = framecrc -i $(TARGET_SAMPLES)/filter/anim.mkv -vf scale,palettegen=max_colors=128:reserve_transparent=0:stats_mode=diff,scale -pix_fmt bgra
 
+# The histogram of each frame is updated from the one of the previous frame
+# or rebuilt, across scene changes.
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 SMPTEBARS TESTSRC CONCAT FORMAT SCALE PALETTEGEN) += fate-filter-palettegen-single
+fate-filter-palettegen-single: tests/data/filtergraphs/palettegen-single
+fate-filter-palettegen-single: CMD = framecrc -auto_conversion_filters -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/palettegen-single -pix_fmt bgra
+
+# Colors only differing by their alpha are ordered as in a histogram built
+# from scratch, the ref is the one of a build for each frame.
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 FORMAT GEQ SCALE PALETTEGEN) += fate-filter-palettegen-single-alpha
+fate-filter-palettegen-single-alpha: tests/data/filtergraphs/palettegen-single-alpha
+fate-filter-palettegen-single-alpha: CMD = framecrc -auto_conversion_filters -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/palettegen-single-alpha -pix_fmt bgra
+
 fate-filter-palettegen: $(FATE_FILTER_PALETTEGEN-yes)
 FATE_FILTER_SAMPLES-yes += $(FATE_FILTER_PALETTEGEN-yes)
 
@@ -73,6 +85,12 @@ fate-filter-paletteuse-sierra2_4a: CMD = framecrc -auto_conversion_filters -i $(
 
 FATE_FILTER_PALETTEUSE-$(call FILTERDEMDEC, PALETTEUSE SCALE, MATROSKA IMAGE2, H264 PNG) += $(FATE_FILTER_PALETTEUSE)
 
+# The error diffusion is split in slices: the output must not depend on the
+# number of threads.
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 FORMAT SCALE SPLIT PALETTEGEN PALETTEUSE) += fate-filter-paletteuse-threads
+fate-filter-paletteuse-threads: tests/data/filtergraphs/paletteuse-threads
+fate-filter-paletteuse-threads: CMD = framecrc -auto_conversion_filters -filter_threads 4 -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/paletteuse-threads -pix_fmt bgra
+
 fate-filter-paletteuse: $(FATE_FILTER_PALETTEUSE-yes)
 FATE_FILTER_SAMPLES-yes += $(FATE_FILTER_PALETTEUSE-yes)
 
@@ -182,6 +200,16 @@ FATE_FILTER-$(call FILTERFRAMECRC, MINTERPOLATE TESTSRC2) += fate-filter-minterp
 fate-filter-minterpolate-up: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolate=fps=10 -t 1
 fate-filter-minterpolate-down: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolate=fps=1 -t 1
 
+# the motion search and compensation must not depend on the number of threads
+FATE_FILTER-$(call FILTERFRAMECRC, MINTERPOLATE TESTSRC2) += fate-filter-minterpolate-up-threads
+fate-filter-minterpolate-up-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-up
+fate-filter-minterpolate-up-threads: CMD = framecrc -filter_threads 4 -lavfi testsrc2=r=2:d=10,minterpolate=fps=10 -t 1
+
+FATE_FILTER-$(call FILTERFRAMECRC, MINTERPOLATE TESTSRC2) += fate-filter-minterpolate-bidir fate-filter-minterpolate-bidir-threads
+fate-filter-minterpolate-bidir: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolate=fps=10:me_mode=bidir:mc_mode=aobmc:vsbmc=1:mb_size=8 -t 1
+fate-filter-minterpolate-bidir-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-minterpolate-bidir
+fate-filter-minterpolate-bidir-threads: CMD = framecrc -filter_threads 3 -lavfi testsrc2=r=2:d=10,minterpolate=fps=10:me_mode=bidir:mc_mode=aobmc:vsbmc=1:mb_size=8 -t 1
+
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_BOXBLUR_FILTER) += fate-filter-boxblur
 fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf boxblur=2:1
 
@@ -219,6 +247,24 @@ fate-filter-interlace-complex: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf interlac
 FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, NEGATE_FILTER PERMS_FILTER) += fate-filter-negate
 fate-filter-negate: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf perms=random,negate
 
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, LUTYUV_FILTER NEGATE_FILTER EQ_FILTER PERMS_FILTER) += fate-filter-pointwise-chain
+fate-filter-pointwise-chain: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf perms=random,lutyuv=y=val*0.9:u=negval,negate,eq=contrast=1.2:brightness=0.1
+
+# the fused chain must match the filters run one after another
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, LUTYUV_FILTER NEGATE_FILTER EQ_FILTER PERMS_FILTER) += fate-filter-pointwise-chain-nofuse
+fate-filter-pointwise-chain-nofuse: CMD = framecrc -nofilter_fuse_pointwise -c:v pgmyuv -i $(SRC) -vf perms=random,lutyuv=y=val*0.9:u=negval,negate,eq=contrast=1.2:brightness=0.1
+fate-filter-pointwise-chain-nofuse: REF = $(SRC_PATH)/tests/ref/fate/filter-pointwise-chain
+
+# commands disabling a member of the chain or changing its table fuse it again
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, SENDCMD_FILTER LUTYUV_FILTER NEGATE_FILTER EQ_FILTER) += fate-filter-pointwise-chain-commands
+fate-filter-pointwise-chain-commands: tests/data/filtergraphs/pointwise-chain-commands
+fate-filter-pointwise-chain-commands: CMD = framecrc -c:v pgmyuv -i $(SRC) -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/pointwise-chain-commands
+
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, SENDCMD_FILTER LUTYUV_FILTER NEGATE_FILTER EQ_FILTER) += fate-filter-pointwise-chain-commands-nofuse
+fate-filter-pointwise-chain-commands-nofuse: tests/data/filtergraphs/pointwise-chain-commands
+fate-filter-pointwise-chain-commands-nofuse: CMD = framecrc -nofilter_fuse_pointwise -c:v pgmyuv -i $(SRC) -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/pointwise-chain-commands
+fate-filter-pointwise-chain-commands-nofuse: REF = $(SRC_PATH)/tests/ref/fate/filter-pointwise-chain-commands
+
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_HISTOGRAM_FILTER) += fate-filter-histogram-levels
 fate-filter-histogram-levels: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf histogram -flags +bitexact -sws_flags +accurate_rnd+bitexact
 
@@ -264,6 +310,17 @@ FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_VSTACK_FILTER) += fate-filter-vstack
 fate-filter-vstack: tests/data/filtergraphs/vstack
 fate-filter-vstack: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/vstack
 
+# The inputs of the first vstack write into its output, those of the second
+# one are copied: both outputs must match.
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 SPLIT NEGATE HFLIP VSTACK LUTYUV) += fate-filter-vstack-direct
+fate-filter-vstack-direct: tests/data/filtergraphs/vstack-direct
+fate-filter-vstack-direct: CMD = framecrc -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/vstack-direct -map "[direct]" -map "[copied]"
+
+# Whether the inputs are written directly into the output, and how often.
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER NEGATE_FILTER HFLIP_FILTER SPLIT_FILTER VSTACK_FILTER XSTACK_FILTER) += fate-filter-stack-direct-tiles
+fate-filter-stack-direct-tiles: libavfilter/tests/stack$(EXESUF)
+fate-filter-stack-direct-tiles: CMD = run libavfilter/tests/stack$(EXESUF)
+
 FATE_FILTER_OVERLAY-$(call FILTERDEMDEC, SCALE OVERLAY, IMAGE2, PGMYUV) += fate-filter-overlay
 fate-filter-overlay: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -/filter_complex $(FILTERGRAPH)
 
@@ -365,6 +422,11 @@ fate-filter-tpad-add:   CMD = framecrc -lavfi testsrc2=d=1:r=2,tpad=start=1:stop
 fate-filter-tpad-clone: CMD = framecrc -lavfi testsrc2=d=1:r=2,tpad=start=1:stop=2:stop_mode=clone:color=black
 fate-filter-tpad-add-duration: CMD = framecrc -lavfi testsrc2=d=1:r=2,tpad=start_duration=0.5s:stop_duration=1.5s:color=gray
 
+# commands fusing the chain after tpad again while the last frame is held
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 SENDCMD TPAD NEGATE LUTYUV DRAWBOX) += fate-filter-tpad-commands
+fate-filter-tpad-commands: tests/data/filtergraphs/tpad-commands
+fate-filter-tpad-commands: CMD = framecrc -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/tpad-commands
+
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_TRANSPOSE_FILTER) += fate-filter-transpose
 fate-filter-transpose: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf transpose
 
@@ -394,6 +456,10 @@ fate-filter-unsharp: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf unsharp=11:11:-1.5
 FATE_FILTER_VSYNTH-$(call FILTERFRAMECRC, TESTSRC2 SCALE UNSHARP) += fate-filter-unsharp-yuv420p10
 fate-filter-unsharp-yuv420p10: CMD = framecrc -lavfi testsrc2=r=2:d=10,scale,format=yuv420p10,unsharp=11:11:-1.5:11:11:-1.5,scale -pix_fmt yuv420p10le -flags +bitexact -sws_flags +accurate_rnd+bitexact
 
+# testsrc2 outputs 10-bit frames instead of 8-bit ones that scale converts
+FATE_FILTER_VSYNTH-$(call FILTERFRAMECRC, TESTSRC2 SCALE UNSHARP) += fate-filter-unsharp-yuv420p10-format-cost
+fate-filter-unsharp-yuv420p10-format-cost: CMD = framecrc -filter_format_cost -lavfi testsrc2=r=2:d=10,scale,format=yuv420p10,unsharp=11:11:-1.5:11:11:-1.5,scale -pix_fmt yuv420p10le -flags +bitexact -sws_flags +accurate_rnd+bitexact
+
 FATE_FILTER_SAMPLES-$(call FILTERDEMDEC, PERMS HQDN3D, SMJPEG, MJPEG) += fate-filter-hqdn3d-sample
 fate-filter-hqdn3d-sample: tests/data/filtergraphs/hqdn3d
 fate-filter-hqdn3d-sample: CMD = framecrc -idct simple -i $(TARGET_SAMPLES)/smjpeg/scenwin.mjpg -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/hqdn3d -an
@@ -438,6 +504,16 @@ fate-filter-chromashift-wrap:  CMD = framecrc -lavfi testsrc2=r=5:d=1,chromashif
 FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 FPS DECIMATE) += fate-filter-decimate
 fate-filter-decimate: CMD = framecrc -lavfi testsrc2=r=24:d=10,fps=60,decimate=5,decimate=4,decimate=3 -pix_fmt yuv420p
 
+# the IVTC metrics must not depend on the number of threads
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 FPS DECIMATE) += fate-filter-decimate-threads
+fate-filter-decimate-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-decimate
+fate-filter-decimate-threads: CMD = framecrc -filter_threads 4 -lavfi testsrc2=r=24:d=10,fps=60,decimate=5,decimate=4,decimate=3 -pix_fmt yuv420p
+
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 TELECINE FIELDMATCH DECIMATE) += fate-filter-fieldmatch fate-filter-fieldmatch-threads
+fate-filter-fieldmatch: CMD = framecrc -lavfi testsrc2=r=24000/1001:d=2:s=320x240,telecine,fieldmatch=combmatch=full:mode=pc_n_ub,decimate
+fate-filter-fieldmatch-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-fieldmatch
+fate-filter-fieldmatch-threads: CMD = framecrc -filter_threads 3 -lavfi testsrc2=r=24000/1001:d=2:s=320x240,telecine,fieldmatch=combmatch=full:mode=pc_n_ub,decimate
+
 FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 FPS MPDECIMATE) += fate-filter-mpdecimate
 fate-filter-mpdecimate: CMD = framecrc -lavfi testsrc2=r=2:d=10,fps=3,mpdecimate -pix_fmt yuv420p
 
@@ -698,6 +774,23 @@ FATE_FILTER_VSYNTH-yes += $(FATE_FILTER_PIXFMTS)
 
 fate-filter-pixfmts: $(FATE_FILTER_PIXFMTS)
 
+# The output with pipeline threading is compared to the one without it.
+FATE_FILTER-$(call ALLYES, SPLIT_FILTER NEGATE_FILTER HFLIP_FILTER LUTYUV_FILTER \
+                           VFLIP_FILTER BOXBLUR_FILTER BLEND_FILTER TRANSPOSE_FILTER) += fate-filter-pipeline
+fate-filter-pipeline: libavfilter/tests/pipeline$(EXESUF)
+fate-filter-pipeline: CMD = run libavfilter/tests/pipeline$(EXESUF)
+
+# The graph dump with the statistics, without and with profiling.
+FATE_FILTER-$(call ALLYES, SPLIT_FILTER NEGATE_FILTER HFLIP_FILTER HSTACK_FILTER) += fate-filter-graphdump-stats
+fate-filter-graphdump-stats: libavfilter/tests/graphdump$(EXESUF)
+fate-filter-graphdump-stats: CMD = run libavfilter/tests/graphdump$(EXESUF)
+
+# The text changes on each frame, the output is compared to the one of a new
+# filter instance for each frame. The default font is found by fontconfig.
+FATE_FILTER-$(call ALLYES, DRAWTEXT_FILTER LIBFONTCONFIG) += fate-filter-drawtext-text-change
+fate-filter-drawtext-text-change: libavfilter/tests/drawtext$(EXESUF)
+fate-filter-drawtext-text-change: CMD = run libavfilter/tests/drawtext$(EXESUF)
+
 FATE_FILTER_VSYNTH-$(call VIDEO_FILTER) += $(FATE_FILTER_VSYNTH_VIDEO_FILTER-yes)
 FATE_FILTER_VSYNTH-$(call FRAMECRC, IMAGE2, PGMYUV) += $(FATE_FILTER_VSYNTH_PGMYUV-yes)
 $(FATE_FILTER_VSYNTH-yes): $(VREF)
@@ -737,6 +830,34 @@ fate-filter-metadata-cropdetect2: CMD = run $(FILTER_METADATA_COMMAND) "sws_flag
 FREEZEDETECT_DEPS = LAVFI_INDEV MPTESTSRC_FILTER SCALE_FILTER FREEZEDETECT_FILTER
 FATE_METADATA_FILTER-$(call ALLYES, $(FREEZEDETECT_DEPS)) += fate-filter-metadata-freezedetect
 fate-filter-metadata-freezedetect: CMD = run $(FILTER_METADATA_COMMAND) "sws_flags=+accurate_rnd+bitexact;mptestsrc=r=25:d=10:m=51,freezedetect"
+FATE_METADATA_FILTER-$(call ALLYES, $(FREEZEDETECT_DEPS)) += fate-filter-metadata-freezedetect-step
+fate-filter-metadata-freezedetect-step: CMD = run $(FILTER_METADATA_COMMAND) "sws_flags=+accurate_rnd+bitexact;mptestsrc=r=25:d=10:m=51,freezedetect=line_step=4:frame_step=5"
+
+# the detection must not depend on the number of threads
+CROPDETECT_STEP_DEPS = COLOR_FILTER TESTSRC2_FILTER FORMAT_FILTER OVERLAY_FILTER CROPDETECT_FILTER \
+                       METADATA_FILTER WRAPPED_AVFRAME_ENCODER NULL_MUXER
+FATE_FILTER-$(call ALLYES, $(CROPDETECT_STEP_DEPS)) += fate-filter-cropdetect-step fate-filter-cropdetect-step-threads
+fate-filter-cropdetect-step fate-filter-cropdetect-step-threads: tests/data/filtergraphs/cropdetect-step
+fate-filter-cropdetect-step: CMD = ffmpeg -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/cropdetect-step -f null -
+fate-filter-cropdetect-step-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-cropdetect-step
+fate-filter-cropdetect-step-threads: CMD = ffmpeg -filter_threads 4 -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/cropdetect-step -f null -
+
+BLACKDETECT_STEP_DEPS = TESTSRC2_FILTER DRAWBOX_FILTER BLACKDETECT_FILTER \
+                        METADATA_FILTER WRAPPED_AVFRAME_ENCODER NULL_MUXER
+FATE_FILTER-$(call ALLYES, $(BLACKDETECT_STEP_DEPS)) += fate-filter-blackdetect-step fate-filter-blackdetect-step-threads
+fate-filter-blackdetect-step fate-filter-blackdetect-step-threads: tests/data/filtergraphs/blackdetect-step
+fate-filter-blackdetect-step: CMD = ffmpeg -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/blackdetect-step -f null -
+fate-filter-blackdetect-step-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-blackdetect-step
+fate-filter-blackdetect-step-threads: CMD = ffmpeg -filter_threads 4 -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/blackdetect-step -f null -
+
+# an interlaced inset on a static background, analyzed on every other line
+# pair and inside an area that only covers the background
+IDET_DEPS = FFPROBE LAVFI_INDEV TESTSRC2_FILTER COLOR_FILTER INTERLACE_FILTER OVERLAY_FILTER \
+            SCALE_FILTER IDET_FILTER
+IDET_GRAPH = sws_flags=+accurate_rnd+bitexact;testsrc2=r=50:d=0.4:s=160x120,interlace[fg];color=gray:r=25:d=0.4:s=320x240[bg];[bg][fg]overlay=16:8
+FATE_FILTER_FFPROBE-$(call ALLYES, $(IDET_DEPS)) += fate-filter-metadata-idet-line-step fate-filter-metadata-idet-area
+fate-filter-metadata-idet-line-step: CMD = run $(FILTER_METADATA_COMMAND) "$(IDET_GRAPH),idet=line_step=2"
+fate-filter-metadata-idet-area: CMD = run $(FILTER_METADATA_COMMAND) "$(IDET_GRAPH),idet=x=170:y=128:w=120:h=100"
 
 SIGNALSTATS_DEPS = LAVFI_INDEV COLOR_FILTER SCALE_FILTER SIGNALSTATS_FILTER
 FATE_METADATA_FILTER-$(call ALLYES, $(SIGNALSTATS_DEPS)) += fate-filter-metadata-signalstats-yuv420p fate-filter-metadata-signalstats-yuv420p10
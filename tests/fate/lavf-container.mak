@@ -71,6 +71,18 @@ fate-lavf-wtv: CMD = lavf_container "" "-c:a mp2 -threads 1"
 FATE_AVCONV += $(FATE_LAVF_CONTAINER)
 fate-lavf-container fate-lavf: $(FATE_LAVF_CONTAINER)
 
+# Decode with the input mapped in memory, the video packets then being
+# mapped instead of copied.
+ifneq (,$(filter fate-lavf-mxf_d10,$(FATE_LAVF_CONTAINER)))
+FATE_FILE_MMAP-$(HAVE_MMAP) += fate-file-mmap-mxf_d10
+endif
+fate-file-mmap-mxf_d10: fate-lavf-mxf_d10
+fate-lavf-mxf_d10: KEEP_FILES ?= 1
+fate-file-mmap-mxf_d10: CMD = framecrc -mmap 1 -i $(TARGET_PATH)/tests/data/lavf/lavf.mxf_d10
+
+FATE_AVCONV += $(FATE_FILE_MMAP-yes)
+fate-lavf-container fate-lavf: $(FATE_FILE_MMAP-yes)
+
 FATE_LAVF_CONTAINER_FATE-$(call CRC, APV MOV,,           APV_PARSER MP4_MUXER) += apv.mp4
 FATE_LAVF_CONTAINER_FATE-$(call CRC, IVF MOV, AV1,       AV1_PARSER EXTRACT_EXTRADATA_BSF MP4_MUXER)      += av1.mp4
 FATE_LAVF_CONTAINER_FATE-$(call CRC, IVF MATROSKA, AV1,  AV1_PARSER EXTRACT_EXTRADATA_BSF MATROSKA_MUXER) += av1.mkv
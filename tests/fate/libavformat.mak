@@ -2,6 +2,10 @@
 #fate-async: libavformat/tests/async$(EXESUF)
 #fate-async: CMD = run libavformat/tests/async
 
+FATE_LIBAVFORMAT += fate-aviobuf
+fate-aviobuf: libavformat/tests/aviobuf$(EXESUF)
+fate-aviobuf: CMD = run libavformat/tests/aviobuf$(EXESUF)
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/tests/noproxy$(EXESUF)
 fate-noproxy: CMD = run libavformat/tests/noproxy$(EXESUF)
@@ -10,10 +14,20 @@ FATE_LIBAVFORMAT-$(CONFIG_FFRTMPCRYPT_PROTOCOL) += fate-rtmpdh
 fate-rtmpdh: libavformat/tests/rtmpdh$(EXESUF)
 fate-rtmpdh: CMD = run libavformat/tests/rtmpdh$(EXESUF)
 
+# Bonding of two links to a local listener
+FATE_LIBAVFORMAT-$(CONFIG_LIBSRT_PROTOCOL) += fate-libsrt
+fate-libsrt: libavformat/tests/libsrt$(EXESUF)
+fate-libsrt: CMD = run libavformat/tests/libsrt$(EXESUF)
+
 FATE_LIBAVFORMAT-$(CONFIG_SRTP) += fate-srtp
 fate-srtp: libavformat/tests/srtp$(EXESUF)
 fate-srtp: CMD = run libavformat/tests/srtp$(EXESUF)
 
+# Round trip through the io_uring file backend
+FATE_LIBAVFORMAT-$(call ALLYES, LIBURING FILE_PROTOCOL) += fate-uring
+fate-uring: libavformat/tests/uring$(EXESUF)
+fate-uring: CMD = run libavformat/tests/uring$(EXESUF) $(TARGET_PATH)/tests/data
+
 FATE_LIBAVFORMAT-yes += fate-url
 fate-url: libavformat/tests/url$(EXESUF)
 fate-url: CMD = run libavformat/tests/url$(EXESUF)
@@ -1098,6 +1098,28 @@ fate-swr-audioconvert: FUZZ = 0
 
 FATE_SWR += $(FATE_SWR_AUDIOCONVERT-yes)
 
+# 6 channels go through the C path that resamples 4 channels at once, the
+# output must match the channels resampled one by one
+SWR_BATCH_RESAMPLE = aresample=48000:internal_sample_fmt=$(1):linear_interp=0,aformat=$(1)
+SWR_BATCH_CHANNEL  = [c$(2)]$(call SWR_BATCH_RESAMPLE,$(1))[r$(2)]
+
+define SWR_BATCH
+FATE_SWR_BATCH += fate-swr-batch-$(1) fate-swr-batch-$(1)-perchannel
+fate-swr-batch-$(1): CMD = md5 -auto_conversion_filters -cpuflags 0 -i $(TARGET_PATH)/tests/data/asynth-44100-6.wav -af aformat=channel_layouts=5.1,$(call SWR_BATCH_RESAMPLE,$(1)) -f $(2)
+fate-swr-batch-$(1)-perchannel: CMD = md5 -auto_conversion_filters -cpuflags 0 -i $(TARGET_PATH)/tests/data/asynth-44100-6.wav \
+    -filter_complex "aformat=channel_layouts=5.1,channelsplit=channel_layout=5.1[c0][c1][c2][c3][c4][c5]\;$(call SWR_BATCH_CHANNEL,$(1),0)\;$(call SWR_BATCH_CHANNEL,$(1),1)\;$(call SWR_BATCH_CHANNEL,$(1),2)\;$(call SWR_BATCH_CHANNEL,$(1),3)\;$(call SWR_BATCH_CHANNEL,$(1),4)\;$(call SWR_BATCH_CHANNEL,$(1),5)\;[r0][r1][r2][r3][r4][r5]join=inputs=6:channel_layout=5.1" -f $(2)
+fate-swr-batch-$(1)-perchannel: REF = $(SRC_PATH)/tests/ref/fate/swr-batch-$(1)
+endef
+
+$(eval $(call SWR_BATCH,s16p,s16le))
+$(eval $(call SWR_BATCH,s32p,s32le))
+$(eval $(call SWR_BATCH,fltp,f32le))
+$(eval $(call SWR_BATCH,dblp,f64le))
+
+FATE_SWR_BATCH-$(call FILTERDEMDECENCMUX, ARESAMPLE AFORMAT CHANNELSPLIT JOIN, WAV, PCM_S16LE, PCM_S16LE PCM_S32LE PCM_F32LE PCM_F64LE, PCM_S16LE PCM_S32LE PCM_F32LE PCM_F64LE) += $(FATE_SWR_BATCH)
+$(FATE_SWR_BATCH): tests/data/asynth-44100-6.wav
+FATE_SWR += $(FATE_SWR_BATCH-yes)
+
 FATE_SWR_CUSTOM_REMATRIX-$(call FILTERDEMDECENCMUX, ARESAMPLE CHANNELMAP AFORMAT, WAV, PCM_S16LE, PCM_S16LE, PCM_S16LE) += fate-swr-custom-rematrix
 fate-swr-custom-rematrix: tests/data/asynth-44100-8.wav tests/data/filtergraphs/custom_rematrix
 fate-swr-custom-rematrix: CMD = md5 -i $(TARGET_PATH)/tests/data/asynth-44100-8.wav -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/custom_rematrix -map [OUT] -f s16le